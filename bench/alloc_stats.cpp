@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "alloc_stats.hpp"
+
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+
+static AllocStats stats{};
+
+AllocStats resetAllocStats()
+{
+    const AllocStats current = stats;
+    stats.count = 0;
+    stats.bytes = 0;
+    return current;
+}
+
+void* operator new(size_t sz)
+{
+    ++stats.count;
+    stats.bytes += sz;
+    void* ptr = malloc(sz ? sz : 1);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    stats.live += malloc_usable_size(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    stats.live -= malloc_usable_size(ptr);
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    stats.live -= malloc_usable_size(ptr);
+    free(ptr);
+}
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @struct AllocStats
+ * @brief Heap statistics collected by the replaced global operator new.
+ */
+struct AllocStats
+{
+    /** @brief Number of allocations. */
+    size_t count;
+    /** @brief Total size of allocated memory in bytes. */
+    size_t bytes;
+    /** @brief Size of memory in use in bytes, never reset. */
+    size_t live;
+};
+
+/** @brief Get current heap statistics and reset counters. */
+AllocStats resetAllocStats();
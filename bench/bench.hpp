@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+/**
+ * @brief Generate synthetic console output that resembles a host boot log:
+ *        kernel messages of various length with "\r\n" line endings.
+ *
+ * @param[in] lines number of lines to generate
+ *
+ * @return console output
+ */
+inline std::string bootTrace(size_t lines)
+{
+    static const char* const samples[] = {
+        "Booting Linux on physical CPU 0x0000000000 [0x410fd083]",
+        "Linux version 6.1.15 (oe-user@oe-host) (aarch64-openbmc-linux-gcc "
+        "(GCC) 12.2.0, GNU ld (GNU Binutils) 2.40) #1 SMP PREEMPT",
+        "Machine model: Example Server Platform",
+        "efi: UEFI not found.",
+        "Zone ranges:",
+        "  DMA      [mem 0x0000000080000000-0x00000000bfffffff]",
+        "pci 0000:00:00.0: [8086:2020] type 00 class 0x060000",
+        "nvme nvme0: pci function 0000:5e:00.0",
+        "EXT4-fs (nvme0n1p2): mounted filesystem with ordered data mode.",
+        "[  OK  ] Started Journal Service.",
+        "[  OK  ] Reached target Local File Systems.",
+        "         Starting Network Time Synchronization...",
+        "",
+    };
+    constexpr size_t samplesNum = sizeof(samples) / sizeof(samples[0]);
+
+    std::mt19937 rnd(1);
+    std::string trace;
+    char prefix[32];
+    for (size_t i = 0; i < lines; ++i)
+    {
+        snprintf(prefix, sizeof(prefix), "[%6zu.%06zu] ", i / 100,
+                 (i % 100) * 10000);
+        trace += prefix;
+        trace += samples[rnd() % samplesNum];
+        trace += "\r\n";
+    }
+    return trace;
+}
+
+/**
+ * @brief Measure execution time of the function.
+ *
+ * @param[in] fn function to execute
+ * @param[in] repeat number of repeats, the best result is returned
+ *
+ * @return execution time in seconds
+ */
+template <typename F>
+double measure(F&& fn, size_t repeat = 5)
+{
+    double best = 0;
+    for (size_t i = 0; i < repeat; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (!i || elapsed.count() < best)
+        {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "log_buffer.hpp"
+#include "log_writer.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+/** @brief Path to the output file. */
+static const char* outFile = "/tmp/compression_bench.out";
+
+/** @brief Get CPU time consumed by the process in seconds. */
+static double cpuTime()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Save buffer with the specified algorithm and print results.
+ *
+ * @param[in] name name of the algorithm
+ * @param[in] compression compression algorithm
+ * @param[in] level compression level
+ * @param[in] buf buffer to save
+ * @param[in] rawSize size of uncompressed log file
+ */
+static void run(const char* name, Compression compression, size_t level,
+                const LogBuffer& buf, size_t rawSize)
+{
+    double best = 0;
+    for (size_t i = 0; i < 5; ++i)
+    {
+        const double start = cpuTime();
+        auto file = LogWriter::create(compression, level, outFile);
+        for (const auto& msg : buf)
+        {
+            file->write(msg.timeStamp, msg.text);
+        }
+        file->close();
+        const double elapsed = cpuTime() - start;
+        if (!i || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    struct stat st;
+    stat(outFile, &st);
+    printf("%-5s level %2zu: %8.2f ms CPU, %7.1f MiB/s, ratio %5.2f\n", name,
+           level, best * 1e3, rawSize / best / (1024 * 1024),
+           static_cast<double>(rawSize) / st.st_size);
+}
+
+/**
+ * @brief Benchmark entry point.
+ *        Usage: compression_bench [FILE], where FILE is a recorded console
+ *        output, by default a synthetic boot log is used.
+ */
+int main(int argc, char* argv[])
+{
+    std::string trace;
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        trace.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    else
+    {
+        trace = bootTrace(100000);
+    }
+
+    LogBuffer buf(0, 0);
+    buf.append(trace.data(), trace.size());
+
+    // Size of the log file without compression, used as a base for ratio
+    {
+        auto file = LogWriter::create(Compression::none, 0, outFile);
+        for (const auto& msg : buf)
+        {
+            file->write(msg.timeStamp, msg.text);
+        }
+        file->close();
+    }
+    struct stat st;
+    stat(outFile, &st);
+    const size_t rawSize = st.st_size;
+    printf("%zu messages, %zu bytes\n", buf.size(), rawSize);
+
+    run("none", Compression::none, 0, buf, rawSize);
+    for (size_t level : {1, 6, 9})
+    {
+        run("zlib", Compression::zlib, level, buf, rawSize);
+    }
+#ifdef HAVE_ZSTD
+    for (size_t level : {1, 3, 9, 15})
+    {
+        run("zstd", Compression::zstd, level, buf, rawSize);
+    }
+#endif
+#ifdef HAVE_LZ4
+    for (size_t level : {0, 9})
+    {
+        run("lz4", Compression::lz4, level, buf, rawSize);
+    }
+#endif
+
+    unlink(outFile);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "console_reader.hpp"
+
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <linux/sockios.h>
+
+#include <cstdlib>
+#include <vector>
+
+/**
+ * @class SocketConsole
+ * @brief Host console connected to a local socket pair, counts system calls.
+ */
+class SocketConsole : public HostConsole
+{
+  public:
+    SocketConsole(int fd) : HostConsole(""), fd(fd) {}
+
+    size_t read(char* buf, size_t sz) const override
+    {
+        ++syscalls;
+        const ssize_t rsz = ::read(fd, buf, sz);
+        return rsz > 0 ? static_cast<size_t>(rsz) : 0;
+    }
+
+    std::optional<size_t> pending() const override
+    {
+        ++syscalls;
+        int queued = 0;
+        if (ioctl(fd, SIOCINQ, &queued) == -1)
+        {
+            return std::nullopt;
+        }
+        return static_cast<size_t>(queued);
+    }
+
+    mutable size_t syscalls = 0;
+
+  private:
+    int fd;
+};
+
+/** @brief Read loop with a fixed 128 bytes buffer previously used. */
+static size_t readLoop(const HostConsole& console)
+{
+    constexpr size_t bufSize = 128;
+    std::vector<char> bufData(bufSize);
+    size_t total = 0;
+    while (const size_t rsz = console.read(bufData.data(), bufSize))
+    {
+        total += rsz;
+    }
+    return total;
+}
+
+/** @brief Read with the adaptive persistent buffer. */
+static size_t readAdaptive(ConsoleReader& reader)
+{
+    size_t total = 0;
+    std::string_view chunk;
+    while (!(chunk = reader.read()).empty())
+    {
+        total += chunk.size();
+    }
+    return total;
+}
+
+template <typename F>
+static void run(const char* name, int wr, SocketConsole& console,
+                size_t burst, F&& readEvent)
+{
+    constexpr size_t totalSize = 16 * 1024 * 1024;
+    const std::string trace = bootTrace(burst / 60 + 1).substr(0, burst);
+    const size_t events = totalSize / burst;
+
+    console.syscalls = 0;
+    const double tm = measure(
+        [&]() {
+            for (size_t i = 0; i < events; ++i)
+            {
+                if (::write(wr, trace.data(), trace.size()) !=
+                    static_cast<ssize_t>(trace.size()))
+                {
+                    abort();
+                }
+                if (readEvent() != trace.size())
+                {
+                    abort();
+                }
+            }
+        },
+        1);
+    printf("%-8s burst %6zu: %8.1f MiB/s, %6.2f syscalls/KiB\n", name, burst,
+           events * burst / tm / (1024 * 1024),
+           console.syscalls * 1024.0 / (events * burst));
+}
+
+int main()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+    const int bufSize = 1024 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+
+    SocketConsole console(fds[0]);
+    for (const size_t burst : {128, 4 * 1024, 64 * 1024})
+    {
+        run("loop", fds[1], console, burst,
+            [&console]() { return readLoop(console); });
+        ConsoleReader reader(console, 64 * 1024);
+        run("adaptive", fds[1], console, burst,
+            [&reader]() { return readAdaptive(reader); });
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "file_storage.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+/** @brief Output directory. */
+static const fs::path outDir = "/tmp/file_storage_bench";
+
+/**
+ * @brief Measure flush of a small buffer to the directory with many files.
+ *
+ * @param[in] files number of log files in the directory
+ * @param[in] buf log buffer to save
+ */
+static void run(size_t files, const LogBuffer& buf)
+{
+    fs::remove_all(outDir);
+    fs::create_directories(outDir);
+    for (size_t i = 0; i < files; ++i)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "host_20200101_%06zu.log", i);
+        std::ofstream(outDir / name) << "old";
+    }
+
+    const double tmStart =
+        measure([&]() { FileStorage(outDir, "", files); }, 1);
+
+    // Each save removes the oldest file
+    constexpr size_t saves = 100;
+    FileStorage storage(outDir, "", files);
+    const double tmSave = measure(
+        [&]() {
+            for (size_t i = 0; i < saves; ++i)
+            {
+                storage.save(buf);
+            }
+        },
+        1);
+
+    printf("%6zu files: start %8.3f ms, save with rotation %7.3f ms\n", files,
+           tmStart * 1e3, tmSave * 1e3 / saves);
+}
+
+/**
+ * @brief Benchmark entry point.
+ */
+int main()
+{
+    LogBuffer buf(0, 0);
+    const std::string trace = bootTrace(10);
+    buf.append(trace.data(), trace.size());
+
+    for (size_t files : {10, 100, 1000, 10000})
+    {
+        run(files, buf);
+    }
+    fs::remove_all(outDir);
+
+    return EXIT_SUCCESS;
+}
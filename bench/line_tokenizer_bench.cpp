@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "line_tokenizer.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+/** @brief Check if a character is EOL symbol. */
+static constexpr bool isEol(char c)
+{
+    return c == '\r' || c == '\n';
+}
+
+/** @brief Byte-by-byte splitter previously used by LogBuffer::append. */
+template <typename F>
+static void splitLoop(const char* data, size_t sz, F&& fn)
+{
+    size_t pos = 0;
+    while (pos < sz)
+    {
+        size_t eol = pos;
+        while (eol < sz)
+        {
+            if (isEol(data[eol]))
+            {
+                break;
+            }
+            ++eol;
+        }
+        const bool eolFound = eol < sz;
+        fn(data + pos, (eolFound ? eol : sz) - pos, eolFound);
+        pos = eol + 1;
+        if (eolFound && pos < sz && isEol(data[pos]) && data[eol] != data[pos])
+        {
+            ++pos;
+        }
+    }
+}
+
+template <typename F>
+static void run(const char* name, const std::string& trace, size_t chunk,
+                F&& split)
+{
+    size_t lines = 0;
+    const double tm = measure([&]() {
+        lines = 0;
+        for (size_t pos = 0; pos < trace.size(); pos += chunk)
+        {
+            split(trace.data() + pos, std::min(chunk, trace.size() - pos),
+                  [&lines](const char*, size_t, bool eol) { lines += eol; });
+        }
+    });
+    printf("%-9s chunk %6zu: %8.1f MiB/s (%zu lines)\n", name, chunk,
+           trace.size() / tm / (1024 * 1024), lines);
+}
+
+/**
+ * @brief Benchmark entry point.
+ *        Usage: line_tokenizer_bench [FILE], where FILE is a recorded console
+ *        output, by default a synthetic boot log is used.
+ */
+int main(int argc, char* argv[])
+{
+    std::string trace;
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        trace.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    else
+    {
+        trace = bootTrace(100000);
+    }
+
+    for (size_t chunk : {128, 4096, 65536})
+    {
+        run("loop", trace, chunk, [](const char* data, size_t sz, auto&& fn) {
+            splitLoop(data, sz, fn);
+        });
+        LineTokenizer tokenizer;
+        run("tokenizer", trace, chunk,
+            [&tokenizer](const char* data, size_t sz, auto&& fn) {
+                tokenizer.split(data, sz, fn);
+            });
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "alloc_stats.hpp"
+#include "bench.hpp"
+#include "log_buffer.hpp"
+#include "log_buffer_list.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+
+/** @brief Feed the trace to the buffer in console-sized chunks. */
+template <typename T>
+static void feed(T& buf, const std::string& trace)
+{
+    constexpr size_t chunk = 128;
+    for (size_t pos = 0; pos < trace.size(); pos += chunk)
+    {
+        buf.append(trace.data() + pos, std::min(chunk, trace.size() - pos));
+    }
+}
+
+/** @brief Sum of message sizes, used to walk the buffer as save() does. */
+template <typename T>
+static size_t walk(const T& buf)
+{
+    size_t total = 0;
+    for (const auto& msg : buf)
+    {
+        total += msg.text.size();
+    }
+    return total;
+}
+
+template <typename T>
+static void run(const char* name, size_t lines, const std::string& trace)
+{
+    const size_t liveBefore = resetAllocStats().live;
+    T buf(lines, 0);
+    feed(buf, trace);
+    const AllocStats heap = resetAllocStats();
+
+    const double tmAppend = measure([&]() { feed(buf, trace); });
+    size_t total = 0;
+    const double tmWalk = measure([&]() { total = walk(buf); });
+
+    printf("%-5s %7zu lines: %7zu allocs, %9zu bytes in use, "
+           "append %6.1f MiB/s, iterate %7.1f MiB/s\n",
+           name, lines, heap.count, heap.live - liveBefore,
+           trace.size() / tmAppend / (1024 * 1024),
+           total / tmWalk / (1024 * 1024));
+}
+
+/**
+ * @brief Feed the output without EOL, e.g. binary data or a hex dump, once.
+ *
+ * @param[in] name name of the implementation
+ * @param[in] output console output
+ * @param[in] args arguments of the buffer constructor
+ */
+template <typename T, typename... Args>
+static void runNoEol(const char* name, const std::string& output,
+                     Args... args)
+{
+    const size_t liveBefore = resetAllocStats().live;
+    T buf(args...);
+    const double tm = measure([&]() { feed(buf, output); }, 1);
+    const AllocStats heap = resetAllocStats();
+
+    printf("%-11s %zu MiB without EOL: %7zu allocs, %9zu bytes in use, "
+           "append %6.1f MiB/s\n",
+           name, output.size() / (1024 * 1024), heap.count,
+           heap.live - liveBefore, output.size() / tm / (1024 * 1024));
+}
+
+/**
+ * @brief Measure recovery of the buffer placed in the ring file.
+ *
+ * @param[in] maxBytes max size of stored messages
+ * @param[in] trace console output
+ */
+static void runRing(size_t maxBytes, const std::string& trace)
+{
+    const char* path = "/tmp/log_buffer_bench.ring";
+    unlink(path);
+    const double tmAppend = measure(
+        [&]() {
+            LogBuffer buf(0, 0, maxBytes);
+            buf.persist(path);
+            feed(buf, trace);
+        },
+        1);
+
+    size_t recovered = 0;
+    const double tmRecover = measure([&]() {
+        LogBuffer buf(0, 0, maxBytes);
+        recovered = buf.persist(path);
+    });
+    unlink(path);
+
+    printf("ring file %5zu KiB: append %6.1f MiB/s, recovered %zu messages "
+           "in %.3f ms\n",
+           maxBytes / 1024, trace.size() / tmAppend / (1024 * 1024), recovered,
+           tmRecover * 1e3);
+}
+
+int main()
+{
+    for (size_t lines : {3000, 100000})
+    {
+        const std::string trace = bootTrace(lines * 2);
+        run<LogBufferList>("list", lines, trace);
+        run<LogBuffer>("ring", lines, trace);
+    }
+
+    std::string output(64 * 1024 * 1024, '\0');
+    for (size_t i = 0; i < output.size(); ++i)
+    {
+        output[i] = "0123456789abcdef"[(i * 7 + i / 16) % 16];
+    }
+    runNoEol<LogBufferList>("list", output, 3000, 0);
+    runNoEol<LogBuffer>("ring", output, 3000, 0);
+    runNoEol<LogBuffer>("ring, 4 KiB", output, 3000, 0, 0, 4096);
+
+    const std::string trace = bootTrace(100000);
+    for (size_t maxBytes : {256 * 1024, 4 * 1024 * 1024})
+    {
+        runRing(maxBytes, trace);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "log_reader.hpp"
+#include "zlib_block_file.hpp"
+#include "zlib_file.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/** @brief Directory with the archive. */
+static const fs::path archiveDir = "/tmp/log_reader_bench";
+/** @brief Number of files in the archive. */
+static constexpr size_t filesNum = 300;
+/** @brief Number of records in a file (default BUF_MAXSIZE). */
+static constexpr size_t fileLines = 3000;
+/** @brief Number of instances that share the directory. */
+static constexpr size_t instancesNum = 4;
+/** @brief Time stamp of the first record in milliseconds. */
+static constexpr int64_t baseTime = 1'600'000'000'000;
+/** @brief Interval between records in milliseconds. */
+static constexpr int64_t recordStep = 10;
+
+/**
+ * @brief Write the archive: files of all instances, each one covers the next
+ *        period of time.
+ *
+ * @param[in] blockSize size of seekable blocks, 0 for plain gzip
+ */
+static void writeArchive(size_t blockSize)
+{
+    fs::remove_all(archiveDir);
+    fs::create_directories(archiveDir);
+
+    std::vector<std::string> lines;
+    const std::string trace = bootTrace(fileLines);
+    for (size_t pos = 0; pos < trace.size();)
+    {
+        const size_t eol = trace.find("\r\n", pos);
+        lines.push_back(trace.substr(pos, eol - pos));
+        pos = eol + 2;
+    }
+
+    int64_t time = baseTime;
+    for (size_t i = 0; i < filesNum; ++i)
+    {
+        const std::string name = "host" + std::to_string(i % instancesNum) +
+                                 "_20991231_235959_" + std::to_string(i) +
+                                 ".log.gz";
+        std::unique_ptr<LogWriter> file;
+        if (blockSize)
+        {
+            file = std::make_unique<ZlibBlockFile>(
+                archiveDir / name, Z_DEFAULT_COMPRESSION, blockSize);
+        }
+        else
+        {
+            file = std::make_unique<ZlibFile>(archiveDir / name);
+        }
+        for (const std::string& line : lines)
+        {
+            const timespec ts{static_cast<time_t>(time / 1000),
+                              static_cast<long>(time % 1000) * 1'000'000};
+            file->write(ts, line);
+            time += recordStep;
+        }
+        file->close();
+    }
+}
+
+/**
+ * @brief Run the query.
+ *
+ * @param[in] query filter of log records
+ *
+ * @return number of records
+ */
+static size_t run(const LogReader::Query& query)
+{
+    size_t count = 0;
+    LogReader(archiveDir, query).read(
+        [&count](const LogReader::Record&) { ++count; });
+    return count;
+}
+
+/**
+ * @brief Benchmark entry point.
+ */
+int main()
+{
+    const size_t cpus = std::max(std::thread::hardware_concurrency(), 1U);
+    printf("%zu files, %zu lines each, %zu CPUs\n", filesNum, fileLines, cpus);
+    const int64_t lastTime =
+        baseTime + static_cast<int64_t>(filesNum * fileLines) * recordStep;
+
+    std::vector<size_t> jobsNum{1};
+    if (cpus > 1)
+    {
+        jobsNum.push_back(cpus);
+    }
+
+    for (size_t blockSize : {0, 256 * 1024})
+    {
+        writeArchive(blockSize);
+        printf("%s:\n", blockSize ? "256 KiB blocks" : "gzip stream");
+        for (size_t jobs : jobsNum)
+        {
+            LogReader::Query query;
+            query.jobs = jobs;
+            size_t count = 0;
+            const double all = measure([&]() { count = run(query); }, 3);
+            printf("  %zu jobs: all %zu records %7.1f ms", jobs, count,
+                   all * 1e3);
+
+            query.pattern = "nvme[0-9]n1";
+            const double grep = measure([&]() { count = run(query); }, 3);
+            printf(", grep %zu %7.1f ms", count, grep * 1e3);
+
+            query.pattern.clear();
+            query.since = lastTime - 5 * 60 * 1000;
+            const double tail = measure([&]() { count = run(query); }, 3);
+            printf(", last 5 min %zu %7.1f ms\n", count, tail * 1e3);
+        }
+    }
+    fs::remove_all(archiveDir);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "log_buffer.hpp"
+#include "log_writer.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <list>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** @brief Number of simulated consoles. */
+static constexpr size_t consolesNum = 16;
+/** @brief Size of a single console read. */
+static constexpr size_t chunkSize = 4096;
+/** @brief Max number of messages in the log buffer (default BUF_MAXSIZE). */
+static constexpr size_t bufMaxSize = 3000;
+
+/**
+ * @struct Console
+ * @brief Simulated console: log buffer flushed to a file as it fills.
+ */
+struct Console
+{
+    explicit Console(size_t id) :
+        buffer(bufMaxSize, 0),
+        fileName("/tmp/shard_bench_" + std::to_string(id) + ".log.gz")
+    {
+        buffer.setFullHandler([this]() { save(); });
+    }
+
+    /** @brief Save and clear the buffer, as the flush of a full buffer. */
+    void save()
+    {
+        auto file = LogWriter::create(Compression::zlib, 0, fileName);
+        for (const auto& msg : buffer)
+        {
+            file->write(msg.timeStamp, msg.text);
+        }
+        file->close();
+        buffer.clear();
+    }
+
+    LogBuffer buffer;
+    std::string fileName;
+};
+
+/**
+ * @brief Replay the boot storm: all consoles receive the trace at once, the
+ *        consoles are spread over the worker threads, each thread serves its
+ *        consoles in turn, one read at a time.
+ *
+ * @param[in] trace console output of a single host
+ * @param[in] workers number of worker threads
+ */
+static void bootStorm(const std::string& trace, size_t workers)
+{
+    std::list<Console> consoles;
+    for (size_t i = 0; i < consolesNum; ++i)
+    {
+        consoles.emplace_back(i);
+    }
+    std::vector<std::vector<Console*>> shards(workers);
+    size_t index = 0;
+    for (Console& console : consoles)
+    {
+        shards[index++ % workers].push_back(&console);
+    }
+
+    std::vector<std::thread> threads;
+    for (const auto& shard : shards)
+    {
+        threads.emplace_back([&trace, &shard]() {
+            for (size_t pos = 0; pos < trace.size(); pos += chunkSize)
+            {
+                const size_t len = std::min(chunkSize, trace.size() - pos);
+                for (Console* console : shard)
+                {
+                    console->buffer.append(trace.data() + pos, len);
+                }
+            }
+            for (Console* console : shard)
+            {
+                console->save();
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (const Console& console : consoles)
+    {
+        unlink(console.fileName.c_str());
+    }
+}
+
+/**
+ * @brief Benchmark entry point.
+ *        Usage: shard_bench [LINES], where LINES is the number of boot log
+ *        lines printed by each host, 100000 by default.
+ */
+int main(int argc, char* argv[])
+{
+    const size_t lines = argc > 1 ? strtoul(argv[1], nullptr, 0) : 100'000;
+    const std::string trace = bootTrace(lines);
+    const double total = static_cast<double>(trace.size()) * consolesNum;
+    printf("%zu consoles, %zu bytes each, %u CPUs\n", consolesNum,
+           trace.size(), std::thread::hardware_concurrency());
+
+    double base = 0;
+    for (size_t workers : {1, 2, 4, 8})
+    {
+        const double tm = measure([&]() { bootStorm(trace, workers); }, 3);
+        if (workers == 1)
+        {
+            base = tm;
+        }
+        printf("%zu workers: %8.1f ms, %6.1f MiB/s, speedup %4.2f\n", workers,
+               tm * 1e3, total / tm / (1024 * 1024), base / tm);
+    }
+
+    return EXIT_SUCCESS;
+}
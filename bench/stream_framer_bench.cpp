@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "stream_framer.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <vector>
+
+/** @brief Size of the console read chunk previously used. */
+static constexpr size_t readSize = 128;
+/** @brief Max size of a datagram. */
+static constexpr size_t maxDatagramSize = 1024;
+
+/** @brief Counters of the sender and receiver. */
+struct Counters
+{
+    size_t syscalls = 0;
+    size_t records = 0;
+};
+
+/** @brief Receive all queued datagrams. */
+static void drain(int fd, Counters& counters)
+{
+    char buf[maxDatagramSize];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+    {
+        ++counters.records;
+    }
+}
+
+/** @brief Send each read chunk as a datagram, as it was done before. */
+static void sendChunks(int wr, int rd, const std::string& cycle,
+                       Counters& counters)
+{
+    for (size_t pos = 0; pos < cycle.size(); pos += readSize)
+    {
+        const size_t len = std::min(readSize, cycle.size() - pos);
+        if (send(wr, cycle.data() + pos, len, 0) != static_cast<ssize_t>(len))
+        {
+            abort();
+        }
+        ++counters.syscalls;
+    }
+    drain(rd, counters);
+}
+
+/** @brief Send line-aligned datagrams of the whole cycle at once. */
+static void sendFramed(int wr, int rd, const std::string& cycle,
+                       StreamFramer& framer, Counters& counters)
+{
+    framer.append(cycle.data(), cycle.size());
+    std::vector<mmsghdr> messages(framer.size());
+    std::vector<iovec> vectors(framer.size());
+    for (size_t i = 0; i < framer.size(); ++i)
+    {
+        vectors[i].iov_base = const_cast<char*>(framer[i].data());
+        vectors[i].iov_len = framer[i].size();
+        messages[i].msg_hdr = msghdr{};
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    size_t sent = 0;
+    while (sent < messages.size())
+    {
+        const int rc = sendmmsg(wr, messages.data() + sent,
+                                messages.size() - sent, 0);
+        if (rc <= 0)
+        {
+            abort();
+        }
+        sent += rc;
+        ++counters.syscalls;
+    }
+    framer.clear();
+    drain(rd, counters);
+}
+
+template <typename F>
+static void run(const char* name, const std::string& trace, size_t cycleSize,
+                F&& send)
+{
+    Counters counters;
+    const double tm = measure(
+        [&]() {
+            counters = Counters();
+            for (size_t pos = 0; pos < trace.size(); pos += cycleSize)
+            {
+                send(trace.substr(pos, cycleSize), counters);
+            }
+        },
+        1);
+    printf("%-7s cycle %6zu: %8.1f MiB/s, %6.2f syscalls/KiB, "
+           "%7zu records\n",
+           name, cycleSize, trace.size() / tm / (1024 * 1024),
+           counters.syscalls * 1024.0 / trace.size(), counters.records);
+}
+
+int main()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) == -1)
+    {
+        return EXIT_FAILURE;
+    }
+    const int bufSize = 4 * 1024 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+
+    const std::string trace = bootTrace(100'000);
+    for (const size_t cycle : {128, 4 * 1024, 64 * 1024})
+    {
+        run("chunks", trace, cycle,
+            [&fds](const std::string& data, Counters& counters) {
+                sendChunks(fds[1], fds[0], data, counters);
+            });
+        StreamFramer lines(maxDatagramSize, false);
+        run("lines", trace, cycle,
+            [&fds, &lines](const std::string& data, Counters& counters) {
+                sendFramed(fds[1], fds[0], data, lines, counters);
+            });
+        StreamFramer packed(maxDatagramSize, true);
+        run("packed", trace, cycle,
+            [&fds, &packed](const std::string& data, Counters& counters) {
+                sendFramed(fds[1], fds[0], data, packed, counters);
+            });
+    }
+
+    close(fds[0]);
+    close(fds[1]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "time_formatter.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+/** @brief Number of formatted time stamps per measurement. */
+static constexpr size_t linesNum = 1'000'000;
+
+/**
+ * @brief Run benchmark with the specified rate of messages.
+ *
+ * @param[in] rate number of messages per second
+ */
+static void run(size_t rate)
+{
+    timespec start;
+    clock_gettime(CLOCK_REALTIME, &start);
+    const long step = 1'000'000'000 / static_cast<long>(rate);
+
+    // Per-message localtime_r and snprintf, previously used by ZlibFile
+    size_t sum = 0;
+    const double direct = measure([&]() {
+        timespec ts = start;
+        char buf[128];
+        for (size_t i = 0; i < linesNum; ++i)
+        {
+            tm tmLocal;
+            localtime_r(&ts.tv_sec, &tmLocal);
+            sum += static_cast<size_t>(snprintf(
+                buf, sizeof(buf),
+                "[ %i-%02i-%02iT%02i:%02i:%02i.%03ld%+03ld:%02ld ] ",
+                tmLocal.tm_year + 1900, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+                tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec,
+                ts.tv_nsec / 1'000'000, tmLocal.tm_gmtoff / (60 * 60),
+                labs(tmLocal.tm_gmtoff % (60 * 60)) / 60));
+            ts.tv_nsec += step;
+            if (ts.tv_nsec >= 1'000'000'000)
+            {
+                ts.tv_nsec -= 1'000'000'000;
+                ++ts.tv_sec;
+            }
+        }
+    });
+
+    const double cached = measure([&]() {
+        TimeFormatter formatter;
+        timespec ts = start;
+        for (size_t i = 0; i < linesNum; ++i)
+        {
+            sum += formatter.format(ts).length();
+            ts.tv_nsec += step;
+            if (ts.tv_nsec >= 1'000'000'000)
+            {
+                ts.tv_nsec -= 1'000'000'000;
+                ++ts.tv_sec;
+            }
+        }
+    });
+
+    printf("%8zu msg/s: direct %6.1f ns/line, cached %6.1f ns/line (%zu)\n",
+           rate, direct * 1e9 / linesNum, cached * 1e9 / linesNum, sum);
+}
+
+/** @brief Benchmark entry point. */
+int main()
+{
+    for (size_t rate : {1, 100, 10'000, 1'000'000})
+    {
+        run(rate);
+    }
+    return EXIT_SUCCESS;
+}
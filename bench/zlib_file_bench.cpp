@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "log_buffer.hpp"
+#include "time_formatter.hpp"
+#include "zlib_block_file.hpp"
+#include "zlib_file.hpp"
+
+#include <zlib.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+/** @brief Path to the output file. */
+static const char* outFile = "/tmp/zlib_file_bench.log.gz";
+
+/** @brief Save buffer with gz* calls per record, as ZlibFile did before. */
+static void saveGzio(const LogBuffer& buf)
+{
+    gzFile fd = gzopen(outFile, "w");
+    TimeFormatter formatter;
+    for (const auto& msg : buf)
+    {
+        const std::string_view prefix = formatter.format(msg.timeStamp);
+        gzprintf(fd, "%.*s", static_cast<int>(prefix.size()), prefix.data());
+        gzwrite(fd, msg.text.data(), static_cast<unsigned>(msg.text.size()));
+        gzputc(fd, '\n');
+    }
+    gzclose_w(fd);
+}
+
+/** @brief Save buffer with ZlibFile. */
+static void saveStaged(const LogBuffer& buf)
+{
+    ZlibFile file(outFile);
+    for (const auto& msg : buf)
+    {
+        file.write(msg.timeStamp, msg.text);
+    }
+    file.close();
+}
+
+/** @brief Save buffer with ZlibBlockFile. */
+static void saveBlocks(const LogBuffer& buf, size_t blockSize)
+{
+    ZlibBlockFile file(outFile, Z_DEFAULT_COMPRESSION, blockSize);
+    for (const auto& msg : buf)
+    {
+        file.write(msg.timeStamp, msg.text);
+    }
+    file.close();
+}
+
+/** @brief Get size of the output file. */
+static size_t outSize()
+{
+    struct stat st;
+    return stat(outFile, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+/** @brief Read the whole file to get its tail, as zcat does. */
+static size_t readTailGzio()
+{
+    gzFile fd = gzopen(outFile, "r");
+    char buf[64 * 1024];
+    size_t total = 0;
+    int len;
+    while ((len = gzread(fd, buf, sizeof(buf))) > 0)
+    {
+        total += static_cast<size_t>(len);
+    }
+    gzclose(fd);
+    return total;
+}
+
+/** @brief Read the block with the last lines using the index. */
+static size_t readTailIndexed(size_t lines)
+{
+    const auto index = ZlibBlockFile::readIndex(outFile);
+    const uint64_t from = index.back().line - lines;
+    auto block = index.end() - 2;
+    while (block != index.begin() && block->line > from)
+    {
+        --block;
+    }
+    return ZlibBlockFile::readBlocks(outFile, *block, index.back()).size();
+}
+
+/** @brief Benchmark entry point. */
+int main()
+{
+    for (size_t lines : {3000, 100000})
+    {
+        const std::string trace = bootTrace(lines);
+        LogBuffer buf(lines, 0);
+        buf.append(trace.data(), trace.size());
+
+        const double gzio = measure([&]() { saveGzio(buf); });
+        const double staged = measure([&]() { saveStaged(buf); });
+        printf("%6zu lines: gzio %6.1f MiB/s (%6.2f ms), "
+               "staged %6.1f MiB/s (%6.2f ms)\n",
+               lines, trace.size() / gzio / (1024 * 1024), gzio * 1e3,
+               trace.size() / staged / (1024 * 1024), staged * 1e3);
+    }
+
+    // Read the last 1000 lines of a large log
+    const std::string trace = bootTrace(100000);
+    LogBuffer buf(100000, 0);
+    buf.append(trace.data(), trace.size());
+    saveStaged(buf);
+    const size_t plainSize = outSize();
+    const double gzio = measure([&]() { readTailGzio(); });
+    printf("tail of %zu KiB: single stream %6.2f ms\n", trace.size() / 1024,
+           gzio * 1e3);
+    for (size_t blockSize : {16 * 1024, 64 * 1024, 256 * 1024})
+    {
+        const double save = measure([&]() { saveBlocks(buf, blockSize); });
+        const double tail = measure([&]() { readTailIndexed(1000); });
+        printf("%3zu KiB blocks: save %6.2f ms, size %+5.1f%%, "
+               "tail %6.2f ms\n",
+               blockSize / 1024, save * 1e3,
+               (static_cast<double>(outSize()) / plainSize - 1) * 100,
+               tail * 1e3);
+    }
+
+    unlink(outFile);
+    return EXIT_SUCCESS;
+}
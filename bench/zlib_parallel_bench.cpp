@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "bench.hpp"
+#include "log_buffer.hpp"
+#include "log_writer.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+/** @brief Path to the output file. */
+static const char* outFile = "/tmp/zlib_parallel_bench.log.gz";
+
+/** @brief Save buffer with the specified number of threads. */
+static void save(const LogBuffer& buf, size_t threads)
+{
+    auto file = LogWriter::create(Compression::zlib, 0, outFile, threads);
+    for (const auto& msg : buf)
+    {
+        file->write(msg.timeStamp, msg.text);
+    }
+    file->close();
+}
+
+/**
+ * @brief Benchmark entry point.
+ *        Usage: zlib_parallel_bench [FILE], where FILE is a recorded console
+ *        output, by default a synthetic boot log is used.
+ */
+int main(int argc, char* argv[])
+{
+    std::string trace;
+    if (argc > 1)
+    {
+        std::ifstream file(argv[1], std::ios::binary);
+        trace.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    else
+    {
+        trace = bootTrace(1'000'000);
+    }
+
+    LogBuffer buf(0, 0);
+    buf.append(trace.data(), trace.size());
+    printf("%zu messages, %zu bytes, %u CPUs\n", buf.size(), trace.size(),
+           std::thread::hardware_concurrency());
+
+    double base = 0;
+    for (size_t threads : {1, 2, 4})
+    {
+        const double tm = measure([&]() { save(buf, threads); }, 3);
+        if (threads == 1)
+        {
+            base = tm;
+        }
+        struct stat st;
+        stat(outFile, &st);
+        printf("%zu threads: %8.1f ms, %6.1f MiB/s, speedup %4.2f, "
+               "ratio %5.2f\n",
+               threads, tm * 1e3, trace.size() / tm / (1024 * 1024),
+               base / tm, static_cast<double>(trace.size()) / st.st_size);
+    }
+
+    unlink(outFile);
+    return EXIT_SUCCESS;
+}
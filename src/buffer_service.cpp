@@ -5,10 +5,38 @@
 
 #include <phosphor-logging/log.hpp>
 
-#include <vector>
+#include <cctype>
+#include <cerrno>
+#include <system_error>
 
 using namespace phosphor::logging;
 
+/** @brief D-Bus interface, also the base of the service name. */
+static constexpr char dbusInterface[] = "xyz.openbmc_project.HostLogger";
+/** @brief Base of the D-Bus object path. */
+static constexpr char dbusObject[] = "/xyz/openbmc_project/HostLogger";
+
+/**
+ * @brief Convert the socket id to an element of D-Bus names and paths.
+ *
+ * @param[in] socketId socket id of the host console
+ *
+ * @return element with letters, digits and underscores only
+ */
+static std::string dbusElement(const char* socketId)
+{
+    std::string element;
+    for (const char* ch = socketId; *ch; ++ch)
+    {
+        element += isalnum(static_cast<unsigned char>(*ch)) ? *ch : '_';
+    }
+    if (isdigit(static_cast<unsigned char>(element[0])))
+    {
+        element.insert(0, 1, '_');
+    }
+    return element;
+}
+
 // clang-format off
 /** @brief Host state monitor properties.
  *  Used for automatic flushing the log buffer to the persistent file.
@@ -35,18 +63,79 @@ BufferService::BufferService(const Config& config, DbusLoop& dbusLoop,
                              HostConsole& hostConsole, LogBuffer& logBuffer,
                              FileStorage& fileStorage) :
     config(config), dbusLoop(&dbusLoop), hostConsole(&hostConsole),
-    logBuffer(&logBuffer), fileStorage(&fileStorage)
-{}
+    consoleReader(hostConsole, config.readMaxSize), logBuffer(&logBuffer),
+    fileStorage(&fileStorage)
+{
+    if (config.mode == Mode::bothMode)
+    {
+        streamSink = std::make_unique<StreamSink>(config, dbusLoop);
+    }
+}
 
 void BufferService::run()
+{
+    start();
+    const int rc = dbusLoop->run();
+    finish();
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Error in event loop");
+    }
+}
+
+void BufferService::start()
 {
     if (config.bufFlushFull)
     {
         logBuffer->setFullHandler([this]() { this->flush(); });
     }
 
+    if (streamSink)
+    {
+        // Console output is split into lines once and shared with the stream
+        streamSink->start();
+        logBuffer->setPartHandler(
+            [this](const char* text, size_t len, bool eol) {
+                this->streamSink->addPart(text, len, eol);
+            });
+    }
+
     hostConsole->connect();
 
+    if (config.flushAsync)
+    {
+        flushWorker = std::make_unique<FlushWorker>(*fileStorage,
+                                                    config.flushQueue);
+        dbusLoop->addIoHandler(*flushWorker,
+                               [this]() { this->flushComplete(); });
+    }
+
+    if (config.flushIncremental)
+    {
+        // Messages recovered from the previous run replace its file
+        ingestWriter =
+            std::make_unique<IngestWriter>(*fileStorage, !logBuffer->empty());
+        for (const auto& msg : *logBuffer)
+        {
+            ingestWriter->write(msg);
+        }
+        logBuffer->setMessageHandler([this](const LogBuffer::Message& msg) {
+            this->ingestWriter->write(msg);
+        });
+        if (config.syncInterval)
+        {
+            dbusLoop->addTimerHandler(config.syncInterval * 1'000'000,
+                                      [this]() { this->ingestWriter->sync(); });
+        }
+    }
+
+    if (*config.stageDir && config.stageInterval)
+    {
+        dbusLoop->addTimerHandler(config.stageInterval * 1'000'000,
+                                  [this]() { this->commitStaged(); });
+    }
+
     // Add SIGUSR1 signal handler for manual flushing
     dbusLoop->addSignalHandler(SIGUSR1, [this]() { this->flush(); });
     // Add SIGTERM signal handler for service shutdown
@@ -62,6 +151,8 @@ void BufferService::run()
                                      [this]() { this->flush(); });
     }
 
+    addDbusObject();
+
     if (!*config.hostState && !config.bufFlushFull)
     {
         log<level::WARNING>("Automatic flush disabled");
@@ -71,21 +162,57 @@ void BufferService::run()
         "Initialization complete", entry("SocketId=%s", config.socketId),
         entry("BufMaxSize=%lu", config.bufMaxSize),
         entry("BufMaxTime=%lu", config.bufMaxTime),
+        entry("BufMaxBytes=%lu", config.bufMaxBytes),
+        entry("BufMaxLine=%lu", config.bufMaxLine),
+        entry("BufRingDir=%s", config.bufRingDir),
         entry("BufFlushFull=%s", config.bufFlushFull ? "y" : "n"),
         entry("HostState=%s", config.hostState),
         entry("OutDir=%s", config.outDir),
-        entry("MaxFiles=%lu", config.maxFiles));
+        entry("MaxFiles=%lu", config.maxFiles),
+        entry("MaxBytes=%lu", config.maxBytes),
+        entry("StageDir=%s", config.stageDir),
+        entry("StageInterval=%lu", config.stageInterval),
+        entry("StageBytes=%lu", config.stageBytes),
+        entry("FlushAsync=%s", config.flushAsync ? "y" : "n"),
+        entry("FlushQueue=%lu", config.flushQueue),
+        entry("FlushIncremental=%s", config.flushIncremental ? "y" : "n"),
+        entry("SyncInterval=%lu", config.syncInterval),
+        entry("FileExt=%s", LogWriter::extension(config.compression)),
+        entry("CompressionLevel=%lu", config.compressionLevel),
+        entry("SaveThreads=%lu", config.saveThreads),
+        entry("BlockSize=%lu", config.blockSize),
+        entry("ReadMaxSize=%lu", config.readMaxSize),
+        entry("Stream=%s", streamSink ? config.streamDestination : ""));
+}
 
-    // Run D-Bus event loop
-    const int rc = dbusLoop->run();
+void BufferService::finish()
+{
+    if (streamSink)
+    {
+        streamSink->stop();
+    }
+    const ConsoleReader::Stats& stats = consoleReader.stats();
+    log<level::INFO>("Console read statistics",
+                     entry("Syscalls=%llu", stats.syscalls),
+                     entry("Reads=%llu", stats.reads),
+                     entry("Bytes=%llu", stats.bytes));
+    log<level::INFO>("Log buffer statistics",
+                     entry("Messages=%lu", logBuffer->size()),
+                     entry("Usage=%lu", logBuffer->usage()),
+                     entry("Capacity=%lu", logBuffer->capacity()));
     if (!logBuffer->empty())
     {
         flush();
     }
-    if (rc < 0)
+    if (flushWorker)
     {
-        std::error_code ec(-rc, std::generic_category());
-        throw std::system_error(ec, "Error in event loop");
+        flushWorker->stop();
+        flushComplete();
+    }
+    // Staged files don't survive the reboot
+    if (*config.stageDir)
+    {
+        commitStaged();
     }
 }
 
@@ -96,14 +223,100 @@ void BufferService::flush()
         log<level::INFO>("Ignore flush: buffer is empty");
         return;
     }
+    log<level::DEBUG>("Flush log buffer",
+                      entry("Messages=%lu", logBuffer->size()),
+                      entry("Usage=%lu", logBuffer->usage()),
+                      entry("Capacity=%lu", logBuffer->capacity()));
+    if (flushWorker)
+    {
+        // Swap out the buffer, the file will be saved in background
+        if (flushWorker->submit(*logBuffer))
+        {
+            ++flushSubmitted;
+        }
+        return;
+    }
     try
     {
-        const std::string fileName = fileStorage->save(*logBuffer);
-        logBuffer->clear();
+        save();
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>(ex.what());
+    }
+    if (fileStorage->stageFull())
+    {
+        commitStaged();
+    }
+}
+
+void BufferService::flushMethod(const DbusLoop::Reply& reply)
+{
+    if (flushWorker)
+    {
+        // The file is saved and committed in background, snapshots are
+        // saved in order, so the reply is sent after the previous ones
+        if (!flushWorker->submit(*logBuffer, true))
+        {
+            throw std::system_error(EBUSY, std::generic_category(),
+                                    "Flush queue is full");
+        }
+        flushReplies.emplace_back(++flushSubmitted, reply);
+        return;
+    }
+    const std::string fileName = logBuffer->empty() ? std::string() : save();
+    reply(fileStorage->commitFile(fileName), std::string());
+}
+
+std::string BufferService::save()
+{
+    const std::string fileName = ingestWriter
+                                     ? ingestWriter->finalize(*logBuffer)
+                                     : fileStorage->save(*logBuffer);
+    logBuffer->clear();
+
+    std::string msg = "Host logs flushed to ";
+    msg += fileName;
+    log<level::INFO>(msg.c_str());
+
+    return fileName;
+}
+
+void BufferService::flushComplete()
+{
+    for (const auto& result : flushWorker->results())
+    {
+        ++flushCompleted;
+        if (!flushReplies.empty() &&
+            flushReplies.front().first == flushCompleted)
+        {
+            flushReplies.front().second(result.fileName, result.error);
+            flushReplies.pop_front();
+        }
+        if (result.error.empty())
+        {
+            std::string msg = "Host logs flushed to ";
+            msg += result.fileName;
+            log<level::INFO>(msg.c_str());
+        }
+        else
+        {
+            log<level::ERR>(result.error.c_str());
+        }
+    }
+}
 
-        std::string msg = "Host logs flushed to ";
-        msg += fileName;
-        log<level::INFO>(msg.c_str());
+void BufferService::commitStaged()
+{
+    try
+    {
+        const size_t committed = fileStorage->commitStaged();
+        if (committed)
+        {
+            log<level::INFO>("Staged host logs committed",
+                             entry("OutDir=%s", config.outDir),
+                             entry("Files=%lu", committed));
+        }
     }
     catch (const std::exception& ex)
     {
@@ -111,17 +324,56 @@ void BufferService::flush()
     }
 }
 
-void BufferService::readConsole()
+void BufferService::addDbusObject()
 {
-    constexpr size_t bufSize = 128; // enough for most line-oriented output
-    std::vector<char> bufData(bufSize);
-    char* buf = bufData.data();
+    const std::string element = dbusElement(config.socketId);
+    std::string name = dbusInterface;
+    std::string path = dbusObject;
+    if (!element.empty())
+    {
+        name += '.' + element;
+        path += '/' + element;
+    }
 
+    // Logs are collected without the interface, the signal still works
     try
     {
-        while (const size_t rsz = hostConsole->read(buf, bufSize))
+        DbusLoop::Methods methods;
+        methods["Flush"] = {"s", [this](const DbusLoop::Reply& reply) {
+                                this->flushMethod(reply);
+                            }};
+        methods["Snapshot"] = {"h", [this](const DbusLoop::Reply& reply) {
+                                   const int fd =
+                                       FileStorage::snapshot(*this->logBuffer);
+                                   reply(DbusLoop::UnixFd{fd}, std::string());
+                               }};
+        dbusLoop->addObject(path, dbusInterface, methods);
+        dbusLoop->requestName(name);
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::WARNING>("Unable to register D-Bus object",
+                            entry("Path=%s", path.c_str()),
+                            entry("Error=%s", ex.what()));
+    }
+}
+
+void BufferService::readConsole()
+{
+    try
+    {
+        std::string_view chunk;
+        while (!(chunk = consoleReader.read()).empty())
+        {
+            logBuffer->append(chunk.data(), chunk.size());
+        }
+        if (ingestWriter && !config.syncInterval)
+        {
+            ingestWriter->sync();
+        }
+        if (streamSink)
         {
-            logBuffer->append(buf, rsz);
+            streamSink->commit();
         }
     }
     catch (const std::system_error& ex)
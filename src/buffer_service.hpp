@@ -4,14 +4,22 @@
 #pragma once
 
 #include "config.hpp"
+#include "console_reader.hpp"
 #include "dbus_loop.hpp"
 #include "file_storage.hpp"
+#include "flush_worker.hpp"
 #include "host_console.hpp"
+#include "ingest_writer.hpp"
 #include "log_buffer.hpp"
 #include "service.hpp"
+#include "stream_sink.hpp"
 
 #include <sys/un.h>
 
+#include <deque>
+#include <memory>
+#include <utility>
+
 /**
  * @class BufferService
  * @brief Buffer based log service: watches for events and handles them.
@@ -44,18 +52,67 @@ class BufferService : public Service
      */
     void run() override;
 
+    /**
+     * @brief Register event handlers.
+     *
+     * @throw std::exception in case of errors
+     */
+    void start() override;
+
+    /**
+     * @brief Save the collected data after the event loop is stopped.
+     */
+    void finish() override;
+
   protected:
     /**
      * @brief Flush log buffer to a file.
      */
     virtual void flush();
 
+    /**
+     * @brief D-Bus method Flush: flush log buffer to a file and reply with
+     *        the path once the file is saved and committed to the output
+     *        directory, empty path if there was nothing to save.
+     *        In asynchronous flush mode the reply is sent by flushComplete.
+     *
+     * @param[in] reply sender of the reply
+     *
+     * @throw std::exception in case of errors
+     */
+    void flushMethod(const DbusLoop::Reply& reply);
+
     /**
      * @brief Read data from host console and perform actions according to
      * modes.
      */
     virtual void readConsole();
 
+    /**
+     * @brief Report results of background flush, reply to the Flush calls.
+     */
+    void flushComplete();
+
+    /**
+     * @brief Commit staged log files to the output directory.
+     */
+    void commitStaged();
+
+  private:
+    /**
+     * @brief Save log buffer to a file in the calling thread and clear it.
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return path to the saved file
+     */
+    std::string save();
+
+    /**
+     * @brief Register D-Bus object with the Flush and Snapshot methods.
+     */
+    void addDbusObject();
+
   private:
     /** @brief Service configuration. */
     const Config& config;
@@ -63,8 +120,22 @@ class BufferService : public Service
     DbusLoop* dbusLoop;
     /** @brief Host console connection. */
     HostConsole* hostConsole;
+    /** @brief Host console reader. */
+    ConsoleReader consoleReader;
     /** @brief Intermediate storage: container for parsed log messages. */
     LogBuffer* logBuffer;
     /** @brief Persistent storage. */
     FileStorage* fileStorage;
+    /** @brief Background saver, used in asynchronous flush mode. */
+    std::unique_ptr<FlushWorker> flushWorker;
+    /** @brief Number of snapshots submitted to the background saver. */
+    size_t flushSubmitted = 0;
+    /** @brief Number of snapshots saved by the background saver. */
+    size_t flushCompleted = 0;
+    /** @brief Flush calls waiting for the reply: snapshot number, reply. */
+    std::deque<std::pair<size_t, DbusLoop::Reply>> flushReplies;
+    /** @brief Log file writer, used in incremental flush mode. */
+    std::unique_ptr<IngestWriter> ingestWriter;
+    /** @brief Output of the log stream, used in buffer + stream mode. */
+    std::unique_ptr<StreamSink> streamSink;
 };
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "coarse_clock.hpp"
+
+#include <ctime>
+
+/** @brief Max difference between wall and anchored time, in nanoseconds. */
+static constexpr int64_t maxDrift = 1'000'000'000;
+
+/** @brief Read the clock, returns number of nanoseconds. */
+static int64_t readClock(clockid_t id)
+{
+    timespec ts;
+    clock_gettime(id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+int64_t CoarseClock::now()
+{
+    const int64_t real = readClock(CLOCK_REALTIME_COARSE);
+    const int64_t mono = readClock(CLOCK_MONOTONIC_COARSE);
+
+    int64_t current = anchorReal + (mono - anchorMono);
+    if (!anchorReal || current - real > maxDrift || real - current > maxDrift)
+    {
+        // First call or the system time has been set
+        anchorReal = real;
+        anchorMono = mono;
+        current = real;
+    }
+
+    return current;
+}
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @class CoarseClock
+ * @brief Cheap wall clock for stamping log messages.
+ *
+ * Time is read from the coarse clocks (served by vDSO without a system call).
+ * The wall time is anchored to the monotonic clock, so the intervals between
+ * messages are not affected by time adjustments, and re-anchored only if the
+ * system time has been set.
+ */
+class CoarseClock
+{
+  public:
+    /**
+     * @brief Get current time.
+     *
+     * @return number of nanoseconds since the Epoch
+     */
+    int64_t now();
+
+  private:
+    /** @brief Wall time of the anchor point, in nanoseconds. */
+    int64_t anchorReal = 0;
+    /** @brief Monotonic time of the anchor point, in nanoseconds. */
+    int64_t anchorMono = 0;
+};
@@ -8,6 +8,8 @@
 #include <algorithm>
 #include <climits>
 #include <cstring>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <string>
 
@@ -15,19 +17,47 @@ namespace
 {
 constexpr char bufferModeStr[] = "buffer";
 constexpr char streamModeStr[] = "stream";
+constexpr char bothModeStr[] = "both";
+constexpr char dropOldestStr[] = "drop-oldest";
+constexpr char dropNewestStr[] = "drop-newest";
+
+/** @brief Compression algorithms: name, max level, support flag.
+ *         Level is not used without compression, so it is not limited. */
+struct CompressionInfo
+{
+    const char* name;
+    Compression type;
+    size_t maxLevel;
+    bool supported;
+};
+constexpr CompressionInfo compressions[] = {
+    {"none", Compression::none, std::numeric_limits<size_t>::max(), true},
+    {"zlib", Compression::zlib, 9, true},
+#ifdef HAVE_ZSTD
+    {"zstd", Compression::zstd, 22, true},
+#else
+    {"zstd", Compression::zstd, 22, false},
+#endif
+#ifdef HAVE_LZ4
+    {"lz4", Compression::lz4, 12, true},
+#else
+    {"lz4", Compression::lz4, 12, false},
+#endif
+};
 } // namespace
 
 /**
- * @brief Set boolean value from environment variable.
+ * @brief Set boolean value from the parameter.
  *
- * @param[in] name name of environment variable
+ * @param[in] source source of parameters
+ * @param[in] name name of the parameter
  * @param[out] value value to set
  *
  * @throw std::invalid_argument in case of errors
  */
-static void safeSet(const char* name, bool& value)
+static void safeSet(const ConfigSource& source, const char* name, bool& value)
 {
-    const char* envVal = std::getenv(name);
+    const char* envVal = source(name);
     if (envVal)
     {
         if (strcmp(envVal, "true") == 0)
@@ -40,7 +70,7 @@ static void safeSet(const char* name, bool& value)
         }
         else
         {
-            std::string err = "Invalid value of environment variable ";
+            std::string err = "Invalid value of ";
             err += name;
             err += ": '";
             err += envVal;
@@ -51,16 +81,17 @@ static void safeSet(const char* name, bool& value)
 }
 
 /**
- * @brief Set unsigned numeric value from environment variable.
+ * @brief Set unsigned numeric value from the parameter.
  *
- * @param[in] name name of environment variable
+ * @param[in] source source of parameters
+ * @param[in] name name of the parameter
  * @param[out] value value to set
  *
  * @throw std::invalid_argument in case of errors
  */
-static void safeSet(const char* name, size_t& value)
+static void safeSet(const ConfigSource& source, const char* name, size_t& value)
 {
-    const char* envVal = std::getenv(name);
+    const char* envVal = source(name);
     if (envVal)
     {
         const size_t num = strtoul(envVal, nullptr, 0);
@@ -80,25 +111,31 @@ static void safeSet(const char* name, size_t& value)
 }
 
 /**
- * @brief Set string value from environment variable.
+ * @brief Set string value from the parameter.
  *
- * @param[in] name name of environment variable
+ * @param[in] source source of parameters
+ * @param[in] name name of the parameter
  * @param[out] value value to set
  */
-static void safeSet(const char* name, const char*& value)
+static void safeSet(const ConfigSource& source, const char* name,
+                    const char*& value)
 {
-    const char* envVal = std::getenv(name);
+    const char* envVal = source(name);
     if (envVal)
     {
         value = envVal;
     }
 }
 
-Config::Config()
+Config::Config() :
+    Config([](const char* name) -> const char* { return std::getenv(name); })
+{}
+
+Config::Config(const ConfigSource& source)
 {
-    safeSet("SOCKET_ID", socketId);
+    safeSet(source, "SOCKET_ID", socketId);
     const char* mode_str = bufferModeStr;
-    safeSet("MODE", mode_str);
+    safeSet(source, "MODE", mode_str);
     if (strcmp(mode_str, bufferModeStr) == 0)
     {
         mode = Mode::bufferMode;
@@ -107,36 +144,156 @@ Config::Config()
     {
         mode = Mode::streamMode;
     }
+    else if (strcmp(mode_str, bothModeStr) == 0)
+    {
+        mode = Mode::bothMode;
+    }
     else
     {
         throw std::invalid_argument(
-            "Invalid value for mode; expect either 'stream' or 'buffer'");
+            "Invalid value for mode; expect 'stream', 'buffer' or 'both'");
     }
 
-    if (mode == Mode::bufferMode)
+    // Console is read in all modes
+    safeSet(source, "READ_MAXSIZE", readMaxSize);
+    if (!readMaxSize)
     {
-        safeSet("BUF_MAXSIZE", bufMaxSize);
-        safeSet("BUF_MAXTIME", bufMaxTime);
-        safeSet("FLUSH_FULL", bufFlushFull);
-        safeSet("HOST_STATE", hostState);
-        safeSet("OUT_DIR", outDir);
-        safeSet("MAX_FILES", maxFiles);
+        throw std::invalid_argument("Invalid READ_MAXSIZE: must be > 0");
+    }
+
+    if (mode != Mode::streamMode)
+    {
+        safeSet(source, "BUF_MAXSIZE", bufMaxSize);
+        safeSet(source, "BUF_MAXTIME", bufMaxTime);
+        safeSet(source, "BUF_MAXBYTES", bufMaxBytes);
+        safeSet(source, "BUF_MAXLINE", bufMaxLine);
+        safeSet(source, "BUF_RING_DIR", bufRingDir);
+        safeSet(source, "FLUSH_FULL", bufFlushFull);
+        safeSet(source, "HOST_STATE", hostState);
+        safeSet(source, "OUT_DIR", outDir);
+        safeSet(source, "MAX_FILES", maxFiles);
+        safeSet(source, "MAX_BYTES", maxBytes);
+        safeSet(source, "STAGE_DIR", stageDir);
+        safeSet(source, "STAGE_INTERVAL", stageInterval);
+        safeSet(source, "STAGE_BYTES", stageBytes);
+        safeSet(source, "FLUSH_ASYNC", flushAsync);
+        safeSet(source, "FLUSH_QUEUE", flushQueue);
+        safeSet(source, "FLUSH_INCREMENTAL", flushIncremental);
+        safeSet(source, "SYNC_INTERVAL", syncInterval);
+        const char* compressionStr = "zlib";
+        safeSet(source, "COMPRESSION", compressionStr);
+        safeSet(source, "COMPRESSION_LEVEL", compressionLevel);
+        safeSet(source, "SAVE_THREADS", saveThreads);
+        safeSet(source, "BLOCK_SIZE", blockSize);
         // Validate parameters
-        if (bufFlushFull && !bufMaxSize && !bufMaxTime)
+        if (bufFlushFull && !bufMaxSize && !bufMaxTime && !bufMaxBytes)
         {
             throw std::invalid_argument("Flush policy is set to save the "
                                         "buffer as it fills, but buffer's "
                                         "limits are not defined");
         }
+        if (*bufRingDir && (*bufRingDir != '/' || !bufMaxBytes))
+        {
+            throw std::invalid_argument("Invalid BUF_RING_DIR: must be an "
+                                        "absolute path, BUF_MAXBYTES must be "
+                                        "defined");
+        }
+        if (*stageDir && *stageDir != '/')
+        {
+            throw std::invalid_argument(
+                "Invalid STAGE_DIR: must be an absolute path");
+        }
+        if (!flushQueue)
+        {
+            throw std::invalid_argument("Invalid FLUSH_QUEUE: must be > 0");
+        }
+        if (!saveThreads)
+        {
+            throw std::invalid_argument("Invalid SAVE_THREADS: must be > 0");
+        }
+        if (flushIncremental && flushAsync)
+        {
+            throw std::invalid_argument("Incremental and asynchronous flush "
+                                        "modes can not be combined");
+        }
+        // Messages are written to the file as they arrive, so the buffer is
+        // flushed as it fills instead of dropping the oldest messages
+        if (flushIncremental)
+        {
+            bufFlushFull = true;
+        }
+        const CompressionInfo* info = std::find_if(
+            std::begin(compressions), std::end(compressions),
+            [compressionStr](const CompressionInfo& ci) {
+                return strcmp(ci.name, compressionStr) == 0;
+            });
+        if (info == std::end(compressions))
+        {
+            throw std::invalid_argument(
+                "Invalid COMPRESSION: expected 'none', 'zlib', 'zstd' or "
+                "'lz4'");
+        }
+        if (!info->supported)
+        {
+            std::string err = "Invalid COMPRESSION: ";
+            err += compressionStr;
+            err += " support is not built in";
+            throw std::invalid_argument(err);
+        }
+        if (compressionLevel > info->maxLevel)
+        {
+            std::string err = "Invalid COMPRESSION_LEVEL: must be <= ";
+            err += std::to_string(info->maxLevel);
+            throw std::invalid_argument(err);
+        }
+        compression = info->type;
+        if (blockSize && compression != Compression::zlib)
+        {
+            throw std::invalid_argument(
+                "Invalid BLOCK_SIZE: requires zlib compression");
+        }
     }
-    else
+
+    if (mode != Mode::bufferMode)
     {
-        // mode == Mode::streamMode
-        safeSet("STREAM_DST", streamDestination);
+        safeSet(source, "STREAM_DST", streamDestination);
         // We need an extra +1 for null terminator.
         if (strlen(streamDestination) + 1 > sizeof(sockaddr_un::sun_path))
         {
             throw std::invalid_argument("Invalid STREAM_DST: too long");
         }
+        safeSet(source, "STREAM_PACK", streamPack);
+        safeSet(source, "STREAM_DATAGRAM_SIZE", streamDatagramSize);
+        if (!streamDatagramSize)
+        {
+            throw std::invalid_argument(
+                "Invalid STREAM_DATAGRAM_SIZE: must be > 0");
+        }
+        safeSet(source, "STREAM_TIMEOUT", streamTimeout);
+        safeSet(source, "STREAM_BACKLOG", streamBacklog);
+        const char* overflowStr = dropOldestStr;
+        safeSet(source, "STREAM_OVERFLOW", overflowStr);
+        if (strcmp(overflowStr, dropOldestStr) == 0)
+        {
+            streamOverflow = Overflow::dropOldest;
+        }
+        else if (strcmp(overflowStr, dropNewestStr) == 0)
+        {
+            streamOverflow = Overflow::dropNewest;
+        }
+        else
+        {
+            throw std::invalid_argument(
+                "Invalid STREAM_OVERFLOW: expect either 'drop-oldest' or "
+                "'drop-newest'");
+        }
+        safeSet(source, "STREAM_SPOOL", streamSpool);
+        safeSet(source, "STREAM_SPOOL_SIZE", streamSpoolSize);
+        safeSet(source, "STREAM_REPLAY_RATE", streamReplayRate);
+        if (!streamReplayRate)
+        {
+            throw std::invalid_argument(
+                "Invalid STREAM_REPLAY_RATE: must be > 0");
+        }
     }
 }
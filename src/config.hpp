@@ -4,13 +4,35 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
 
 enum class Mode
 {
     bufferMode,
-    streamMode
+    streamMode,
+    bothMode
 };
 
+enum class Compression
+{
+    none,
+    zlib,
+    zstd,
+    lz4
+};
+
+enum class Overflow
+{
+    dropOldest,
+    dropNewest
+};
+
+/**
+ * @brief Source of the configuration: returns value of the parameter by its
+ *        name or nullptr if the parameter is not set.
+ */
+using ConfigSource = std::function<const char*(const char*)>;
+
 /**
  * @struct Config
  * @brief Configuration of the service, initialized with default values.
@@ -24,18 +46,37 @@ struct Config
      */
     Config();
 
+    /**
+     * @brief Constructor: load configuration from the specified source.
+     *
+     * @param[in] source source of parameters, returned strings should outlive
+     *                   the configuration
+     *
+     * @throw std::invalid_argument invalid format in one of the parameters
+     */
+    explicit Config(const ConfigSource& source);
+
     /** The following configs are for both modes. */
     /** @brief Socket ID used for connection with host console. */
     const char* socketId = "";
     /** @brief The mode the service is in. */
     Mode mode = Mode::bufferMode;
 
-    /** The following configs are for buffer mode. */
+    /** The following configs are for buffer (or both) mode. */
     /** @brief Max number of messages stored inside intermediate buffer. */
     size_t bufMaxSize = 3000;
     /** @brief Max age of messages (in minutes) inside intermediate buffer. */
     size_t bufMaxTime = 0;
-    /** @brief Flag indicated we need to flush console buffer as it fills. */
+    /** @brief Max size of messages (in bytes) inside intermediate buffer. */
+    size_t bufMaxBytes = 0;
+    /** @brief Max length of a single message inside intermediate buffer. */
+    size_t bufMaxLine = 65536;
+    /** @brief Path to the directory for the buffer's ring file (tmpfs). */
+    const char* bufRingDir = "";
+    /**
+     * @brief Flag indicated we need to flush console buffer as it fills,
+     *        always set in incremental mode.
+     */
     bool bufFlushFull = false;
     /** @brief Path to D-Bus object that provides host's state information. */
     const char* hostState = "/xyz/openbmc_project/state/host0";
@@ -43,8 +84,50 @@ struct Config
     const char* outDir = "/var/lib/obmc/hostlogs";
     /** @brief Max number of log files in the output directory. */
     size_t maxFiles = 10;
+    /** @brief Max total size of log files (in bytes), 0 for unlimited. */
+    size_t maxBytes = 0;
+    /** @brief Path to the staging directory (tmpfs), empty to disable. */
+    const char* stageDir = "";
+    /** @brief Period (in seconds) of commits of staged files. */
+    size_t stageInterval = 600;
+    /** @brief Size of staged files (in bytes) to commit them earlier. */
+    size_t stageBytes = 1024 * 1024;
+    /** @brief Flag indicated we need to save files in background thread. */
+    bool flushAsync = false;
+    /** @brief Max number of buffer snapshots waiting to be saved. */
+    size_t flushQueue = 2;
+    /** @brief Flag indicated we need to compress messages as they arrive. */
+    bool flushIncremental = false;
+    /** @brief Period (in seconds) of checkpoints in incremental mode. */
+    size_t syncInterval = 10;
+    /** @brief Compression algorithm of log files. */
+    Compression compression = Compression::zlib;
+    /** @brief Compression level, 0 for the algorithm's default. */
+    size_t compressionLevel = 0;
+    /** @brief Number of threads used to compress log files. */
+    size_t saveThreads = 1;
+    /** @brief Size of seekable blocks (in bytes) of gzip files, 0=disabled. */
+    size_t blockSize = 0;
+    /** @brief Max size of the console read buffer in bytes. */
+    size_t readMaxSize = 64 * 1024;
 
-    /** The following configs are for stream mode. */
+    /** The following configs are for stream (or both) mode. */
     /** @brief Path to the unix socket that receives the log stream. */
     const char* streamDestination = "/run/rsyslog/console_input";
+    /** @brief Flag to pack several lines into one datagram. */
+    bool streamPack = true;
+    /** @brief Max size of a single datagram, in bytes. */
+    size_t streamDatagramSize = 1024;
+    /** @brief Timeout (in milliseconds) to send incomplete line. */
+    size_t streamTimeout = 100;
+    /** @brief Max size of data waiting to be sent, in bytes. */
+    size_t streamBacklog = 256 * 1024;
+    /** @brief What to drop if the backlog is full. */
+    Overflow streamOverflow = Overflow::dropOldest;
+    /** @brief Path to the spool file used while destination is down. */
+    const char* streamSpool = "";
+    /** @brief Max size of the text in the spool file, in bytes. */
+    size_t streamSpoolSize = 1024 * 1024;
+    /** @brief Rate (in bytes per second) to replay the spool file. */
+    size_t streamReplayRate = 64 * 1024;
 };
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "config_file.hpp"
+
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+
+/** @brief Whitespace characters trimmed around names and values. */
+static constexpr char spaces[] = " \t\r";
+
+/**
+ * @brief Remove leading and trailing whitespaces.
+ *
+ * @param[in] str string to trim
+ *
+ * @return trimmed string
+ */
+static std::string_view trim(std::string_view str)
+{
+    const size_t begin = str.find_first_not_of(spaces);
+    if (begin == std::string_view::npos)
+    {
+        return {};
+    }
+    const size_t end = str.find_last_not_of(spaces);
+    return str.substr(begin, end - begin + 1);
+}
+
+ConfigFile::ConfigFile(const std::string& path) : workerThreads(1)
+{
+    parse(path);
+    if (sections.empty())
+    {
+        throw std::invalid_argument("No console sections in " + path);
+    }
+
+    const auto workers = common.find("WORKERS");
+    if (workers != common.end())
+    {
+        const std::string& value = workers->second;
+        char* end = nullptr;
+        workerThreads = strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end || !isdigit(value.front()) ||
+            !workerThreads || workerThreads == ULONG_MAX)
+        {
+            throw std::invalid_argument("Invalid WORKERS: must be > 0");
+        }
+    }
+
+    configs.reserve(sections.size());
+    for (const auto& [name, section] : sections)
+    {
+        const ConfigSource source = [this, &section](const char* param)
+            -> const char* {
+            auto it = section.find(param);
+            if (it == section.end())
+            {
+                it = common.find(param);
+                if (it == common.end())
+                {
+                    return nullptr;
+                }
+            }
+            return it->second.c_str();
+        };
+        try
+        {
+            configs.emplace_back(source);
+        }
+        catch (const std::invalid_argument& ex)
+        {
+            throw std::invalid_argument("Section [" + name + "]: " +
+                                        ex.what());
+        }
+
+        // Each console must be served once
+        for (size_t i = 0; i + 1 < configs.size(); ++i)
+        {
+            if (strcmp(configs[i].socketId, configs.back().socketId) == 0)
+            {
+                throw std::invalid_argument("Section [" + name +
+                                            "]: duplicate SOCKET_ID");
+            }
+        }
+    }
+}
+
+const std::vector<Config>& ConfigFile::consoles() const
+{
+    return configs;
+}
+
+const std::string& ConfigFile::name(size_t index) const
+{
+    return std::next(sections.begin(), index)->first;
+}
+
+size_t ConfigFile::workers() const
+{
+    return workerThreads;
+}
+
+void ConfigFile::parse(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to open " + path);
+    }
+
+    Section* section = &common;
+    std::string line;
+    size_t lineNum = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNum;
+        const std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#')
+        {
+            continue;
+        }
+
+        std::string error;
+        if (text.front() == '[')
+        {
+            const std::string_view name =
+                text.back() == ']' ? trim(text.substr(1, text.size() - 2))
+                                   : std::string_view();
+            if (name.empty())
+            {
+                error = "invalid section name";
+            }
+            for (const auto& [other, params] : sections)
+            {
+                if (other == name)
+                {
+                    error = "duplicate section";
+                }
+            }
+            if (error.empty())
+            {
+                section = &sections.emplace_back(name, Section()).second;
+                continue;
+            }
+        }
+        else
+        {
+            const size_t eq = text.find('=');
+            const std::string_view name = trim(text.substr(0, eq));
+            if (eq == std::string_view::npos || name.empty())
+            {
+                error = "expected NAME=VALUE";
+            }
+            else
+            {
+                std::string_view value = trim(text.substr(eq + 1));
+                if (value.size() >= 2 && value.front() == '"' &&
+                    value.back() == '"')
+                {
+                    value = value.substr(1, value.size() - 2);
+                }
+                (*section)[std::string(name)] = value;
+                continue;
+            }
+        }
+
+        throw std::invalid_argument(path + ":" + std::to_string(lineNum) +
+                                    ": " + error);
+    }
+    if (file.bad())
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to read " + path);
+    }
+}
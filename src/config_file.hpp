@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "config.hpp"
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @class ConfigFile
+ * @brief Configuration of several consoles served by a single process.
+ *
+ * The file contains parameters in the same format as the environment file of
+ * a single instance (NAME=VALUE), grouped into sections, one section per
+ * console. The section starts with its name in square brackets. Parameters
+ * placed before the first section are shared by all consoles and can be
+ * overridden in a section. Empty lines and lines started with '#' are ignored.
+ * Parameter WORKERS in the shared part defines the number of worker threads.
+ */
+class ConfigFile
+{
+  public:
+    /**
+     * @brief Constructor: load configuration from the file.
+     *
+     * @param[in] path path to the configuration file
+     *
+     * @throw std::system_error if the file can't be read
+     * @throw std::invalid_argument invalid format of the file or one of the
+     *        parameters
+     */
+    explicit ConfigFile(const std::string& path);
+
+    ConfigFile(const ConfigFile&) = delete;
+    ConfigFile& operator=(const ConfigFile&) = delete;
+
+    /** @brief Get configurations of the consoles in the file order. */
+    const std::vector<Config>& consoles() const;
+
+    /**
+     * @brief Get name of the console's section.
+     *
+     * @param[in] index index of the console
+     *
+     * @return name of the section
+     */
+    const std::string& name(size_t index) const;
+
+    /** @brief Get number of worker threads serving the consoles. */
+    size_t workers() const;
+
+  private:
+    /** @brief Parameters of the section: name -> value. */
+    using Section = std::map<std::string, std::string>;
+
+    /**
+     * @brief Parse the file into sections.
+     *
+     * @param[in] path path to the configuration file
+     *
+     * @throw std::exception in case of errors
+     */
+    void parse(const std::string& path);
+
+  private:
+    /** @brief Parameters shared by all consoles. */
+    Section common;
+    /** @brief Names and parameters of the sections, referred by configs. */
+    std::list<std::pair<std::string, Section>> sections;
+    /** @brief Configurations of the consoles. */
+    std::vector<Config> configs;
+    /** @brief Number of worker threads. */
+    size_t workerThreads;
+};
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "console_reader.hpp"
+
+#include <algorithm>
+#include <bit>
+
+/** @brief Min size of the read buffer, enough for most line-oriented output. */
+static constexpr size_t minBufferSize = 128;
+/** @brief Number of IO events to observe before shrinking the buffer. */
+static constexpr size_t shrinkPeriod = 256;
+
+ConsoleReader::ConsoleReader(HostConsole& console, size_t maxSize) :
+    console(console), maxSize(std::max(maxSize, minBufferSize)),
+    buffer(minBufferSize), active(false), known(false), filled(false),
+    queued(0), peakBurst(0), events(0)
+{}
+
+std::string_view ConsoleReader::read()
+{
+    if (!active)
+    {
+        // New IO event: check how much data is queued in the socket
+        active = true;
+        const auto size = console.pending();
+        ++counters.syscalls;
+        known = size.has_value();
+        queued = size.value_or(0);
+        if (known)
+        {
+            adapt(queued);
+        }
+    }
+    else if (known && !queued)
+    {
+        // Everything queued at the beginning of the event is read
+        active = false;
+        return std::string_view();
+    }
+    else if (filled)
+    {
+        // Queued size is unknown, grow after the buffer was filled up.
+        // The previous chunk is not used anymore, so it can be released.
+        filled = false;
+        resize(buffer.size() * 2);
+    }
+
+    // Read queued data only, so the last read doesn't end with EAGAIN
+    const size_t sz =
+        known && queued ? std::min(queued, buffer.size()) : buffer.size();
+    size_t rsz;
+    try
+    {
+        rsz = console.read(buffer.data(), sz);
+    }
+    catch (...)
+    {
+        active = false;
+        filled = false;
+        throw;
+    }
+    ++counters.syscalls;
+    ++counters.reads;
+    counters.bytes += rsz;
+
+    if (!rsz)
+    {
+        active = false;
+        filled = false;
+        return std::string_view();
+    }
+    if (known)
+    {
+        queued -= std::min(queued, rsz);
+    }
+    else
+    {
+        filled = rsz == buffer.size();
+    }
+
+    return std::string_view(buffer.data(), rsz);
+}
+
+const ConsoleReader::Stats& ConsoleReader::stats() const
+{
+    return counters;
+}
+
+size_t ConsoleReader::capacity() const
+{
+    return buffer.size();
+}
+
+void ConsoleReader::adapt(size_t burst)
+{
+    if (burst > buffer.size())
+    {
+        resize(std::bit_ceil(burst));
+    }
+
+    // Shrink the buffer if bursts were much smaller for a while
+    peakBurst = std::max(peakBurst, burst);
+    if (++events == shrinkPeriod)
+    {
+        if (peakBurst * 4 < buffer.size())
+        {
+            resize(std::bit_ceil(std::max(peakBurst, size_t{1})));
+        }
+        peakBurst = 0;
+        events = 0;
+    }
+}
+
+void ConsoleReader::resize(size_t size)
+{
+    size = std::clamp(size, minBufferSize, maxSize);
+    if (size != buffer.size())
+    {
+        std::vector<char>(size).swap(buffer);
+    }
+}
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "host_console.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class ConsoleReader
+ * @brief Reader of the host's console with a persistent buffer.
+ *
+ * On each IO event the reader checks how much data is queued in the socket
+ * and reads it with as few calls as possible. The buffer grows up to the
+ * size limit to fit the bursts and shrinks back if bursts get smaller.
+ * If the queued size is unknown, the buffer grows when a read fills it up.
+ */
+class ConsoleReader
+{
+  public:
+    /**
+     * @struct Stats
+     * @brief Reading statistics.
+     */
+    struct Stats
+    {
+        /** @brief Number of system calls: reads and queue size checks. */
+        uint64_t syscalls = 0;
+        /** @brief Number of reads. */
+        uint64_t reads = 0;
+        /** @brief Number of bytes read. */
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] console host console to read
+     * @param[in] maxSize max size of the read buffer in bytes
+     */
+    ConsoleReader(HostConsole& console, size_t maxSize);
+
+    /**
+     * @brief Read next chunk of the data available in the console.
+     *        Must be called until an empty chunk is returned.
+     *
+     * @throw std::system_error in case of errors
+     *
+     * @return chunk of data, valid until the next call,
+     *         empty if all available data is read
+     */
+    std::string_view read();
+
+    /** @brief Get reading statistics. */
+    const Stats& stats() const;
+
+    /** @brief Get current size of the read buffer. */
+    size_t capacity() const;
+
+  private:
+    /**
+     * @brief Resize the buffer to fit the burst.
+     *
+     * @param[in] burst size of the data queued in the socket
+     */
+    void adapt(size_t burst);
+
+    /**
+     * @brief Set new size of the buffer.
+     *
+     * @param[in] size new size in bytes, limited by min and max sizes
+     */
+    void resize(size_t size);
+
+  private:
+    /** @brief Host console. */
+    HostConsole& console;
+    /** @brief Max size of the buffer. */
+    size_t maxSize;
+    /** @brief Read buffer. */
+    std::vector<char> buffer;
+
+    /** @brief Flag to indicate that reading of the IO event is in progress. */
+    bool active;
+    /** @brief Flag to indicate that queued size is known. */
+    bool known;
+    /** @brief Flag to indicate that the last read filled up the buffer. */
+    bool filled;
+    /** @brief Number of bytes queued in the socket. */
+    size_t queued;
+
+    /** @brief Largest burst in the current observation period. */
+    size_t peakBurst;
+    /** @brief Number of IO events in the current observation period. */
+    size_t events;
+
+    /** @brief Reading statistics. */
+    Stats counters;
+};
@@ -3,8 +3,13 @@
 
 #include "dbus_loop.hpp"
 
+#include <unistd.h>
+
 #include <phosphor-logging/log.hpp>
 
+#include <cstring>
+#include <memory>
+#include <stdexcept>
 #include <system_error>
 
 using namespace phosphor::logging;
@@ -38,8 +43,18 @@ DbusLoop::DbusLoop() : bus(nullptr), event(nullptr)
     }
 }
 
+DbusLoop::DbusLoop(sd_event* event) : bus(nullptr), event(event) {}
+
 DbusLoop::~DbusLoop()
 {
+    for (const auto& [fd, src] : outputSources)
+    {
+        sd_event_source_unref(src);
+    }
+    for (const Timer& timer : timers)
+    {
+        sd_event_source_unref(timer.source);
+    }
     sd_bus_unref(bus);
     sd_event_unref(event);
 }
@@ -58,23 +73,58 @@ void DbusLoop::addPropertyHandler(const std::string& objPath,
                                   const WatchProperties& props,
                                   std::function<void()> callback)
 {
+    PropertyWatch& watch =
+        propWatches.emplace_back(PropertyWatch{props, callback});
+
     // Add match handler
     const int rc = sd_bus_match_signal(bus, nullptr, nullptr, objPath.c_str(),
                                        "org.freedesktop.DBus.Properties",
-                                       "PropertiesChanged", msgCallback, this);
+                                       "PropertiesChanged", msgCallback,
+                                       &watch);
     if (rc < 0)
     {
+        propWatches.pop_back();
         std::error_code ec(-rc, std::generic_category());
         throw std::system_error(ec, "Unable to register property watcher");
     }
+}
 
-    propWatch = props;
-    propHandler = callback;
+void DbusLoop::requestName(const std::string& name)
+{
+    const int rc = sd_bus_request_name(bus, name.c_str(), 0);
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to request D-Bus name " + name);
+    }
+}
+
+void DbusLoop::addObject(const std::string& objPath,
+                         const std::string& interface, const Methods& methods)
+{
+    Object& object = objects.emplace_back(Object{methods, {}});
+    object.vtable.push_back(SD_BUS_VTABLE_START(0));
+    for (const auto& [name, method] : object.methods)
+    {
+        object.vtable.push_back(SD_BUS_METHOD(name.c_str(), "", method.result,
+                                              methodCallback, 0));
+    }
+    object.vtable.push_back(SD_BUS_VTABLE_END);
+
+    const int rc = sd_bus_add_object_vtable(bus, nullptr, objPath.c_str(),
+                                            interface.c_str(),
+                                            object.vtable.data(), &object);
+    if (rc < 0)
+    {
+        objects.pop_back();
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to register D-Bus object");
+    }
 }
 
 void DbusLoop::addIoHandler(int fd, std::function<void()> callback)
 {
-    ioHandler = callback;
+    ioHandlers[fd] = callback;
     const int rc = sd_event_add_io(event, nullptr, fd, EPOLLIN,
                                    &DbusLoop::ioCallback, this);
     if (rc < 0)
@@ -84,8 +134,54 @@ void DbusLoop::addIoHandler(int fd, std::function<void()> callback)
     }
 }
 
+void DbusLoop::addOutputHandler(int fd, std::function<void()> callback)
+{
+    sd_event_source* src = nullptr;
+    int rc = sd_event_add_io(event, &src, fd, EPOLLOUT, &DbusLoop::ioCallback,
+                             this);
+    if (rc >= 0)
+    {
+        rc = sd_event_source_set_enabled(src, SD_EVENT_OFF);
+        if (rc < 0)
+        {
+            sd_event_source_unref(src);
+        }
+    }
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to register output handler");
+    }
+    ioHandlers[fd] = callback;
+    outputSources[fd] = src;
+}
+
+void DbusLoop::enableOutputHandler(int fd, bool enable)
+{
+    const auto it = outputSources.find(fd);
+    if (it == outputSources.end())
+    {
+        throw std::invalid_argument("Output handler is not registered");
+    }
+    const int rc = sd_event_source_set_enabled(
+        it->second, enable ? SD_EVENT_ON : SD_EVENT_OFF);
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to switch output handler");
+    }
+}
+
 void DbusLoop::addSignalHandler(int signal, std::function<void()> callback)
 {
+    const auto it = signalHandlers.find(signal);
+    if (it != signalHandlers.end())
+    {
+        // Signal is already watched
+        it->second.push_back(callback);
+        return;
+    }
+
     // Block the signal
     sigset_t ss;
     if (sigemptyset(&ss) < 0 || sigaddset(&ss, signal) < 0 ||
@@ -97,8 +193,6 @@ void DbusLoop::addSignalHandler(int signal, std::function<void()> callback)
         throw std::system_error(ec, err);
     }
 
-    signalHandlers.insert(std::make_pair(signal, callback));
-
     // Register handler
     const int rc = sd_event_add_signal(event, nullptr, signal,
                                        &DbusLoop::signalCallback, this);
@@ -109,13 +203,62 @@ void DbusLoop::addSignalHandler(int signal, std::function<void()> callback)
         err += strsignal(signal);
         throw std::system_error(ec, err);
     }
+
+    signalHandlers[signal].push_back(callback);
+}
+
+size_t DbusLoop::addTimerHandler(uint64_t interval,
+                                 std::function<void()> callback)
+{
+    Timer& timer =
+        timers.emplace_back(Timer{interval, callback, nullptr, true});
+    const int rc = sd_event_add_time_relative(
+        event, &timer.source, CLOCK_MONOTONIC, interval, 0,
+        &DbusLoop::timerCallback, &timer);
+    if (rc < 0)
+    {
+        timers.pop_back();
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to register timer");
+    }
+    return timers.size() - 1;
+}
+
+void DbusLoop::enableTimerHandler(size_t timer, bool enable)
+{
+    if (timer >= timers.size())
+    {
+        throw std::invalid_argument("Timer is not registered");
+    }
+    Timer& tm = timers[timer];
+    if (tm.enabled == enable)
+    {
+        return;
+    }
+    int rc = 0;
+    if (enable)
+    {
+        rc = sd_event_source_set_time_relative(tm.source, tm.interval);
+    }
+    if (rc >= 0)
+    {
+        rc = sd_event_source_set_enabled(tm.source,
+                                         enable ? SD_EVENT_ONESHOT
+                                                : SD_EVENT_OFF);
+    }
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to switch timer");
+    }
+    tm.enabled = enable;
 }
 
 int DbusLoop::msgCallback(sd_bus_message* msg, void* userdata,
                           sd_bus_error* /*err*/)
 {
-    const WatchProperties& propWatch =
-        static_cast<DbusLoop*>(userdata)->propWatch;
+    const PropertyWatch& watch = *static_cast<const PropertyWatch*>(userdata);
+    const WatchProperties& propWatch = watch.props;
 
     try
     {
@@ -189,7 +332,7 @@ int DbusLoop::msgCallback(sd_bus_message* msg, void* userdata,
             if (itProps != props.end() &&
                 itProps->second.find(value) != itProps->second.end())
             {
-                static_cast<DbusLoop*>(userdata)->propHandler();
+                watch.callback();
             }
 
             sd_bus_message_exit_container(msg);
@@ -204,6 +347,62 @@ int DbusLoop::msgCallback(sd_bus_message* msg, void* userdata,
     return 0;
 }
 
+int DbusLoop::methodCallback(sd_bus_message* msg, void* userdata,
+                             sd_bus_error* err)
+{
+    const Object& object = *static_cast<const Object*>(userdata);
+    const auto it = object.methods.find(sd_bus_message_get_member(msg));
+    if (it == object.methods.end())
+    {
+        return sd_bus_error_set(err, SD_BUS_ERROR_UNKNOWN_METHOD, nullptr);
+    }
+
+    // The message is kept until the reply is sent, maybe after the return
+    const std::shared_ptr<sd_bus_message> call(sd_bus_message_ref(msg),
+                                               sd_bus_message_unref);
+    try
+    {
+        it->second.callback(
+            [call](const MethodResult& result, const std::string& error) {
+                sendReply(call.get(), result, error);
+            });
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>(ex.what());
+        return sd_bus_error_set(err, SD_BUS_ERROR_FAILED, ex.what());
+    }
+    return 1;
+}
+
+void DbusLoop::sendReply(sd_bus_message* msg, const MethodResult& result,
+                         const std::string& error)
+{
+    int rc;
+    if (!error.empty())
+    {
+        log<level::ERR>(error.c_str());
+        rc = sd_bus_reply_method_errorf(msg, SD_BUS_ERROR_FAILED, "%s",
+                                        error.c_str());
+    }
+    else if (const UnixFd* file = std::get_if<UnixFd>(&result))
+    {
+        // The descriptor is duplicated to the message
+        rc = sd_bus_reply_method_return(msg, "h", file->fd);
+        close(file->fd);
+    }
+    else
+    {
+        rc = sd_bus_reply_method_return(msg, "s",
+                                        std::get<std::string>(result).c_str());
+    }
+    if (rc < 0)
+    {
+        log<level::WARNING>("Unable to send D-Bus reply",
+                            entry("Error=%s", strerror(-rc)));
+    }
+}
+
 int DbusLoop::signalCallback(sd_event_source* /*src*/,
                              const struct signalfd_siginfo* si, void* userdata)
 {
@@ -211,7 +410,10 @@ int DbusLoop::signalCallback(sd_event_source* /*src*/,
     const auto it = instance->signalHandlers.find(si->ssi_signo);
     if (it != instance->signalHandlers.end())
     {
-        it->second();
+        for (const auto& callback : it->second)
+        {
+            callback();
+        }
     }
     else
     {
@@ -222,9 +424,38 @@ int DbusLoop::signalCallback(sd_event_source* /*src*/,
     return 0;
 }
 
-int DbusLoop::ioCallback(sd_event_source* /*src*/, int /*fd*/,
+int DbusLoop::ioCallback(sd_event_source* /*src*/, int fd,
                          uint32_t /*revents*/, void* userdata)
 {
-    static_cast<DbusLoop*>(userdata)->ioHandler();
+    DbusLoop* instance = static_cast<DbusLoop*>(userdata);
+    const auto it = instance->ioHandlers.find(fd);
+    if (it != instance->ioHandlers.end())
+    {
+        it->second();
+    }
+    return 0;
+}
+
+int DbusLoop::timerCallback(sd_event_source* src, uint64_t /*usec*/,
+                            void* userdata)
+{
+    const Timer& timer = *static_cast<const Timer*>(userdata);
+    timer.callback();
+    if (!timer.enabled)
+    {
+        // The handler has disabled the timer
+        return 0;
+    }
+
+    // Rearm the timer
+    int rc = sd_event_source_set_time_relative(src, timer.interval);
+    if (rc >= 0)
+    {
+        rc = sd_event_source_set_enabled(src, SD_EVENT_ONESHOT);
+    }
+    if (rc < 0)
+    {
+        log<level::WARNING>("Unable to rearm timer");
+    }
     return 0;
 }
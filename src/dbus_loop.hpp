@@ -5,10 +5,13 @@
 
 #include <systemd/sd-bus.h>
 
+#include <deque>
 #include <functional>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
+#include <variant>
 #include <vector>
 
 /**
@@ -25,9 +28,46 @@ class DbusLoop
     /** @brief Map of watched properties: interface -> properties. */
     using WatchProperties = std::map<std::string, Properties>;
 
+    /**
+     * @struct UnixFd
+     * @brief File descriptor returned by the method, closed by the loop
+     *        after sending the reply.
+     */
+    struct UnixFd
+    {
+        int fd;
+    };
+    /** @brief Value returned by the method: a string or a descriptor. */
+    using MethodResult = std::variant<std::string, UnixFd>;
+    /**
+     * @brief Sender of the method reply: the result or, if the error text is
+     *        not empty, the error. Can be called after the handler returns,
+     *        but only once and in the thread of the loop.
+     */
+    using Reply = std::function<void(const MethodResult& result,
+                                     const std::string& error)>;
+
+    /**
+     * @struct Method
+     * @brief D-Bus method without arguments.
+     */
+    struct Method
+    {
+        /** @brief D-Bus signature of the result: "s" or "h". */
+        const char* result;
+        /** @brief Method handler, exceptions thrown before the reply is sent
+         *         are returned as D-Bus errors. */
+        std::function<void(const Reply& reply)> callback;
+    };
+    /** @brief Map of methods: name -> description. */
+    using Methods = std::map<std::string, Method>;
+
     DbusLoop();
     virtual ~DbusLoop();
 
+    DbusLoop(const DbusLoop&) = delete;
+    DbusLoop& operator=(const DbusLoop&) = delete;
+
     /**
      * @brief Run worker loop.
      *
@@ -43,7 +83,8 @@ class DbusLoop
     void stop(int code) const;
 
     /**
-     * @brief Add property change handler.
+     * @brief Add property change handler. Several handlers can be added,
+     *        each one watches its own object.
      *
      * @param[in] service D-Bus service name (object owner)
      * @param[in] objPath path to the D-Bus object
@@ -57,6 +98,28 @@ class DbusLoop
                                     const WatchProperties& props,
                                     std::function<void()> callback);
 
+    /**
+     * @brief Request the well-known name on the bus.
+     *
+     * @param[in] name D-Bus service name
+     *
+     * @throw std::system_error in case of errors
+     */
+    virtual void requestName(const std::string& name);
+
+    /**
+     * @brief Add D-Bus object that implements the interface.
+     *
+     * @param[in] objPath path to the D-Bus object
+     * @param[in] interface name of the interface
+     * @param[in] methods methods of the interface
+     *
+     * @throw std::system_error in case of errors
+     */
+    virtual void addObject(const std::string& objPath,
+                           const std::string& interface,
+                           const Methods& methods);
+
     /**
      * @brief Add IO event handler.
      *
@@ -68,7 +131,29 @@ class DbusLoop
     virtual void addIoHandler(int fd, std::function<void()> callback);
 
     /**
-     * @brief Add signal handler.
+     * @brief Add handler called when the file is ready for writing.
+     *        The handler is disabled until it is enabled explicitly.
+     *
+     * @param[in] fd file descriptor to watch
+     * @param[in] callback function to call when the file is writable
+     *
+     * @throw std::system_error in case of errors
+     */
+    virtual void addOutputHandler(int fd, std::function<void()> callback);
+
+    /**
+     * @brief Enable or disable handler added with addOutputHandler.
+     *
+     * @param[in] fd file descriptor to watch
+     * @param[in] enable true to enable the handler, false to disable it
+     *
+     * @throw std::system_error in case of errors
+     */
+    virtual void enableOutputHandler(int fd, bool enable);
+
+    /**
+     * @brief Add signal handler. Several handlers of the same signal are
+     *        called in order of registration.
      *
      * @param[in] signal signal to watch
      * @param[in] callback function to call when signal is triggered
@@ -77,7 +162,79 @@ class DbusLoop
      */
     virtual void addSignalHandler(int signal, std::function<void()> callback);
 
+    /**
+     * @brief Add periodic timer handler.
+     *
+     * @param[in] interval timer period in microseconds
+     * @param[in] callback function to call when timer is triggered
+     *
+     * @throw std::system_error in case of errors
+     *
+     * @return timer id
+     */
+    virtual size_t addTimerHandler(uint64_t interval,
+                                   std::function<void()> callback);
+
+    /**
+     * @brief Enable or disable handler added with addTimerHandler.
+     *        The enabled timer starts a new period.
+     *
+     * @param[in] timer timer id
+     * @param[in] enable true to enable the handler, false to disable it
+     *
+     * @throw std::system_error in case of errors
+     */
+    virtual void enableTimerHandler(size_t timer, bool enable);
+
+  protected:
+    /**
+     * @brief Constructor of the event loop without D-Bus connection.
+     *
+     * @param[in] event event loop, the instance takes ownership of it
+     */
+    explicit DbusLoop(sd_event* event);
+
   private:
+    /**
+     * @struct PropertyWatch
+     * @brief Property change handler description.
+     */
+    struct PropertyWatch
+    {
+        /** @brief Watched properties. */
+        WatchProperties props;
+        /** @brief Property change handler. */
+        std::function<void()> callback;
+    };
+
+    /**
+     * @struct Object
+     * @brief D-Bus object description.
+     */
+    struct Object
+    {
+        /** @brief Methods of the object. */
+        Methods methods;
+        /** @brief Table of methods, refers to the names of methods. */
+        std::vector<sd_bus_vtable> vtable;
+    };
+
+    /**
+     * @struct Timer
+     * @brief Periodic timer description.
+     */
+    struct Timer
+    {
+        /** @brief Timer period in microseconds. */
+        uint64_t interval;
+        /** @brief Timer handler. */
+        std::function<void()> callback;
+        /** @brief Event source of the timer. */
+        sd_event_source* source;
+        /** @brief Flag to indicate that the timer is enabled. */
+        bool enabled;
+    };
+
     /**
      * @brief D-Bus callback: message handler.
      *        See sd_bus_message_handler_t for details.
@@ -85,6 +242,23 @@ class DbusLoop
     static int msgCallback(sd_bus_message* msg, void* userdata,
                            sd_bus_error* err);
 
+    /**
+     * @brief D-Bus callback: method handler.
+     *        See sd_bus_message_handler_t for details.
+     */
+    static int methodCallback(sd_bus_message* msg, void* userdata,
+                              sd_bus_error* err);
+
+    /**
+     * @brief Send reply to the method call.
+     *
+     * @param[in] msg method call message
+     * @param[in] result result of the method
+     * @param[in] error error text, empty if the method succeeded
+     */
+    static void sendReply(sd_bus_message* msg, const MethodResult& result,
+                          const std::string& error);
+
     /**
      * @brief D-Bus callback: signal handler.
      *        See sd_event_signal_handler_t for details.
@@ -100,20 +274,34 @@ class DbusLoop
     static int ioCallback(sd_event_source* src, int fd, uint32_t revents,
                           void* userdata);
 
+    /**
+     * @brief D-Bus callback: timer handler.
+     *        See sd_event_time_handler_t for details.
+     */
+    static int timerCallback(sd_event_source* src, uint64_t usec,
+                             void* userdata);
+
   private:
     /** @brief D-Bus connection. */
     sd_bus* bus;
     /** @brief D-Bus event loop. */
     sd_event* event;
 
-    /** @brief Watched properties. */
-    WatchProperties propWatch;
-    /** @brief Property change handler. */
-    std::function<void()> propHandler;
+    /** @brief Property change handlers. */
+    std::list<PropertyWatch> propWatches;
+
+    /** @brief D-Bus objects. */
+    std::list<Object> objects;
+
+    /** @brief IO handlers: file descriptor -> callback. */
+    std::map<int, std::function<void()>> ioHandlers;
+
+    /** @brief Output event sources: file descriptor -> source. */
+    std::map<int, sd_event_source*> outputSources;
 
-    /** @brief IO handler. */
-    std::function<void()> ioHandler;
+    /** @brief Signal handlers: signal -> callbacks. */
+    std::map<int, std::vector<std::function<void()>>> signalHandlers;
 
-    /** @brief Signal handlers. */
-    std::map<int, std::function<void()>> signalHandlers;
+    /** @brief Timers, index is the timer id. */
+    std::deque<Timer> timers;
 };
@@ -3,18 +3,40 @@
 
 #include "file_storage.hpp"
 
-#include "zlib_file.hpp"
+#include "plain_file.hpp"
 
-#include <set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <system_error>
+#include <vector>
 
 namespace fs = std::filesystem;
 
-/** @brief File extension for log files. */
-static const std::string fileExt = ".log.gz";
+/** @brief All supported compression algorithms, used to find log files. */
+static constexpr Compression compressions[] = {
+    Compression::none, Compression::zlib, Compression::zstd, Compression::lz4};
+
+/** @brief Max size of the time stamp, continuation mark and line feed added
+ *         to each message in a log file. */
+static constexpr size_t recordOverhead = 64;
+/** @brief Room for the title record and headers of compressed formats. */
+static constexpr size_t fileOverhead = 4096;
+/** @brief Extension of the copies of staged files that are being committed. */
+static constexpr char stageExt[] = ".stage";
 
 FileStorage::FileStorage(const std::string& path, const std::string& prefix,
-                         size_t maxFiles) :
-    outDir(path), filePrefix(prefix), filesLimit(maxFiles)
+                         size_t maxFiles, Compression compression,
+                         size_t level, size_t threads, size_t maxBytes) :
+    outDir(path), filePrefix(prefix), filesLimit(maxFiles),
+    bytesLimit(maxBytes), compression(compression), compressionLevel(level),
+    compressionThreads(threads), blockSize(0),
+    fileExt(LogWriter::extension(compression)), indexBytes(0), stageLimit(0),
+    stageBytes(0)
 {
     // Check path
     if (!outDir.is_absolute())
@@ -28,6 +50,8 @@ FileStorage::FileStorage(const std::string& path, const std::string& prefix,
     {
         filePrefix = "host";
     }
+
+    scan(outDir, false);
 }
 
 std::string FileStorage::save(const LogBuffer& buf) const
@@ -37,39 +61,306 @@ std::string FileStorage::save(const LogBuffer& buf) const
         return std::string(); // Buffer is empty, nothing to save
     }
 
+    // Compressed file is never larger than the plain text, don't start
+    // writing if the file system has no room for it. Staged files are
+    // checked on commit.
+    if (stageDir.empty())
+    {
+        reserve(buf.usage() + buf.size() * recordOverhead + fileOverhead);
+    }
+
     const std::string fileName = newFile();
-    ZlibFile logFile(fileName);
+    const timespec started = buf.begin()->timeStamp;
+    timespec finished = started;
+    try
+    {
+        const std::unique_ptr<LogWriter> logFile = createWriter(fileName);
 
-    // Write full datetime stamp as the first record
-    tm tmLocal;
-    localtime_r(&buf.begin()->timeStamp, &tmLocal);
-    char tmText[20]; // asciiz for YYYY-MM-DD HH:MM:SS
-    strftime(tmText, sizeof(tmText), "%F %T", &tmLocal);
-    std::string titleMsg = ">>> Log collection started at ";
-    titleMsg += tmText;
-    logFile.write(tmLocal, titleMsg);
+        // Write full datetime stamp as the first record
+        logFile->write(started, titleMessage(started));
+
+        // Write messages
+        for (const auto& msg : buf)
+        {
+            logFile->write(msg.timeStamp, msg.text, msg.continued);
+            finished = msg.timeStamp;
+        }
+
+        logFile->close();
+    }
+    catch (...)
+    {
+        dropFile(fileName);
+        throw;
+    }
+
+    addFile(fileName, started, finished);
+
+    return fileName;
+}
+
+std::unique_ptr<LogWriter>
+    FileStorage::createWriter(const std::string& fileName) const
+{
+    return LogWriter::create(compression, compressionLevel, fileName,
+                             compressionThreads, blockSize);
+}
+
+std::string FileStorage::tempFile() const
+{
+    const std::filesystem::path& dir = stageDir.empty() ? outDir : stageDir;
+    return dir / ('.' + filePrefix + fileExt + ".part");
+}
 
-    // Write messages
-    for (const auto& msg : buf)
+std::string FileStorage::commit(const std::string& fileName,
+                                const timespec& first,
+                                const timespec& last) const
+{
+    const std::string newName = newFile();
+    try
     {
-        localtime_r(&msg.timeStamp, &tmLocal);
-        logFile.write(tmLocal, msg.text);
+        fs::rename(fileName, newName);
     }
+    catch (...)
+    {
+        dropFile(newName);
+        throw;
+    }
+
+    addFile(newName, first, last);
+
+    return newName;
+}
+
+std::map<std::string, FileStorage::FileInfo> FileStorage::files() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index;
+}
+
+uintmax_t FileStorage::usage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return indexBytes;
+}
+
+void FileStorage::setBlockSize(size_t size)
+{
+    blockSize = size;
+}
 
-    logFile.close();
+size_t FileStorage::setStaging(const std::string& dir, size_t batchBytes)
+{
+    stageDir = dir;
+    if (!stageDir.is_absolute())
+    {
+        throw std::invalid_argument("Staging path must be absolute");
+    }
+    stageLimit = batchBytes;
+    fs::create_directories(stageDir);
 
+    // Remove copies left by the commit interrupted in the middle
+    for (const auto& file : fs::directory_iterator(outDir))
+    {
+        const std::string name = file.path().filename();
+        if (name.starts_with('.') && name.ends_with(stageExt))
+        {
+            std::error_code ec;
+            fs::remove(file.path(), ec);
+        }
+    }
+
+    const size_t recovered = scan(stageDir, true);
+    std::lock_guard<std::mutex> lock(mutex);
     rotate();
+    return recovered;
+}
 
-    return fileName;
+bool FileStorage::stageFull() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stageLimit && stageBytes >= stageLimit;
+}
+
+size_t FileStorage::commitStaged() const
+{
+    std::lock_guard<std::mutex> stageLock(stageMutex);
+
+    // Files that are being written have no time stamps yet
+    std::vector<std::string> batch;
+    uintmax_t batchBytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [name, info] : index)
+        {
+            if (info.staged && !isWriting(info))
+            {
+                batch.push_back(name);
+                batchBytes += info.size;
+            }
+        }
+    }
+    if (batch.empty())
+    {
+        return 0;
+    }
+    reserve(batchBytes);
+
+    // Copy the whole batch, then sync the file system once
+    const auto tempPath = [this](const std::string& name) {
+        return outDir / ('.' + name + stageExt);
+    };
+    const auto cleanup = [&batch, &tempPath]() {
+        for (const std::string& name : batch)
+        {
+            std::error_code ec;
+            fs::remove(tempPath(name), ec);
+        }
+    };
+    for (const std::string& name : batch)
+    {
+        std::error_code ec;
+        fs::copy_file(stageDir / name, tempPath(name),
+                      fs::copy_options::overwrite_existing, ec);
+        if (ec && fs::exists(stageDir / name))
+        {
+            cleanup();
+            throw fs::filesystem_error("Unable to commit staged file",
+                                       stageDir / name, tempPath(name), ec);
+        }
+    }
+    const int dirFd = open(outDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd == -1 || syncfs(dirFd) != 0)
+    {
+        std::error_code ec(errno, std::generic_category());
+        if (dirFd != -1)
+        {
+            close(dirFd);
+        }
+        cleanup();
+        throw std::system_error(ec, "Unable to sync " + outDir.string());
+    }
+
+    // Files removed while being copied are dropped
+    size_t committed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::string& name : batch)
+        {
+            std::error_code ec;
+            const auto it = index.find(name);
+            if (it != index.end() && it->second.staged)
+            {
+                fs::rename(tempPath(name), outDir / name, ec);
+                if (!ec)
+                {
+                    it->second.staged = false;
+                    stageBytes -= it->second.size;
+                    fs::remove(stageDir / name, ec);
+                    ++committed;
+                    continue;
+                }
+            }
+            fs::remove(tempPath(name), ec);
+        }
+        // Committed files can be rotated now
+        rotate();
+    }
+
+    // Persist the new names
+    const int rc = fsync(dirFd);
+    std::error_code ec(errno, std::generic_category());
+    close(dirFd);
+    if (rc != 0)
+    {
+        throw std::system_error(ec, "Unable to sync " + outDir.string());
+    }
+
+    return committed;
+}
+
+std::string FileStorage::commitFile(const std::string& fileName) const
+{
+    if (stageDir.empty())
+    {
+        return fileName;
+    }
+    commitStaged();
+    if (fileName.empty())
+    {
+        return fileName;
+    }
+
+    // Files that failed to move stay staged
+    const std::string name = fs::path(fileName).filename();
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = index.find(name);
+    if (it == index.end() || it->second.staged)
+    {
+        throw std::runtime_error("Log file " + name + " is not committed");
+    }
+    return outDir / name;
+}
+
+int FileStorage::snapshot(const LogBuffer& buf)
+{
+    const int fd = memfd_create("hostlogger", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "Unable to create memory file");
+    }
+    try
+    {
+        if (!buf.empty())
+        {
+            // The writer opens its own description of the file, so the
+            // offset of the returned descriptor stays at the beginning
+            PlainFile file("/proc/self/fd/" + std::to_string(fd));
+            const timespec started = buf.begin()->timeStamp;
+            file.write(started, titleMessage(started));
+            for (const auto& msg : buf)
+            {
+                file.write(msg.timeStamp, msg.text, msg.continued);
+            }
+            file.close();
+        }
+        constexpr int seals =
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+        if (fcntl(fd, F_ADD_SEALS, seals) == -1)
+        {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Unable to seal memory file");
+        }
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+    return fd;
+}
+
+std::string FileStorage::titleMessage(const timespec& timeStamp)
+{
+    tm tmLocal;
+    localtime_r(&timeStamp.tv_sec, &tmLocal);
+    char tmText[20]; // asciiz for YYYY-MM-DD HH:MM:SS
+    strftime(tmText, sizeof(tmText), "%F %T", &tmLocal);
+    std::string titleMsg = ">>> Log collection started at ";
+    titleMsg += tmText;
+    return titleMsg;
 }
 
 std::string FileStorage::newFile() const
 {
     // Prepare directory
-    fs::create_directories(outDir);
+    const bool staged = !stageDir.empty();
+    const std::filesystem::path& dir = staged ? stageDir : outDir;
+    fs::create_directories(dir);
 
     // Construct log file name: {prefix}_{timestamp}[_N].{ext}
-    std::string fileName = outDir / (filePrefix + '_');
+    std::string fileName = dir / (filePrefix + '_');
 
     time_t tmCurrent;
     time(&tmCurrent);
@@ -80,70 +371,204 @@ std::string FileStorage::newFile() const
     fileName += tmText;
 
     // Handle duplicate files
+    const std::string name = fs::path(fileName).filename();
     std::string dupPostfix;
     size_t dupCounter = 0;
-    while (fs::exists(fileName + dupPostfix + fileExt))
+    std::lock_guard<std::mutex> lock(mutex);
+    while (index.contains(name + dupPostfix + fileExt))
     {
         dupPostfix = '_' + std::to_string(++dupCounter);
     }
+    index.emplace(name + dupPostfix + fileExt, FileInfo{0, {}, {}, staged});
     fileName += dupPostfix;
     fileName += fileExt;
 
     return fileName;
 }
 
-void FileStorage::rotate() const
+void FileStorage::addFile(const std::string& fileName, const timespec& first,
+                          const timespec& last) const
 {
-    if (!filesLimit)
+    FileInfo info{0, first, last};
+    struct stat st;
+    if (stat(fileName.c_str(), &st) == 0)
     {
-        return; // Unlimited
+        info.size = st.st_size;
+        if (!last.tv_sec && !last.tv_nsec)
+        {
+            info.last = st.st_mtim;
+        }
     }
 
-    // Get file list to ordered set
-    std::set<std::string> logFiles;
-    for (const auto& file : fs::directory_iterator(outDir))
+    std::lock_guard<std::mutex> lock(mutex);
+    FileInfo& entry = index[fs::path(fileName).filename()];
+    info.staged = entry.staged;
+    indexBytes -= entry.size;
+    indexBytes += info.size;
+    if (info.staged)
     {
-        if (!fs::is_regular_file(file))
-        {
-            continue;
-        }
-        const std::string fileName = file.path().filename();
+        stageBytes -= entry.size;
+        stageBytes += info.size;
+    }
+    entry = info;
+    rotate();
+}
 
-        const size_t minFileNameLen =
-            filePrefix.length() + 15 + // time stamp YYYYMMDD_HHMMSS
-            fileExt.length();
-        if (fileName.length() < minFileNameLen)
+void FileStorage::dropFile(const std::string& fileName) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = index.find(fs::path(fileName).filename());
+    if (it != index.end())
+    {
+        indexBytes -= it->second.size;
+        if (it->second.staged)
         {
-            continue;
+            stageBytes -= it->second.size;
         }
+        index.erase(it);
+    }
+}
+
+void FileStorage::reserve(uintmax_t size) const
+{
+    fs::create_directories(outDir);
 
-        if (fileName.compare(fileName.length() - fileExt.length(),
-                             fileExt.length(), fileExt))
+    std::lock_guard<std::mutex> lock(mutex);
+    struct statvfs st;
+    if (statvfs(outDir.c_str(), &st) != 0)
+    {
+        return; // Let the writer report the error
+    }
+    const uintmax_t avail = static_cast<uintmax_t>(st.f_bavail) * st.f_frsize;
+    if (avail >= size)
+    {
+        return;
+    }
+
+    // Don't destroy the history if removing it can't make enough room
+    uintmax_t evictable = 0;
+    for (const auto& [name, info] : index)
+    {
+        if (isEvictable(info))
         {
-            continue;
+            evictable += info.size;
         }
-
-        const std::string fullPrefix = filePrefix + '_';
-        if (fileName.compare(0, fullPrefix.length(), fullPrefix))
+    }
+    while (avail + evictable >= size && removeOldest())
+    {
+        if (statvfs(outDir.c_str(), &st) != 0 ||
+            static_cast<uintmax_t>(st.f_bavail) * st.f_frsize >= size)
         {
-            continue;
+            return;
         }
+    }
+
+    std::error_code ec(ENOSPC, std::generic_category());
+    throw std::system_error(ec, "No room for a log file in " + outDir.string());
+}
 
-        logFiles.insert(fileName);
+bool FileStorage::isWriting(const FileInfo& info)
+{
+    return !info.last.tv_sec && !info.last.tv_nsec;
+}
+
+bool FileStorage::isEvictable(const FileInfo& info)
+{
+    return !info.staged && !isWriting(info);
+}
+
+bool FileStorage::removeOldest() const
+{
+    // Staged files are waiting to be committed, names reserved for the
+    // files that are being written are skipped
+    auto oldest = index.begin();
+    while (oldest != index.end() && !isEvictable(oldest->second))
+    {
+        ++oldest;
+    }
+    if (oldest == index.end())
+    {
+        return false;
     }
+    std::error_code ec;
+    fs::remove(filePath(oldest->first, oldest->second), ec);
+    indexBytes -= oldest->second.size;
+    index.erase(oldest);
+    return true;
+}
 
-    // Log file has a name with a timestamp generated. The sorted set contains
-    // the oldest file on the top, remove them.
-    if (logFiles.size() > filesLimit)
+std::filesystem::path FileStorage::filePath(const std::string& name,
+                                            const FileInfo& info) const
+{
+    return (info.staged ? stageDir : outDir) / name;
+}
+
+size_t FileStorage::scan(const std::filesystem::path& dir, bool staged)
+{
+    size_t found = 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& file : fs::directory_iterator(dir))
     {
-        size_t removeCount = logFiles.size() - filesLimit;
-        for (const auto& fileName : logFiles)
+        const std::string fileName = file.path().filename();
+        struct stat st;
+        if (isLogFile(fileName) && stat(file.path().c_str(), &st) == 0 &&
+            S_ISREG(st.st_mode))
         {
-            fs::remove(outDir / fileName);
-            if (!--removeCount)
+            // Staged copy replaces the committed file with the same name
+            const FileInfo info{static_cast<uintmax_t>(st.st_size), {},
+                                st.st_mtim, staged};
+            const auto it = index.find(fileName);
+            if (it != index.end())
+            {
+                indexBytes -= it->second.size;
+            }
+            index.insert_or_assign(fileName, info);
+            indexBytes += info.size;
+            if (staged)
             {
-                break;
+                stageBytes += info.size;
             }
+            ++found;
         }
     }
+    return found;
+}
+
+bool FileStorage::isLogFile(const std::string& fileName) const
+{
+    const std::string fullPrefix = filePrefix + '_';
+    if (fileName.compare(0, fullPrefix.length(), fullPrefix))
+    {
+        return false;
+    }
+
+    // Files of all compression algorithms are rotated together, so changing
+    // the algorithm doesn't leave old files behind
+    for (const Compression type : compressions)
+    {
+        const std::string ext = LogWriter::extension(type);
+        const size_t minFileNameLen =
+            filePrefix.length() + 15 + // time stamp YYYYMMDD_HHMMSS
+            ext.length();
+        if (fileName.length() >= minFileNameLen &&
+            !fileName.compare(fileName.length() - ext.length(), ext.length(),
+                              ext))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FileStorage::rotate() const
+{
+    // Log file has a name with a timestamp generated. The sorted index
+    // contains the oldest file on the top, remove them.
+    while (filesLimit && index.size() > filesLimit && removeOldest())
+    {}
+
+    // The newest file is kept even if it doesn't fit the limit alone
+    while (bytesLimit && indexBytes > bytesLimit && index.size() > 1 &&
+           removeOldest())
+    {}
 }
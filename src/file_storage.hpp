@@ -3,45 +3,207 @@
 
 #pragma once
 
+#include "config.hpp"
 #include "log_buffer.hpp"
+#include "log_writer.hpp"
 
+#include <ctime>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
 
 /**
  * @class FileStorage
  * @brief Persistent file storage with automatic log file rotation.
+ *
+ * The output directory is scanned once on start, then the storage keeps
+ * the index of its log files updated as the files are created and removed,
+ * so saving a file doesn't walk the directory. Files added to the directory
+ * by others are not rotated until the service restarts.
+ * The storage is limited by the number of files and by their total size, the
+ * oldest files are removed first. The newest file is always kept, even if it
+ * exceeds the size limit alone.
+ * With staging enabled, files are written to the staging directory (tmpfs)
+ * and moved to the output directory in batches, so the flash storage sees a
+ * few large writes instead of many small ones. Staged files are counted in
+ * the index, but only committed files are removed by rotation.
  */
 class FileStorage
 {
   public:
+    /**
+     * @struct FileInfo
+     * @brief Description of a log file in the storage.
+     */
+    struct FileInfo
+    {
+        /** @brief Size of the file in bytes. */
+        uintmax_t size;
+        /** @brief Time stamp of the first message, zero if unknown. */
+        timespec first;
+        /** @brief Time stamp of the last message or modification time. */
+        timespec last;
+        /** @brief File is in the staging directory, not committed yet. */
+        bool staged = false;
+    };
+
     /**
      * @brief Constructor.
      *
      * @param[in] path absolute path to the output directory
      * @param[in] prefix prefix used for log file names
      * @param[in] maxFiles max number of log files that can be stored
+     * @param[in] compression compression algorithm of log files
+     * @param[in] level compression level, 0 for the algorithm's default
+     * @param[in] threads number of compression threads
+     * @param[in] maxBytes max total size of log files in bytes, 0=unlimited
      *
      * @throw std::exception in case of errors
      */
     FileStorage(const std::string& path, const std::string& prefix,
-                size_t maxFiles);
+                size_t maxFiles, Compression compression = Compression::zlib,
+                size_t level = 0, size_t threads = 1, size_t maxBytes = 0);
 
     virtual ~FileStorage() = default;
 
     /**
      * @brief Save log buffer to a file.
+     *        The oldest files are removed beforehand if the file system has
+     *        no room for the uncompressed buffer.
      *
      * @param[in] buf buffer with log message to save
      *
+     * @throw std::system_error with ENOSPC if there is no room for the file
      * @throw std::exception in case of errors
      *
      * @return path to saved file
      */
     virtual std::string save(const LogBuffer& buf) const;
 
+    /**
+     * @brief Create writer for a log file with the configured compression.
+     *
+     * @param[in] fileName path to the file
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return pointer to the writer
+     */
+    std::unique_ptr<LogWriter> createWriter(const std::string& fileName) const;
+
+    /**
+     * @brief Get path to the file that is being written as messages arrive.
+     *
+     * @return full path to the file
+     */
+    std::string tempFile() const;
+
+    /**
+     * @brief Move finished file to the storage under a new name.
+     *
+     * @param[in] fileName path to the finished file
+     * @param[in] first time stamp of the first message, zero if unknown
+     * @param[in] last time stamp of the last message, zero if unknown
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return path to the file in the storage
+     */
+    std::string commit(const std::string& fileName, const timespec& first = {},
+                       const timespec& last = {}) const;
+
+    /**
+     * @brief Get the index of log files.
+     *
+     * @return file descriptions by names, ordered from the oldest file
+     */
+    std::map<std::string, FileInfo> files() const;
+
+    /**
+     * @brief Get total size of log files in the index.
+     *
+     * @return size in bytes
+     */
+    uintmax_t usage() const;
+
+    /**
+     * @brief Write gzip files as a series of independently compressed blocks
+     *        with the index of time stamps, see ZlibBlockFile.
+     *
+     * @param[in] size size of uncompressed data in a block, 0 to disable
+     */
+    void setBlockSize(size_t size);
+
+    /**
+     * @brief Enable staging: new files are written to the staging directory
+     *        until they are committed. Files left in the directory by the
+     *        previous instance are staged again.
+     *
+     * @param[in] dir absolute path to the staging directory
+     * @param[in] batchBytes size of staged files to commit them, 0=unlimited
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return number of files recovered from the staging directory
+     */
+    size_t setStaging(const std::string& dir, size_t batchBytes);
+
+    /**
+     * @brief Check if the size of staged files reached the batch size.
+     *
+     * @return true if the staged files should be committed
+     */
+    bool stageFull() const;
+
+    /**
+     * @brief Move all staged files to the output directory.
+     *        The files are copied under temporary names, synced once for the
+     *        whole batch and then renamed, so the output directory never has
+     *        incomplete files.
+     *
+     * @throw std::exception in case of errors, staged files stay in place
+     *
+     * @return number of committed files
+     */
+    size_t commitStaged() const;
+
+    /**
+     * @brief Commit staged files, make sure the saved file is among them.
+     *
+     * @param[in] fileName path to the file returned by save(), may be empty
+     *
+     * @throw std::exception if the file is not committed
+     *
+     * @return path to the file in the output directory
+     */
+    std::string commitFile(const std::string& fileName) const;
+
+    /**
+     * @brief Write log buffer to a sealed memory file as plain text, nothing
+     *        is written to the storage.
+     *
+     * @param[in] buf buffer with log messages
+     *
+     * @throw std::system_error in case of errors
+     *
+     * @return descriptor of the memory file, owned by the caller
+     */
+    static int snapshot(const LogBuffer& buf);
+
+    /**
+     * @brief Construct the first record of a log file.
+     *
+     * @param[in] timeStamp time stamp of the first message
+     *
+     * @return text of the record
+     */
+    static std::string titleMessage(const timespec& timeStamp);
+
   private:
     /**
      * @brief Prepare output directory for a new log file and construct path.
+     *        The name is reserved in the index until the file is added.
      *
      * @throw std::exception in case of errors
      *
@@ -50,10 +212,98 @@ class FileStorage
     std::string newFile() const;
 
     /**
-     * @brief Rotate log files in the output directory by removing the oldest
-     *        logs.
+     * @brief Add the written file to the index.
+     *
+     * @param[in] fileName full path to the file
+     * @param[in] first time stamp of the first message, zero if unknown
+     * @param[in] last time stamp of the last message, zero if unknown
+     *
+     * @throw std::exception in case of errors
+     */
+    void addFile(const std::string& fileName, const timespec& first,
+                 const timespec& last) const;
+
+    /**
+     * @brief Remove the name reserved for a file that was not written.
+     *
+     * @param[in] fileName full path to the file
+     */
+    void dropFile(const std::string& fileName) const;
+
+    /**
+     * @brief Make sure the file system has room for a new file, remove the
+     *        oldest log files if it doesn't. Nothing is removed if removing
+     *        all the files can't make enough room.
+     *
+     * @param[in] size expected size of the new file in bytes
+     *
+     * @throw std::system_error with ENOSPC if there is still no room
+     */
+    void reserve(uintmax_t size) const;
+
+    /**
+     * @brief Get full path to the file in the storage.
+     *
+     * @param[in] name name of the file
+     * @param[in] info description of the file
+     *
+     * @return path to the file in the output or the staging directory
+     */
+    std::filesystem::path filePath(const std::string& name,
+                                   const FileInfo& info) const;
+
+    /**
+     * @brief Check if the file is being written: its name is reserved in the
+     *        index, but the file is not added yet.
+     *
+     * @param[in] info description of the file
+     *
+     * @return true if the file is being written
+     */
+    static bool isWriting(const FileInfo& info);
+
+    /**
+     * @brief Check if the file can be removed to free space: it is neither
+     *        staged nor being written.
+     *
+     * @param[in] info description of the file
+     *
+     * @return true if the file can be removed
+     */
+    static bool isEvictable(const FileInfo& info);
+
+    /**
+     * @brief Remove the oldest log file that is neither staged nor being
+     *        written, the index must be locked.
+     *
+     * @return false if there are no files to remove
+     */
+    bool removeOldest() const;
+
+    /**
+     * @brief Scan the directory and add its log files to the index.
+     *
+     * @param[in] dir path to the output or the staging directory
+     * @param[in] staged true for the staging directory
      *
      * @throw std::exception in case of errors
+     *
+     * @return number of found files
+     */
+    size_t scan(const std::filesystem::path& dir, bool staged);
+
+    /**
+     * @brief Check if the file name belongs to a log file of any compression.
+     *
+     * @param[in] fileName name of the file without directory
+     *
+     * @return true if it is a log file
+     */
+    bool isLogFile(const std::string& fileName) const;
+
+    /**
+     * @brief Rotate log files in the output directory by removing the oldest
+     *        logs until both limits are met, the index must be locked.
      */
     void rotate() const;
 
@@ -64,4 +314,30 @@ class FileStorage
     std::string filePrefix;
     /** @brief Max number of log files that can be stored. */
     size_t filesLimit;
+    /** @brief Max total size of log files in bytes. */
+    uintmax_t bytesLimit;
+    /** @brief Compression algorithm of log files. */
+    Compression compression;
+    /** @brief Compression level. */
+    size_t compressionLevel;
+    /** @brief Number of compression threads. */
+    size_t compressionThreads;
+    /** @brief Size of seekable blocks of gzip files. */
+    size_t blockSize;
+    /** @brief File extension for log files. */
+    std::string fileExt;
+    /** @brief Index of log files ordered by names, i.e. by time. */
+    mutable std::map<std::string, FileInfo> index;
+    /** @brief Total size of the indexed files. */
+    mutable uintmax_t indexBytes;
+    /** @brief Staging directory, empty if staging is disabled. */
+    std::filesystem::path stageDir;
+    /** @brief Size of staged files to commit them. */
+    uintmax_t stageLimit;
+    /** @brief Total size of staged files. */
+    mutable uintmax_t stageBytes;
+    /** @brief Mutex to serialize commits of staged files. */
+    mutable std::mutex stageMutex;
+    /** @brief Mutex to protect the index, files are saved in any thread. */
+    mutable std::mutex mutex;
 };
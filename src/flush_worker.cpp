@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "flush_worker.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <csignal>
+
+#include <phosphor-logging/log.hpp>
+
+#include <system_error>
+
+using namespace phosphor::logging;
+
+FlushWorker::FlushWorker(const FileStorage& fileStorage, size_t queueSize) :
+    fileStorage(fileStorage), queueLimit(queueSize ? queueSize : 1),
+    eventFd(-1), rejectedCount(0), stopping(false)
+{
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd == -1)
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to create event descriptor");
+    }
+    thread = std::thread(&FlushWorker::process, this);
+}
+
+FlushWorker::~FlushWorker()
+{
+    stop();
+    close(eventFd);
+}
+
+bool FlushWorker::submit(LogBuffer& buf, bool commit)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (pending.size() >= queueLimit)
+    {
+        // The event loop must not wait for the worker, the buffer is saved
+        // with the next flush
+        ++rejectedCount;
+        log<level::WARNING>("Flush queue is full, flush rejected",
+                            entry("Rejected=%lu", rejectedCount));
+        return false;
+    }
+
+    std::unique_ptr<LogBuffer> snapshot;
+    if (spare.empty())
+    {
+        snapshot = std::make_unique<LogBuffer>(0, 0);
+    }
+    else
+    {
+        snapshot = std::move(spare.back());
+        spare.pop_back();
+    }
+    snapshot->swap(buf);
+    buf.clear();
+
+    pending.push_back(Job{std::move(snapshot), commit});
+    cond.notify_all();
+    return true;
+}
+
+size_t FlushWorker::rejected() const
+{
+    return rejectedCount;
+}
+
+std::vector<FlushWorker::Result> FlushWorker::results()
+{
+    uint64_t counter;
+    while (read(eventFd, &counter, sizeof(counter)) > 0)
+    {}
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Result> ready;
+    ready.swap(done);
+    return ready;
+}
+
+void FlushWorker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cond.notify_all();
+    }
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+FlushWorker::operator int() const
+{
+    return eventFd;
+}
+
+void FlushWorker::process()
+{
+    // Signals are handled by the event loop of the main thread only
+    sigset_t ss;
+    sigfillset(&ss);
+    pthread_sigmask(SIG_BLOCK, &ss, nullptr);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty())
+        {
+            break; // Stopped and nothing to save
+        }
+        LogBuffer& snapshot = *pending.front().snapshot;
+        const bool commit = pending.front().commit;
+        lock.unlock();
+
+        Result result;
+        try
+        {
+            result.fileName = fileStorage.save(snapshot);
+            // The batch is committed here to keep the event loop responsive
+            if (commit)
+            {
+                result.fileName = fileStorage.commitFile(result.fileName);
+            }
+            else if (fileStorage.stageFull())
+            {
+                fileStorage.commitStaged();
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            result.error = ex.what();
+        }
+        snapshot.clear();
+
+        lock.lock();
+        spare.push_back(std::move(pending.front().snapshot));
+        pending.pop_front();
+        done.push_back(std::move(result));
+        cond.notify_all();
+
+        const uint64_t counter = 1;
+        if (write(eventFd, &counter, sizeof(counter)) < 0)
+        {
+            log<level::WARNING>("Unable to signal flush completion");
+        }
+    }
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "file_storage.hpp"
+#include "log_buffer.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class FlushWorker
+ * @brief Background saver of log buffers.
+ *
+ * Content of the log buffer is swapped out to a snapshot and queued, the
+ * snapshot is saved to a file by the worker thread. The event file
+ * descriptor becomes readable when saving is complete.
+ * If the queue is full, the snapshot is rejected and the log buffer keeps
+ * its content, so the event loop never waits for the worker.
+ */
+class FlushWorker
+{
+  public:
+    /**
+     * @struct Result
+     * @brief Result of saving a single snapshot.
+     */
+    struct Result
+    {
+        /** @brief Path to saved file. */
+        std::string fileName;
+        /** @brief Error description, empty if file was saved. */
+        std::string error;
+    };
+
+    /**
+     * @brief Constructor: start the worker thread.
+     *
+     * @param[in] fileStorage persistent storage used to save snapshots
+     * @param[in] queueSize max number of snapshots waiting to be saved
+     *
+     * @throw std::system_error in case of errors
+     */
+    FlushWorker(const FileStorage& fileStorage, size_t queueSize);
+
+    ~FlushWorker();
+
+    FlushWorker(const FlushWorker&) = delete;
+    FlushWorker& operator=(const FlushWorker&) = delete;
+
+    /**
+     * @brief Move content of the log buffer to the save queue.
+     *        The buffer is left empty.
+     *
+     * @param[in] buf log buffer to save
+     * @param[in] commit commit staged files after saving, the result has
+     *                   the path to the file in the output directory
+     *
+     * @return false if the queue is full, the buffer is left intact
+     */
+    bool submit(LogBuffer& buf, bool commit = false);
+
+    /** @brief Get number of snapshots rejected because of the full queue. */
+    size_t rejected() const;
+
+    /**
+     * @brief Get results of saving, reset the event.
+     *
+     * @return results in order of submitting
+     */
+    std::vector<Result> results();
+
+    /** @brief Save all queued snapshots and stop the worker thread. */
+    void stop();
+
+    /** @brief Get event file descriptor, used for watching IO. */
+    operator int() const;
+
+  private:
+    /**
+     * @struct Job
+     * @brief Snapshot waiting to be saved.
+     */
+    struct Job
+    {
+        /** @brief Content of the log buffer. */
+        std::unique_ptr<LogBuffer> snapshot;
+        /** @brief Commit staged files after saving. */
+        bool commit;
+    };
+
+    /** @brief Worker thread function. */
+    void process();
+
+  private:
+    /** @brief Persistent storage. */
+    const FileStorage& fileStorage;
+    /** @brief Max number of snapshots waiting to be saved. */
+    size_t queueLimit;
+    /** @brief Event file descriptor used to report results. */
+    int eventFd;
+    /** @brief Number of rejected snapshots, used by the caller's thread. */
+    size_t rejectedCount;
+
+    /** @brief Mutex protecting the fields below. */
+    std::mutex mutex;
+    /** @brief Condition used to signal changes of the queue. */
+    std::condition_variable cond;
+    /** @brief Snapshots waiting to be saved. */
+    std::deque<Job> pending;
+    /** @brief Empty buffers ready for reuse. */
+    std::vector<std::unique_ptr<LogBuffer>> spare;
+    /** @brief Results of saving. */
+    std::vector<Result> done;
+    /** @brief Flag to stop the worker thread. */
+    bool stopping;
+
+    /** @brief Worker thread. */
+    std::thread thread;
+};
@@ -3,6 +3,7 @@
 
 #include "host_console.hpp"
 
+#include <linux/sockios.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
@@ -131,6 +132,16 @@ size_t HostConsole::read(char* buf, size_t sz) const
     return static_cast<size_t>(rsz);
 }
 
+std::optional<size_t> HostConsole::pending() const
+{
+    int queued = 0;
+    if (ioctl(socketFd, SIOCINQ, &queued) == -1 || queued < 0)
+    {
+        return std::nullopt;
+    }
+    return static_cast<size_t>(queued);
+}
+
 HostConsole::operator int() const
 {
     return socketFd;
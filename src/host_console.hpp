@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <optional>
 #include <string>
 
 /**
@@ -41,6 +42,13 @@ class HostConsole
      */
     virtual size_t read(char* buf, size_t sz) const;
 
+    /**
+     * @brief Get number of bytes queued in the console's socket.
+     *
+     * @return number of bytes or nothing if it can't be obtained
+     */
+    virtual std::optional<size_t> pending() const;
+
     /** @brief Get socket file descriptor, used for watching IO. */
     virtual operator int() const;
 
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "log_reader.hpp"
+#include "version.hpp"
+
+#include <getopt.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <string>
+
+/** @brief Default directory with log files, the same as OUT_DIR. */
+static const char* defaultDir = "/var/lib/obmc/hostlogs";
+
+/**
+ * @brief Parse time argument.
+ *
+ * @param[in] arg text of the argument: local time "YYYY-MM-DD HH:MM[:SS]",
+ *                "now" or time ago "-N[smhd]"
+ * @param[out] time time in milliseconds since epoch
+ *
+ * @return false if the argument is invalid
+ */
+static bool parseTime(const char* arg, int64_t& time)
+{
+    const time_t now = ::time(nullptr);
+    if (strcmp(arg, "now") == 0)
+    {
+        time = static_cast<int64_t>(now) * 1000;
+        return true;
+    }
+
+    if (*arg == '-')
+    {
+        char* end = nullptr;
+        const long long num = strtoll(arg + 1, &end, 10);
+        int64_t unit = 1;
+        switch (*end)
+        {
+            case 'd':
+                unit *= 24;
+                [[fallthrough]];
+            case 'h':
+                unit *= 60;
+                [[fallthrough]];
+            case 'm':
+                unit *= 60;
+                [[fallthrough]];
+            case 's':
+                ++end;
+                [[fallthrough]];
+            case '\0':
+                break;
+            default:
+                return false;
+        }
+        if (end == arg + 1 || *end || num < 0)
+        {
+            return false;
+        }
+        time = (static_cast<int64_t>(now) - num * unit) * 1000;
+        return true;
+    }
+
+    for (const char* format :
+         {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M",
+          "%Y-%m-%dT%H:%M", "%Y-%m-%d"})
+    {
+        tm tmLocal{};
+        const char* end = strptime(arg, format, &tmLocal);
+        if (end && !*end)
+        {
+            tmLocal.tm_isdst = -1;
+            time = static_cast<int64_t>(mktime(&tmLocal)) * 1000;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** @brief Print version info. */
+static void printVersion()
+{
+    puts("Host logger reader rev." HOSTLOGGER_VERSION ".");
+}
+
+/**
+ * @brief Print help usage info.
+ *
+ * @param[in] app application's file name
+ */
+static void printHelp(const char* app)
+{
+    printVersion();
+    puts("Copyright (c) 2020 YADRO.");
+    printf("Usage: %s [OPTION...] [DIR]\n", app);
+    printf("Print host logs saved to DIR (%s) in time order.\n", defaultDir);
+    puts("  -s, --since=TIME     Print records not older than TIME");
+    puts("  -u, --until=TIME     Print records not newer than TIME");
+    puts("  -i, --instance=NAME  Print logs of the instance (SOCKET_ID),");
+    puts("                       can be repeated");
+    puts("  -g, --grep=REGEX     Print records that match the expression");
+    puts("  -n, --names          Prefix records with the instance name");
+    puts("  -j, --jobs=NUM       Number of threads, CPU count by default");
+    puts("  -v, --version        Print version and exit");
+    puts("  -h, --help           Print this help and exit");
+    puts("TIME is local 'YYYY-MM-DD HH:MM[:SS]', 'now' or '-N[smhd]' ago.");
+}
+
+/** @brief Application entry point. */
+int main(int argc, char* argv[])
+{
+    // clang-format off
+    const struct option longOpts[] = {
+        { "since",    required_argument, nullptr, 's' },
+        { "until",    required_argument, nullptr, 'u' },
+        { "instance", required_argument, nullptr, 'i' },
+        { "grep",     required_argument, nullptr, 'g' },
+        { "names",    no_argument,       nullptr, 'n' },
+        { "jobs",     required_argument, nullptr, 'j' },
+        { "version",  no_argument,       nullptr, 'v' },
+        { "help",     no_argument,       nullptr, 'h' },
+        { nullptr,    0,                 nullptr,  0  }
+    };
+    // clang-format on
+    const char* shortOpts = "s:u:i:g:nj:vh";
+    LogReader::Query query;
+    bool names = false;
+    opterr = 0; // prevent native error messages
+    int val;
+    while ((val = getopt_long(argc, argv, shortOpts, longOpts, nullptr)) != -1)
+    {
+        switch (val)
+        {
+            case 's':
+            case 'u':
+                if (!parseTime(optarg, val == 's' ? query.since : query.until))
+                {
+                    fprintf(stderr, "Invalid time: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'i':
+                query.instances.emplace_back(optarg);
+                break;
+            case 'g':
+                query.pattern = optarg;
+                break;
+            case 'n':
+                names = true;
+                break;
+            case 'j':
+                query.jobs = strtoul(optarg, nullptr, 10);
+                break;
+            case 'v':
+                printVersion();
+                return EXIT_SUCCESS;
+            case 'h':
+                printHelp(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                fprintf(stderr, "Invalid argument: %s\n", argv[optind - 1]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind + 1 < argc)
+    {
+        fprintf(stderr, "Unexpected argument: %s\n", argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+    const char* dir = optind < argc ? argv[optind] : defaultDir;
+
+    try
+    {
+        static char outBuf[256 * 1024];
+        setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+
+        const LogReader reader(dir, query);
+        reader.read([names](const LogReader::Record& record) {
+            if (names)
+            {
+                fwrite(record.instance.data(), 1, record.instance.size(),
+                       stdout);
+                fputc(' ', stdout);
+            }
+            fwrite(record.text.data(), 1, record.text.size(), stdout);
+            fputc('\n', stdout);
+        });
+        fflush(stdout);
+    }
+    catch (const std::exception& ex)
+    {
+        fprintf(stderr, "%s\n", ex.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "ingest_writer.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+using namespace phosphor::logging;
+
+IngestWriter::IngestWriter(const FileStorage& fileStorage, bool restored) :
+    fileStorage(fileStorage), tempName(fileStorage.tempFile()), dirty(false),
+    failed(false), firstStamp{}, lastStamp{}
+{
+    // Save the file left after crash of the previous instance
+    std::error_code ec;
+    if (std::filesystem::exists(tempName, ec))
+    {
+        if (restored)
+        {
+            // The same messages are in the buffer, they will be written to
+            // the new file
+            std::filesystem::remove(tempName, ec);
+            log<level::INFO>("Host logs are restored to the buffer",
+                             entry("File=%s", tempName.c_str()));
+            return;
+        }
+        try
+        {
+            std::string msg = "Recovered host logs saved to ";
+            msg += fileStorage.commit(tempName);
+            log<level::INFO>(msg.c_str());
+        }
+        catch (const std::exception& ex)
+        {
+            log<level::ERR>(ex.what());
+        }
+    }
+}
+
+void IngestWriter::write(const LogBuffer::Message& msg)
+{
+    if (failed)
+    {
+        return; // Buffer will be saved on finalize
+    }
+    try
+    {
+        if (!file)
+        {
+            file = fileStorage.createWriter(tempName);
+            file->write(msg.timeStamp,
+                        FileStorage::titleMessage(msg.timeStamp));
+            firstStamp = msg.timeStamp;
+        }
+        file->write(msg.timeStamp, msg.text, msg.continued);
+        lastStamp = msg.timeStamp;
+        dirty = true;
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>(ex.what());
+        failed = true;
+        file.reset();
+    }
+}
+
+void IngestWriter::sync()
+{
+    if (file && dirty)
+    {
+        try
+        {
+            file->sync();
+            dirty = false;
+        }
+        catch (const std::exception& ex)
+        {
+            log<level::ERR>(ex.what());
+            failed = true;
+            file.reset();
+        }
+    }
+}
+
+std::string IngestWriter::finalize(const LogBuffer& buf)
+{
+    // The last message is written as is
+    const auto last = buf.incomplete();
+    if (last)
+    {
+        write(*last);
+    }
+
+    if (file)
+    {
+        try
+        {
+            file->close();
+        }
+        catch (const std::exception& ex)
+        {
+            log<level::ERR>(ex.what());
+            failed = true;
+        }
+        file.reset();
+        dirty = false;
+    }
+
+    if (failed)
+    {
+        // Fall back to saving the whole buffer
+        failed = false;
+        std::error_code ec;
+        std::filesystem::remove(tempName, ec);
+        return fileStorage.save(buf);
+    }
+
+    if (!std::filesystem::exists(tempName))
+    {
+        return std::string(); // Nothing was written
+    }
+    const timespec firstTime = firstStamp;
+    const timespec lastTime = lastStamp;
+    firstStamp = lastStamp = timespec{};
+    try
+    {
+        return fileStorage.commit(tempName, firstTime, lastTime);
+    }
+    catch (const std::exception& ex)
+    {
+        // Fall back to saving the whole buffer
+        log<level::ERR>(ex.what());
+        std::error_code ec;
+        std::filesystem::remove(tempName, ec);
+        return fileStorage.save(buf);
+    }
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "file_storage.hpp"
+#include "log_buffer.hpp"
+#include "log_writer.hpp"
+
+#include <ctime>
+#include <memory>
+#include <string>
+
+/**
+ * @class IngestWriter
+ * @brief Log file writer for incremental mode: messages are compressed as
+ *        they arrive, so flushing only finalizes the file.
+ *
+ * The file is written under a temporary name and periodically synchronized,
+ * so it can be read up to the last checkpoint even after a crash. A file
+ * left by the previous instance is committed to the storage on start,
+ * unless its messages are restored from the persistent ring buffer.
+ */
+class IngestWriter
+{
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] fileStorage persistent storage for finished files
+     * @param[in] restored flag to indicate that messages of the previous
+     *                     instance are restored into the buffer, so the file
+     *                     left by it is removed instead of being committed
+     */
+    explicit IngestWriter(const FileStorage& fileStorage,
+                          bool restored = false);
+
+    IngestWriter(const IngestWriter&) = delete;
+    IngestWriter& operator=(const IngestWriter&) = delete;
+
+    /**
+     * @brief Write completed message, open new file if needed.
+     *
+     * @param[in] msg log message
+     */
+    void write(const LogBuffer::Message& msg);
+
+    /** @brief Write checkpoint if there are messages since the last one. */
+    void sync();
+
+    /**
+     * @brief Finalize the file and move it to the storage.
+     *        If the file could not be written or moved to the storage, the
+     *        whole buffer is saved.
+     *
+     * @param[in] buf log buffer with messages written to the file
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return path to saved file
+     */
+    std::string finalize(const LogBuffer& buf);
+
+  private:
+    /** @brief Persistent storage. */
+    const FileStorage& fileStorage;
+    /** @brief Path to the file being written. */
+    std::string tempName;
+    /** @brief Current file, null if not opened yet. */
+    std::unique_ptr<LogWriter> file;
+    /** @brief Flag to indicate that file has data after the checkpoint. */
+    bool dirty;
+    /** @brief Flag to indicate that writing failed since last finalize. */
+    bool failed;
+    /** @brief Time stamp of the first message in the file. */
+    timespec firstStamp;
+    /** @brief Time stamp of the last message in the file. */
+    timespec lastStamp;
+};
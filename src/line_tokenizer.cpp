@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "line_tokenizer.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/** @brief Byte-by-byte search, used for short tails. */
+static const char* findEolScalar(const char* begin, const char* end)
+{
+    while (begin < end && *begin != '\n' && *begin != '\r')
+    {
+        ++begin;
+    }
+    return begin;
+}
+
+#if defined(__SSE2__)
+
+/** @brief Search with SSE2: 16 bytes per iteration. */
+static const char* findEolVector(const char* begin, const char* end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    while (end - begin >= 16)
+    {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                           _mm_cmpeq_epi8(chunk, lf));
+        const unsigned mask =
+            static_cast<unsigned>(_mm_movemask_epi8(match));
+        if (mask)
+        {
+            return begin + std::countr_zero(mask);
+        }
+        begin += 16;
+    }
+    return findEolScalar(begin, end);
+}
+
+#elif defined(__ARM_NEON)
+
+/** @brief Search with NEON: 16 bytes per iteration. */
+static const char* findEolVector(const char* begin, const char* end)
+{
+    const uint8x16_t cr = vdupq_n_u8('\r');
+    const uint8x16_t lf = vdupq_n_u8('\n');
+    while (end - begin >= 16)
+    {
+        const uint8x16_t chunk =
+            vld1q_u8(reinterpret_cast<const uint8_t*>(begin));
+        const uint8x16_t match =
+            vorrq_u8(vceqq_u8(chunk, cr), vceqq_u8(chunk, lf));
+        // Narrow the comparison result to 4 bits per byte
+        const uint8x8_t nibbles =
+            vshrn_n_u16(vreinterpretq_u16_u8(match), 4);
+        const uint64_t mask =
+            vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+        if (mask)
+        {
+            return begin + std::countr_zero(mask) / 4;
+        }
+        begin += 16;
+    }
+    return findEolScalar(begin, end);
+}
+
+#else
+
+/** @brief Portable SWAR search: one machine word per iteration. */
+static const char* findEolVector(const char* begin, const char* end)
+{
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    constexpr uint64_t low7 = 0x7f7f7f7f7f7f7f7full;
+    constexpr uint64_t cr = ones * '\r';
+    constexpr uint64_t lf = ones * '\n';
+
+    // Set the high bit of each zero byte, exact for all bytes in the word
+    const auto zeroBytes = [](uint64_t v) {
+        return ~(((v & low7) + low7) | v | low7);
+    };
+
+    while (end - begin >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, begin, sizeof(word));
+        const uint64_t mask = zeroBytes(word ^ cr) | zeroBytes(word ^ lf);
+        if (mask)
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                return begin + std::countr_zero(mask) / 8;
+            }
+            else
+            {
+                return begin + std::countl_zero(mask) / 8;
+            }
+        }
+        begin += 8;
+    }
+    return findEolScalar(begin, end);
+}
+
+#endif
+
+const char* LineTokenizer::findEol(const char* begin, const char* end)
+{
+    return findEolVector(begin, end);
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @class LineTokenizer
+ * @brief Splitter of the console byte stream into lines.
+ *
+ * Lines are delimited by EOL symbols ('\r' or '\n'), sequences "\r\n" and
+ * "\n\r" are handled as a single delimiter even if they are split between
+ * two chunks of data.
+ */
+class LineTokenizer
+{
+  public:
+    /**
+     * @brief Split the next chunk of the stream into lines.
+     *
+     * @param[in] data pointer to the chunk of data
+     * @param[in] sz size of the chunk in bytes
+     * @param[in] fn callback function called for each part of the chunk with
+     *               arguments (const char* text, size_t len, bool eol), where
+     *               eol flag is set if the part is terminated by EOL
+     */
+    template <typename F>
+    void split(const char* data, size_t sz, F&& fn)
+    {
+        const char* pos = data;
+        const char* end = data + sz;
+
+        // Skip the second symbol of EOL sequence split between chunks
+        if (pendingEol && pos < end)
+        {
+            if (isEol(*pos) && *pos != pendingEol)
+            {
+                ++pos;
+            }
+            pendingEol = 0;
+        }
+
+        while (pos < end)
+        {
+            const char* eol = findEol(pos, end);
+            if (eol == end)
+            {
+                fn(pos, static_cast<size_t>(end - pos), false);
+                break;
+            }
+            fn(pos, static_cast<size_t>(eol - pos), true);
+
+            // Move current position and skip EOL character
+            pos = eol + 1;
+            if (pos == end)
+            {
+                pendingEol = *eol;
+            }
+            // Handle EOL sequences '\r\n' or '\n\r' as one delimiter
+            else if (isEol(*pos) && *pos != *eol)
+            {
+                ++pos;
+            }
+        }
+    }
+
+    /** @brief Reset the state, the next chunk starts a new stream. */
+    void reset()
+    {
+        pendingEol = 0;
+    }
+
+    /**
+     * @brief Find the first EOL symbol in the range.
+     *
+     * @param[in] begin pointer to the first byte of the range
+     * @param[in] end pointer to the byte following the last byte of the range
+     *
+     * @return pointer to the EOL symbol or end if not found
+     */
+    static const char* findEol(const char* begin, const char* end);
+
+  private:
+    /** @brief Check if a character is EOL symbol. */
+    static constexpr bool isEol(char c)
+    {
+        return c == '\r' || c == '\n';
+    }
+
+  private:
+    /** @brief EOL symbol that terminated the previous chunk. */
+    char pendingEol = 0;
+};
@@ -3,118 +3,629 @@
 
 #include "log_buffer.hpp"
 
-/** @brief Check if a character is EOL symbol. */
-constexpr bool isEol(char c)
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+/** @brief Expected average length of a single message, used for presizing. */
+static constexpr size_t avgMessageLen = 80;
+/** @brief Max number of messages the rings are presized for. */
+static constexpr size_t maxPresizeCount = 4096;
+/** @brief Initial number of index records for unlimited buffers. */
+static constexpr size_t defaultPresizeCount = 256;
+
+/**
+ * @brief Encoding of time deltas: 2 high bits define the unit
+ *        (ns, us, ms, s), the rest 30 bits is a signed value.
+ */
+static constexpr unsigned deltaUnitShift = 30;
+static constexpr int64_t deltaMax = (1 << (deltaUnitShift - 1)) - 1;
+static constexpr int64_t deltaUnits[] = {1, 1'000, 1'000'000, 1'000'000'000};
+
+/** @brief Offset returned if there is no room in the byte ring. */
+static constexpr size_t npos = std::numeric_limits<size_t>::max();
+/** @brief Min size of the byte ring placed in a file. */
+static constexpr size_t minRingSize = 64 * 1024;
+
+/** @brief Max length of a single message that can be stored (31 bits). */
+static constexpr size_t maxLineLimit = (1u << 31) - 1;
+
+/** @brief Max age of messages in minutes that can be handled. */
+static constexpr size_t maxTimeLimit =
+    std::numeric_limits<int64_t>::max() / (60ll * 1'000'000'000);
+
+LogBuffer::LogBuffer(size_t maxSize, size_t maxTime, size_t maxBytes,
+                     size_t maxLine) :
+    head(0), wrapped(false), wrapSeq(0), first(0), count(0), bytes(0),
+    firstSeq(0), firstTime(0), lastTime(0), lastComplete(true),
+    sizeLimit(maxSize), timeLimit(maxTime), bytesLimit(maxBytes),
+    lineLimit(maxLine ? std::min(maxLine, maxLineLimit) : maxLineLimit)
 {
-    return c == '\r' || c == '\n';
-}
+    if (maxBytes)
+    {
+        // Single line must fit in the byte limit with its index record,
+        // otherwise shrinking removes the line that is being written
+        lineLimit = std::min(
+            lineLimit, maxBytes > sizeof(Entry) ? maxBytes - sizeof(Entry) : 1);
+    }
 
-LogBuffer::LogBuffer(size_t maxSize, size_t maxTime) :
-    lastComplete(true), sizeLimit(maxSize), timeLimit(maxTime)
-{}
+    // The buffer holds up to sizeLimit + 1 messages before shrinking
+    size_t presize = maxSize ? std::min(maxSize, maxPresizeCount - 1) + 1
+                             : defaultPresizeCount;
+    if (maxBytes)
+    {
+        presize = std::clamp(maxBytes / (avgMessageLen + sizeof(Entry)),
+                             size_t{1}, presize);
+    }
+    heapIndex.resize(presize);
+    heapData.resize(presize * avgMessageLen);
+    index = heapIndex;
+    data = heapData;
+}
 
 void LogBuffer::append(const char* data, size_t sz)
 {
     // Split raw data into separate messages by EOL symbols (\r or \n).
     // Stream may not be ended with EOL, so we handle this situation by
     // lastComplete flag.
-    size_t pos = 0;
-    while (pos < sz)
+    // All messages of the same chunk get the same time stamp.
+    int64_t now = 0;
+    tokenizer.split(data, sz, [this, &now](const char* text, size_t len,
+                                           bool eol) {
+        if (partHandler)
+        {
+            partHandler(text, len, eol);
+        }
+        addPart(text, len, eol, now);
+    });
+
+    shrink(now);
+    commit();
+}
+
+void LogBuffer::setFullHandler(std::function<void()> cb)
+{
+    fullHandler = cb;
+}
+
+void LogBuffer::setMessageHandler(std::function<void(const Message&)> cb)
+{
+    messageHandler = cb;
+}
+
+void LogBuffer::setPartHandler(
+    std::function<void(const char*, size_t, bool)> cb)
+{
+    partHandler = cb;
+}
+
+std::optional<LogBuffer::Message> LogBuffer::incomplete() const
+{
+    if (lastComplete || !count)
+    {
+        return std::nullopt;
+    }
+    return at(count - 1, lastTime);
+}
+
+void LogBuffer::swap(LogBuffer& other)
+{
+    if (ringFile || other.ringFile)
+    {
+        // Rings of the file can't be passed to other buffer
+        LogBuffer tmp(0, 0);
+        tmp.copy(other);
+        other.copy(*this);
+        copy(tmp);
+        return;
+    }
+    std::swap(data, other.data);
+    heapData.swap(other.heapData);
+    std::swap(head, other.head);
+    std::swap(wrapped, other.wrapped);
+    std::swap(wrapSeq, other.wrapSeq);
+    std::swap(index, other.index);
+    heapIndex.swap(other.heapIndex);
+    std::swap(first, other.first);
+    std::swap(count, other.count);
+    std::swap(bytes, other.bytes);
+    std::swap(firstSeq, other.firstSeq);
+    std::swap(firstTime, other.firstTime);
+    std::swap(lastTime, other.lastTime);
+}
+
+void LogBuffer::clear()
+{
+    // Keep allocated rings for reuse
+    head = 0;
+    wrapped = false;
+    firstSeq += count;
+    first = 0;
+    count = 0;
+    bytes = 0;
+    lastComplete = true;
+    tokenizer.reset();
+    commit();
+}
+
+size_t LogBuffer::persist(const std::string& path)
+{
+    if (!bytesLimit)
+    {
+        throw std::invalid_argument("Log buffer in a file must have the "
+                                    "byte limit");
+    }
+
+    // Same limits as for the heap: byte ring of twice the byte limit, index
+    // ring for the max number of messages
+    const size_t dataSize = std::max(bytesLimit * 2, minRingSize);
+    size_t indexSize = bytesLimit / sizeof(Entry) + 2;
+    if (sizeLimit)
+    {
+        indexSize = std::min(indexSize, sizeLimit + 2);
+    }
+    if (dataSize > std::numeric_limits<uint32_t>::max())
     {
-        // Search for EOL ('\r' or '\n')
-        size_t eol = pos;
-        while (eol < sz)
+        throw std::length_error("Log buffer size limit exceeded");
+    }
+    ringFile = std::make_unique<RingFile>(path, sizeof(State),
+                                          indexSize * sizeof(Entry), dataSize);
+
+    data = std::span<char>(ringFile->data(), dataSize);
+    index = std::span<Entry>(reinterpret_cast<Entry*>(ringFile->index()),
+                             indexSize);
+    std::vector<char>().swap(heapData);
+    std::vector<Entry>().swap(heapIndex);
+    // Long message must not occupy the whole ring
+    lineLimit = std::min(lineLimit, dataSize / 2);
+
+    State state;
+    if (ringFile->load(&state) && restore(state))
+    {
+        // The line of the previous instance is not continued
+        lastComplete = true;
+        tokenizer.reset();
+        return count;
+    }
+    clear();
+    return 0;
+}
+
+bool LogBuffer::empty() const
+{
+    return count == 0;
+}
+
+size_t LogBuffer::size() const
+{
+    return count;
+}
+
+size_t LogBuffer::usage() const
+{
+    return bytes;
+}
+
+size_t LogBuffer::capacity() const
+{
+    return data.size() + index.size() * sizeof(Entry);
+}
+
+LogBuffer::const_iterator LogBuffer::begin() const
+{
+    return const_iterator(this, 0, firstTime);
+}
+
+LogBuffer::const_iterator LogBuffer::end() const
+{
+    return const_iterator(this, count, 0);
+}
+
+uint32_t LogBuffer::encodeDelta(int64_t ns)
+{
+    uint32_t unit = 0;
+    while (unit < std::size(deltaUnits) - 1 &&
+           (ns > deltaMax * deltaUnits[unit] ||
+            ns < -deltaMax * deltaUnits[unit]))
+    {
+        ++unit;
+    }
+    const int64_t value =
+        std::clamp(ns / deltaUnits[unit], -deltaMax, deltaMax);
+    return (unit << deltaUnitShift) |
+           (static_cast<uint32_t>(value) & ((1u << deltaUnitShift) - 1));
+}
+
+int64_t LogBuffer::decodeDelta(uint32_t delta)
+{
+    const uint32_t unit = delta >> deltaUnitShift;
+    // Restore the sign of 30-bit value
+    const int32_t value = static_cast<int32_t>(delta << 2) >> 2;
+    return value * deltaUnits[unit];
+}
+
+const LogBuffer::Entry& LogBuffer::entry(size_t pos) const
+{
+    return index[(first + pos) % index.size()];
+}
+
+LogBuffer::Message LogBuffer::at(size_t pos, int64_t time) const
+{
+    const Entry& rec = entry(pos);
+    return Message{
+        timespec{static_cast<time_t>(time / 1'000'000'000),
+                 static_cast<long>(time % 1'000'000'000)},
+        std::string_view(data.data() + rec.offset, rec.size),
+        rec.continued != 0};
+}
+
+LogBuffer::Entry& LogBuffer::front()
+{
+    return index[first];
+}
+
+LogBuffer::Entry& LogBuffer::back()
+{
+    return index[(first + count - 1) % index.size()];
+}
+
+void LogBuffer::addPart(const char* text, size_t len, bool eol, int64_t& now)
+{
+    if (!lastComplete && count)
+    {
+        // The last message is incomplete, add data as part of it
+        const size_t fill = std::min(len, lineLimit - back().size);
+        if (fill)
         {
-            if (isEol(data[eol]))
-            {
-                break;
-            }
-            ++eol;
+            extendBack(text, fill);
+            text += fill;
+            len -= fill;
         }
-        const bool eolFound = eol < sz;
-        const char* msgText = data + pos;
-        const size_t msgLen = (eolFound ? eol : sz) - pos;
+    }
+    else
+    {
+        if (!now)
+        {
+            now = clock.now();
+        }
+        // Free the room before adding, so a long chunk doesn't grow the rings
+        shrink(now);
+        const size_t fill = std::min(len, lineLimit);
+        pushBack(text, fill, now, false);
+        text += fill;
+        len -= fill;
+    }
 
-        // Append message to the container
-        if (!lastComplete && !messages.empty())
+    // The rest of a too long line is committed as continuation messages
+    while (len)
+    {
+        if (messageHandler)
         {
-            // The last message is incomplete, add data as part of it
-            messages.back().text.append(msgText, msgLen);
+            messageHandler(at(count - 1, lastTime));
         }
-        else
+        if (!now)
         {
-            Message msg;
-            time(&msg.timeStamp);
-            msg.text.assign(msgText, msgLen);
-            messages.push_back(msg);
+            now = clock.now();
         }
-        lastComplete = eolFound;
+        // The committed part can be removed as any complete message
+        lastComplete = true;
+        shrink(now);
+        const size_t fill = std::min(len, lineLimit);
+        pushBack(text, fill, now, true);
+        text += fill;
+        len -= fill;
+    }
+
+    lastComplete = eol;
+    if (eol && messageHandler)
+    {
+        messageHandler(at(count - 1, lastTime));
+    }
+}
 
-        // Move current position and skip EOL character
-        pos = eol + 1;
-        // Handle EOL sequences '\r\n' or '\n\r' as one delimiter
-        if (eolFound && pos < sz && isEol(data[pos]) && data[eol] != data[pos])
+void LogBuffer::pushBack(const char* text, size_t len, int64_t time,
+                         bool continued)
+{
+    if (count == index.size() && ringFile)
+    {
+        evict();
+    }
+    else if (count == index.size())
+    {
+        // Index ring is full, reallocate it with linear order of records
+        std::vector<Entry> newIndex(index.size() * 2);
+        for (size_t i = 0; i < count; ++i)
         {
-            ++pos;
+            newIndex[i] = index[(first + i) % index.size()];
         }
+        heapIndex.swap(newIndex);
+        index = heapIndex;
+        first = 0;
+    }
+
+    const size_t offset = reserve(head, len, false);
+    if (len)
+    {
+        memcpy(data.data() + offset, text, len);
     }
 
-    shrink();
+    Entry& entry = index[(first + count) % index.size()];
+    entry.offset = static_cast<uint32_t>(offset);
+    entry.size = static_cast<uint32_t>(len);
+    entry.continued = continued;
+    if (count)
+    {
+        // Accumulate the decoded value to avoid drift on imprecise deltas
+        entry.delta = encodeDelta(time - lastTime);
+        lastTime += decodeDelta(entry.delta);
+    }
+    else
+    {
+        entry.delta = 0;
+        firstTime = lastTime = time;
+    }
+    ++count;
+    bytes += len + sizeof(Entry);
+    head = offset + len;
 }
 
-void LogBuffer::setFullHandler(std::function<void()> cb)
+void LogBuffer::extendBack(const char* text, size_t len)
 {
-    fullHandler = cb;
+    Entry& entry = back();
+    const size_t offset = reserve(entry.offset, entry.size + len, true);
+    memcpy(data.data() + offset + entry.size, text, len);
+    // The committed state may refer to the entry: the text is valid at the
+    // new offset with the old size, but not at the old offset with the new one
+    entry.offset = static_cast<uint32_t>(offset);
+    std::atomic_signal_fence(std::memory_order_release);
+    entry.size += static_cast<uint32_t>(len);
+    bytes += len;
+    head = offset + entry.size;
 }
 
-void LogBuffer::clear()
+void LogBuffer::popFront()
 {
-    messages.clear();
-    lastComplete = true;
+    bytes -= front().size + sizeof(Entry);
+    first = (first + 1) % index.size();
+    ++firstSeq;
+    if (!--count)
+    {
+        head = 0;
+        wrapped = false;
+        return;
+    }
+    firstTime += decodeDelta(front().delta);
+    if (wrapped && firstSeq == wrapSeq)
+    {
+        // All messages placed before the wrap are removed
+        wrapped = false;
+    }
 }
 
-bool LogBuffer::empty() const
+void LogBuffer::evict()
+{
+    popFront();
+    commit();
+}
+
+void LogBuffer::commit()
+{
+    if (!ringFile)
+    {
+        return;
+    }
+    const State state{
+        .head = head,
+        .first = first,
+        .count = count,
+        .bytes = bytes,
+        .wrapSeq = wrapSeq,
+        .firstSeq = firstSeq,
+        .firstTime = firstTime,
+        .lastTime = lastTime,
+        .wrapped = wrapped,
+        .reserved = 0,
+    };
+    ringFile->commit(&state);
+}
+
+bool LogBuffer::restore(const State& state)
+{
+    if (state.first >= index.size() || state.count > index.size() ||
+        state.head > data.size())
+    {
+        return false;
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < state.count; ++i)
+    {
+        const Entry& entry = index[(state.first + i) % index.size()];
+        if (entry.offset + static_cast<size_t>(entry.size) > data.size())
+        {
+            return false;
+        }
+        used += entry.size + sizeof(Entry);
+    }
+    if (used != state.bytes)
+    {
+        return false;
+    }
+
+    head = state.head;
+    first = state.first;
+    count = state.count;
+    bytes = state.bytes;
+    wrapSeq = state.wrapSeq;
+    firstSeq = state.firstSeq;
+    firstTime = state.firstTime;
+    lastTime = state.lastTime;
+    wrapped = state.wrapped;
+    return true;
+}
+
+void LogBuffer::copy(const LogBuffer& other)
 {
-    return messages.empty();
+    clear();
+    for (auto it = other.begin(); it != other.end(); ++it)
+    {
+        const Message msg = *it;
+        pushBack(msg.text.data(), msg.text.size(),
+                 msg.timeStamp.tv_sec * 1'000'000'000ll + msg.timeStamp.tv_nsec,
+                 msg.continued);
+    }
+    commit();
 }
 
-LogBuffer::container_t::const_iterator LogBuffer::begin() const
+size_t LogBuffer::reserve(size_t start, size_t need, bool extend)
 {
-    return messages.begin();
+    while (ringFile)
+    {
+        const size_t offset = place(start, need, extend);
+        if (offset != npos)
+        {
+            return offset;
+        }
+        // The rings of the file have fixed size, free the oldest message
+        evict();
+        start = extend ? back().offset : head;
+    }
+
+    const size_t offset = place(start, need, extend);
+    if (offset != npos)
+    {
+        return offset;
+    }
+    grow(need);
+    return head - (extend ? back().size : 0);
 }
 
-LogBuffer::container_t::const_iterator LogBuffer::end() const
+size_t LogBuffer::place(size_t start, size_t need, bool extend)
 {
-    return messages.end();
+    const uint64_t seq = firstSeq + count - (extend ? 1 : 0);
+    const size_t others = count - (extend ? 1 : 0);
+
+    if (!others)
+    {
+        // The text being placed is the only one in the ring
+        if (need > data.size())
+        {
+            return npos;
+        }
+        if (start + need > data.size())
+        {
+            if (extend)
+            {
+                memmove(data.data(), data.data() + start, back().size);
+            }
+            start = 0;
+        }
+        wrapped = false;
+        return start;
+    }
+
+    const size_t tail = front().offset;
+    if (!wrapped)
+    {
+        if (start + need <= data.size())
+        {
+            return start;
+        }
+        if (need <= tail)
+        {
+            // Wrap around: move the text to the beginning of the ring
+            if (extend)
+            {
+                memmove(data.data(), data.data() + start, back().size);
+            }
+            wrapped = true;
+            wrapSeq = seq;
+            return 0;
+        }
+    }
+    else if (start + need <= tail)
+    {
+        return start;
+    }
+
+    return npos;
+}
+
+void LogBuffer::grow(size_t minSize)
+{
+    size_t used = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        used += index[(first + i) % index.size()].size;
+    }
+    size_t newSize = data.size() * 2;
+    if (bytesLimit)
+    {
+        // Stored texts never exceed the limit after shrinking, the ring of
+        // twice the limit is enough to place them without frequent moves
+        newSize = std::min(newSize, bytesLimit * 2);
+    }
+    newSize = std::max(newSize, used + minSize);
+    if (newSize > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::length_error("Log buffer size limit exceeded");
+    }
+
+    // Copy messages in order to the beginning of the new ring
+    std::vector<char> newData(newSize);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Entry& entry = index[(first + i) % index.size()];
+        memcpy(newData.data() + offset, data.data() + entry.offset,
+               entry.size);
+        entry.offset = static_cast<uint32_t>(offset);
+        offset += entry.size;
+    }
+    heapData.swap(newData);
+    data = heapData;
+    head = offset;
+    wrapped = false;
 }
 
-void LogBuffer::shrink()
+void LogBuffer::shrink(int64_t now)
 {
-    if (sizeLimit && messages.size() > sizeLimit)
+    // The incomplete message is being written, it is never removed
+    const size_t keep = lastComplete ? 0 : 1;
+    if ((sizeLimit && count > sizeLimit) || (bytesLimit && bytes > bytesLimit))
     {
         if (fullHandler)
         {
             fullHandler();
         }
-        while (messages.size() > sizeLimit)
+        while (sizeLimit && count > std::max(sizeLimit, keep))
+        {
+            popFront();
+        }
+        while (bytesLimit && bytes > bytesLimit && count > keep)
         {
-            messages.pop_front();
+            popFront();
         }
     }
-    if (timeLimit && !messages.empty())
+    if (timeLimit && count)
     {
-        time_t oldest;
-        time(&oldest);
-        oldest -= timeLimit * 60 /* sec */;
-        if (messages.begin()->timeStamp < oldest)
+        if (!now)
+        {
+            now = clock.now();
+        }
+        const int64_t oldest =
+            now - static_cast<int64_t>(std::min(timeLimit, maxTimeLimit)) *
+                      60 * 1'000'000'000;
+        if (firstTime < oldest)
         {
             if (fullHandler)
             {
                 fullHandler();
             }
-            while (!messages.empty() && messages.begin()->timeStamp < oldest)
+            while (count > keep && firstTime < oldest)
             {
-                messages.pop_front();
+                popFront();
             }
         }
     }
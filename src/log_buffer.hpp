@@ -3,14 +3,39 @@
 
 #pragma once
 
+#include "coarse_clock.hpp"
+#include "line_tokenizer.hpp"
+#include "ring_file.hpp"
+
+#include <cstdint>
 #include <ctime>
 #include <functional>
-#include <list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 /**
  * @class LogBuffer
  * @brief Container with automatic log message rotation.
+ *
+ * Message texts are stored back to back in a single contiguous byte ring,
+ * each message is described by a compact record in a separate index ring.
+ * Both rings are allocated once and reused, so appending and evicting
+ * messages doesn't touch the heap in the steady state.
+ * Time stamps are stored as deltas to the previous message, the absolute time
+ * is restored while iterating.
+ * Memory used by each message is accounted as its text plus the index record,
+ * so the buffer can be limited by the number of bytes as well as by the number
+ * of messages.
+ * A line longer than the max length is stored as several messages: the part
+ * that reaches the limit is committed and the rest of the line is continued
+ * in the next message marked with the continuation flag.
+ * The rings can be placed in a memory mapped file instead of the heap, so the
+ * stored messages survive the restart of the service.
  */
 class LogBuffer
 {
@@ -22,20 +47,87 @@ class LogBuffer
     struct Message
     {
         /** @brief Message creation time. */
-        time_t timeStamp;
-        /** @brief Text of the message. */
-        std::string text;
+        timespec timeStamp;
+        /** @brief Text of the message, valid until the buffer is modified. */
+        std::string_view text;
+        /** @brief Flag to indicate that the text continues the previous
+         *         message, which has reached the max line length. */
+        bool continued;
     };
 
-    using container_t = std::list<Message>;
+    /**
+     * @class const_iterator
+     * @brief Sequential iterator over the stored messages, oldest first.
+     */
+    class const_iterator
+    {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Message;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Message*;
+        using reference = Message;
+
+        /** @brief Helper to support operator-> on a temporary message. */
+        struct Proxy
+        {
+            Message msg;
+            const Message* operator->() const
+            {
+                return &msg;
+            }
+        };
+
+        const_iterator() = default;
+        const_iterator(const LogBuffer* buf, size_t pos, int64_t time) :
+            buf(buf), pos(pos), time(time)
+        {}
+
+        Message operator*() const
+        {
+            return buf->at(pos, time);
+        }
+        Proxy operator->() const
+        {
+            return Proxy{buf->at(pos, time)};
+        }
+        const_iterator& operator++()
+        {
+            if (++pos < buf->count)
+            {
+                time += decodeDelta(buf->entry(pos).delta);
+            }
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return pos == other.pos;
+        }
+
+      private:
+        const LogBuffer* buf = nullptr;
+        size_t pos = 0;
+        int64_t time = 0;
+    };
 
     /**
      * @brief Constructor.
      *
      * @param[in] maxSize max number of messages that can be stored
      * @param[in] maxTime max age of messages that can be stored, in minutes
+     * @param[in] maxBytes max size of stored messages in bytes, including
+     *                     the index records, 0 for unlimited
+     * @param[in] maxLine max length of a single message in bytes,
+     *                    0 for unlimited; clamped to fit in maxBytes
      */
-    LogBuffer(size_t maxSize, size_t maxTime);
+    LogBuffer(size_t maxSize, size_t maxTime, size_t maxBytes = 0,
+              size_t maxLine = 0);
 
     virtual ~LogBuffer() = default;
 
@@ -54,28 +146,311 @@ class LogBuffer
      */
     virtual void setFullHandler(std::function<void()> cb);
 
+    /**
+     * @brief Set handler called for each message terminated by EOL.
+     *
+     * @param[in] cb callback function
+     */
+    void setMessageHandler(std::function<void(const Message&)> cb);
+
+    /**
+     * @brief Set handler called for each part of the input split by EOL.
+     *        The part refers to the data passed to append(), so the input is
+     *        split once and shared with other consumers without copying.
+     *
+     * @param[in] cb callback function with arguments (const char* text,
+     *               size_t len, bool eol), where eol flag is set if the part
+     *               is terminated by EOL
+     */
+    void setPartHandler(std::function<void(const char*, size_t, bool)> cb);
+
+    /**
+     * @brief Get the last message if it is not terminated by EOL yet.
+     *
+     * @return incomplete message or nothing
+     */
+    std::optional<Message> incomplete() const;
+
+    /**
+     * @brief Exchange stored messages with other buffer in constant time
+     *        (messages of the buffers placed in a file are copied).
+     *        Limits, handlers and state of the input stream are not swapped.
+     *
+     * @param[in] other buffer to exchange messages with
+     */
+    void swap(LogBuffer& other);
+
+    /**
+     * @brief Place the rings in the memory mapped file and recover messages
+     *        stored there by the previous instance of the service.
+     *        The size of the file is defined by the byte limit, which must be
+     *        set. Messages stored in the buffer before the call are dropped.
+     *
+     * @param[in] path path to the file
+     *
+     * @throw std::invalid_argument if the byte limit is not set
+     * @throw std::system_error in case of errors
+     *
+     * @return number of recovered messages
+     */
+    size_t persist(const std::string& path);
+
     /** @brief Clear (reset) container. */
     virtual void clear();
     /** @brief Check container for empty. */
     virtual bool empty() const;
+    /** @brief Get number of stored messages. */
+    size_t size() const;
+    /** @brief Get size of stored messages in bytes, including the index. */
+    size_t usage() const;
+    /** @brief Get size of the allocated rings in bytes. */
+    size_t capacity() const;
     /** @brief Get container's iterator. */
-    container_t::const_iterator begin() const;
+    const_iterator begin() const;
     /** @brief Get container's iterator. */
-    container_t::const_iterator end() const;
+    const_iterator end() const;
 
   private:
-    /** @brief Remove the oldest messages from container. */
-    void shrink();
+    /**
+     * @struct Entry
+     * @brief Index record: describes a single message in the byte ring.
+     */
+    struct Entry
+    {
+        /** @brief Offset of the message text in the byte ring. */
+        uint32_t offset;
+        /** @brief Size of the message text in bytes. */
+        uint32_t size : 31;
+        /** @brief Flag to indicate that the message continues a long line. */
+        uint32_t continued : 1;
+        /** @brief Creation time relative to the previous message. */
+        uint32_t delta;
+    };
+
+    /**
+     * @struct State
+     * @brief State of the rings saved in the file.
+     *        The state is committed to one of the two slots of the file
+     *        header, the slot with the valid checksum and the greatest
+     *        sequence number is restored, see RingFile.
+     */
+    struct State
+    {
+        /** @brief Offset of the first free byte in the data ring. */
+        uint64_t head;
+        /** @brief Position of the oldest message in the index ring. */
+        uint64_t first;
+        /** @brief Number of messages in the index ring. */
+        uint64_t count;
+        /** @brief Size of stored messages in bytes, including the index,
+         *         checked against the index on restore. */
+        uint64_t bytes;
+        /** @brief Sequence number of the first message after the wrap. */
+        uint64_t wrapSeq;
+        /** @brief Sequence number of the oldest message. */
+        uint64_t firstSeq;
+        /** @brief Creation time of the oldest message in nanoseconds. */
+        int64_t firstTime;
+        /** @brief Creation time of the newest message in nanoseconds. */
+        int64_t lastTime;
+        /** @brief Non-zero if the head has wrapped around the data ring. */
+        uint32_t wrapped;
+        /** @brief Padding to keep the size 8-byte aligned, always zero. */
+        uint32_t reserved;
+    };
+
+    /**
+     * @brief Encode time interval between two messages.
+     *
+     * @param[in] ns time interval in nanoseconds
+     *
+     * @return encoded value, which may be less precise for long intervals
+     */
+    static uint32_t encodeDelta(int64_t ns);
+
+    /**
+     * @brief Decode time interval between two messages.
+     *
+     * @param[in] delta encoded value
+     *
+     * @return time interval in nanoseconds
+     */
+    static int64_t decodeDelta(uint32_t delta);
+
+    /**
+     * @brief Get index record by position of the message.
+     *
+     * @param[in] pos position of the message, 0 is the oldest one
+     *
+     * @return index record
+     */
+    const Entry& entry(size_t pos) const;
+
+    /**
+     * @brief Get message by its position.
+     *
+     * @param[in] pos position of the message, 0 is the oldest one
+     * @param[in] time creation time of the message in nanoseconds
+     *
+     * @return message
+     */
+    Message at(size_t pos, int64_t time) const;
+
+    /** @brief Get index record of the oldest message. */
+    Entry& front();
+    /** @brief Get index record of the newest message. */
+    Entry& back();
+
+    /**
+     * @brief Add part of the input split by EOL, long lines are split into
+     *        several messages.
+     *
+     * @param[in] text pointer to the text
+     * @param[in] len size of the text in bytes
+     * @param[in] eol flag to indicate that the part is terminated by EOL
+     * @param[in,out] now current time in nanoseconds, 0 if not yet known
+     */
+    void addPart(const char* text, size_t len, bool eol, int64_t& now);
+
+    /**
+     * @brief Add new message to the container.
+     *
+     * @param[in] text pointer to the message text
+     * @param[in] len size of the message text in bytes
+     * @param[in] time creation time of the message in nanoseconds
+     * @param[in] continued flag to indicate that the message continues
+     *                      the previous one
+     */
+    void pushBack(const char* text, size_t len, int64_t time, bool continued);
+
+    /**
+     * @brief Append text to the newest message.
+     *
+     * @param[in] text pointer to the text
+     * @param[in] len size of the text in bytes
+     */
+    void extendBack(const char* text, size_t len);
+
+    /** @brief Remove the oldest message from container. */
+    void popFront();
+
+    /**
+     * @brief Remove the oldest message to make room in the rings of fixed
+     *        size and commit the state, so the space can be reused.
+     */
+    void evict();
+
+    /** @brief Save the state of the rings to the file, if any. */
+    void commit();
+
+    /**
+     * @brief Restore the state of the rings saved in the file.
+     *
+     * @param[in] state saved state
+     *
+     * @return false if the state doesn't match the rings
+     */
+    bool restore(const State& state);
+
+    /**
+     * @brief Replace stored messages with a copy of the other buffer.
+     *
+     * @param[in] other buffer to copy messages from
+     */
+    void copy(const LogBuffer& other);
+
+    /**
+     * @brief Reserve room for the contiguous text in the byte ring: the heap
+     *        ring grows, the oldest messages are removed from the ring of
+     *        fixed size.
+     *
+     * @param[in] start offset of the data already owned by the text,
+     *                  equal to the ring head for a new message
+     * @param[in] need total size of the text in bytes
+     * @param[in] extend true if the newest message is being extended
+     *
+     * @return offset of the text in the byte ring
+     */
+    size_t reserve(size_t start, size_t need, bool extend);
+
+    /**
+     * @brief Find a place for the contiguous text in the free space of the
+     *        byte ring.
+     *
+     * @param[in] start offset of the data already owned by the text,
+     *                  equal to the ring head for a new message
+     * @param[in] need total size of the text in bytes
+     * @param[in] extend true if the newest message is being extended
+     *
+     * @return offset of the text in the byte ring or npos if there is no room
+     */
+    size_t place(size_t start, size_t need, bool extend);
+
+    /**
+     * @brief Reallocate the byte ring and place all messages in order starting
+     *        from the beginning of the new ring.
+     *
+     * @param[in] minSize min size of the new ring in bytes
+     */
+    void grow(size_t minSize);
+
+    /**
+     * @brief Remove the oldest messages from container, the incomplete
+     *        message is kept.
+     *
+     * @param[in] now current time in nanoseconds, 0 if not yet known
+     */
+    void shrink(int64_t now);
 
   private:
-    /** @brief Log message list. */
-    container_t messages;
+    /** @brief Byte ring with message texts. */
+    std::span<char> data;
+    /** @brief Heap storage of the byte ring. */
+    std::vector<char> heapData;
+    /** @brief Offset of the first free byte after the newest message. */
+    size_t head;
+    /** @brief Flag to indicate that the head has wrapped around the ring. */
+    bool wrapped;
+    /** @brief Sequence number of the first message placed after the wrap. */
+    uint64_t wrapSeq;
+
+    /** @brief Index ring with message descriptions. */
+    std::span<Entry> index;
+    /** @brief Heap storage of the index ring. */
+    std::vector<Entry> heapIndex;
+    /** @brief File with the rings of fixed size, if the buffer persists. */
+    std::unique_ptr<RingFile> ringFile;
+    /** @brief Position of the oldest message in the index ring. */
+    size_t first;
+    /** @brief Number of messages in the index ring. */
+    size_t count;
+    /** @brief Size of stored messages in bytes, including the index. */
+    size_t bytes;
+    /** @brief Sequence number of the oldest message. */
+    uint64_t firstSeq;
+    /** @brief Creation time of the oldest message in nanoseconds. */
+    int64_t firstTime;
+    /** @brief Creation time of the newest message in nanoseconds. */
+    int64_t lastTime;
+    /** @brief Clock used to stamp messages. */
+    CoarseClock clock;
+
+    /** @brief Splitter of the console output into messages. */
+    LineTokenizer tokenizer;
     /** @brief Flag to indicate that the last message is incomplete. */
     bool lastComplete;
     /** @brief Max number of messages that can be stored. */
     size_t sizeLimit;
     /** @brief Max age of messages (in minutes) that can be stored. */
     size_t timeLimit;
+    /** @brief Max size of stored messages in bytes. */
+    size_t bytesLimit;
+    /** @brief Max length of a single message in bytes. */
+    size_t lineLimit;
     /** @brief Callback function called if buffer is full. */
     std::function<void()> fullHandler;
+    /** @brief Callback function called for each completed message. */
+    std::function<void(const Message&)> messageHandler;
+    /** @brief Callback function called for each part of the input. */
+    std::function<void(const char*, size_t, bool)> partHandler;
 };
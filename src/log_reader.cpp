@@ -0,0 +1,499 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "log_reader.hpp"
+
+#include "zlib_block_file.hpp"
+
+#include <zlib.h>
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <regex>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+/** @brief Extensions of log files of all compression algorithms. */
+static constexpr std::string_view extensions[] = {".log", ".log.gz",
+                                                  ".log.zst", ".log.lz4"};
+/** @brief Length of the time stamp in the file name: _YYYYMMDD_HHMMSS. */
+static constexpr size_t nameStampLen = 16;
+/** @brief Max number of blocks decompressed by a single job. */
+static constexpr size_t blocksPerJob = 16;
+
+/**
+ * @brief Parse fixed-width decimal number.
+ *
+ * @param[in] text text of the number
+ * @param[out] value parsed number
+ *
+ * @return false if the text has non-digit characters
+ */
+static bool parseNum(std::string_view text, int& value)
+{
+    value = 0;
+    for (const char ch : text)
+    {
+        if (ch < '0' || ch > '9')
+        {
+            return false;
+        }
+        value = value * 10 + (ch - '0');
+    }
+    return !text.empty();
+}
+
+/** @brief Check if the text is the time stamp of the file name. */
+static bool isNameStamp(std::string_view text)
+{
+    int num;
+    return text.size() == nameStampLen && text[0] == '_' && text[9] == '_' &&
+           parseNum(text.substr(1, 8), num) && parseNum(text.substr(10), num);
+}
+
+/**
+ * @brief Get number of days since epoch for the civil date.
+ *        Howard Hinnant's algorithm, much faster than timegm.
+ */
+static int64_t daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yoe = year - era * 400;
+    const int64_t mp = month + (month > 2 ? -3 : 9);
+    const int64_t doy = (153 * mp + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/**
+ * @brief Get creation time of the log file from its name, the file has no
+ *        records after this time.
+ *
+ * @param[in] fileName name of the log file
+ *
+ * @return time in milliseconds since epoch, max int64 if unknown
+ */
+static int64_t fileTime(std::string_view fileName)
+{
+    const std::string_view inst = LogReader::instance(fileName);
+    const std::string_view stamp = fileName.substr(inst.size(), nameStampLen);
+    tm tmLocal{};
+    if (!isNameStamp(stamp) || !parseNum(stamp.substr(1, 4), tmLocal.tm_year) ||
+        !parseNum(stamp.substr(5, 2), tmLocal.tm_mon) ||
+        !parseNum(stamp.substr(7, 2), tmLocal.tm_mday) ||
+        !parseNum(stamp.substr(10, 2), tmLocal.tm_hour) ||
+        !parseNum(stamp.substr(12, 2), tmLocal.tm_min) ||
+        !parseNum(stamp.substr(14, 2), tmLocal.tm_sec))
+    {
+        return std::numeric_limits<int64_t>::max();
+    }
+    tmLocal.tm_year -= 1900;
+    tmLocal.tm_mon -= 1;
+    tmLocal.tm_isdst = -1;
+    const time_t time = mktime(&tmLocal);
+    if (time == -1)
+    {
+        return std::numeric_limits<int64_t>::max();
+    }
+    // Name has seconds only
+    return (static_cast<int64_t>(time) + 1) * 1000;
+}
+
+/**
+ * @brief Decompress the whole log file.
+ *
+ * @param[in] path path to the file
+ *
+ * @throw std::exception in case of errors
+ *
+ * @return text of the log
+ */
+static std::string decompress(const std::string& path)
+{
+    std::string text;
+    if (path.ends_with(".log"))
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            throw std::runtime_error("Unable to open " + path);
+        }
+        text.assign(std::istreambuf_iterator<char>(file), {});
+        return text;
+    }
+
+    if (path.ends_with(".gz"))
+    {
+        // Reads concatenated gzip members too
+        gzFile fd = gzopen(path.c_str(), "rb");
+        if (!fd)
+        {
+            throw std::runtime_error("Unable to open " + path);
+        }
+        gzbuffer(fd, 128 * 1024);
+        char buf[64 * 1024];
+        int len;
+        while ((len = gzread(fd, buf, sizeof(buf))) > 0)
+        {
+            text.append(buf, static_cast<size_t>(len));
+        }
+        int err = Z_OK;
+        const char* msg = len < 0 ? gzerror(fd, &err) : nullptr;
+        gzclose(fd);
+        if (msg)
+        {
+            throw std::runtime_error("Unable to read " + path + ": " + msg);
+        }
+        return text;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Unable to open " + path);
+    }
+    const std::string input(std::istreambuf_iterator<char>(file), {});
+    std::vector<char> buf(64 * 1024);
+#ifdef HAVE_ZSTD
+    if (path.ends_with(".zst"))
+    {
+        std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream*)> stream(
+            ZSTD_createDStream(), ZSTD_freeDStream);
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        ZSTD_outBuffer out{};
+        size_t rc = 0;
+        do
+        {
+            // The decoder may hold more output after the input is consumed
+            out = ZSTD_outBuffer{buf.data(), buf.size(), 0};
+            rc = ZSTD_decompressStream(stream.get(), &out, &in);
+            if (ZSTD_isError(rc))
+            {
+                throw std::runtime_error("Unable to read " + path + ": " +
+                                         ZSTD_getErrorName(rc));
+            }
+            text.append(buf.data(), out.pos);
+        } while (in.pos < in.size || out.pos == out.size);
+        if (rc != 0)
+        {
+            throw std::runtime_error("Unable to read " + path +
+                                     ": truncated frame");
+        }
+        return text;
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (path.ends_with(".lz4"))
+    {
+        LZ4F_dctx* ctx = nullptr;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION)))
+        {
+            throw std::runtime_error("Unable to initialize lz4");
+        }
+        const char* src = input.data();
+        const char* const end = src + input.size();
+        size_t outLen = 0;
+        while (src < end || outLen == buf.size())
+        {
+            outLen = buf.size();
+            size_t inLen = static_cast<size_t>(end - src);
+            const size_t rc =
+                LZ4F_decompress(ctx, buf.data(), &outLen, src, &inLen, nullptr);
+            if (LZ4F_isError(rc))
+            {
+                LZ4F_freeDecompressionContext(ctx);
+                throw std::runtime_error("Unable to read " + path + ": " +
+                                         LZ4F_getErrorName(rc));
+            }
+            text.append(buf.data(), outLen);
+            src += inLen;
+        }
+        LZ4F_freeDecompressionContext(ctx);
+        return text;
+    }
+#endif
+    throw std::runtime_error("Compression of " + path + " is not supported");
+}
+
+/**
+ * @struct Job
+ * @brief Part of a log file to read by a single thread.
+ */
+struct Job
+{
+    /** @brief Path to the file. */
+    std::string path;
+    /** @brief Name of the instance. */
+    std::string instance;
+    /** @brief First block to read, the whole file if there is no index. */
+    ZlibBlockFile::Block begin;
+    /** @brief Block that follows the last one to read. */
+    ZlibBlockFile::Block end;
+    /** @brief Flag to read only the blocks. */
+    bool blocks;
+    /** @brief Decompressed text. */
+    std::string text;
+    /** @brief Records that match the query, refer to the text. */
+    std::vector<LogReader::Record> records;
+};
+
+LogReader::LogReader(const std::string& dir, const Query& query) :
+    dir(dir), query(query)
+{
+    if (!query.pattern.empty())
+    {
+        // Check the pattern before reading files
+        std::regex(query.pattern, std::regex::ECMAScript);
+    }
+}
+
+size_t LogReader::read(const Handler& handler) const
+{
+    // Select files by instance and creation time
+    std::vector<std::pair<std::string, std::string>> files;
+    for (const auto& entry : fs::directory_iterator(dir))
+    {
+        const std::string name = entry.path().filename();
+        const std::string_view inst = instance(name);
+        if (inst.empty() || !entry.is_regular_file() ||
+            (!query.instances.empty() &&
+             std::find(query.instances.begin(), query.instances.end(),
+                       inst) == query.instances.end()) ||
+            fileTime(name) < query.since)
+        {
+            continue;
+        }
+        files.emplace_back(entry.path(), inst);
+    }
+    std::sort(files.begin(), files.end());
+
+    // Split the files into jobs: use the index to skip blocks out of range
+    std::vector<Job> jobs;
+    for (const auto& [path, inst] : files)
+    {
+        std::vector<ZlibBlockFile::Block> index;
+        if (path.ends_with(".gz"))
+        {
+            try
+            {
+                index = ZlibBlockFile::readIndex(path);
+            }
+            catch (const std::exception& ex)
+            {
+                fprintf(stderr, "%s\n", ex.what());
+                continue;
+            }
+        }
+        if (index.size() < 2)
+        {
+            jobs.push_back(Job{path, inst, {}, {}, false, {}, {}});
+            continue;
+        }
+        // Block i holds records from index[i].time to index[i + 1].time
+        size_t first = 0;
+        while (first + 1 < index.size() && index[first + 1].time < query.since)
+        {
+            ++first;
+        }
+        size_t last = first;
+        while (last + 1 < index.size() && index[last].time <= query.until)
+        {
+            ++last;
+        }
+        for (size_t i = first; i < last; i += blocksPerJob)
+        {
+            const size_t next = std::min(i + blocksPerJob, last);
+            jobs.push_back(
+                Job{path, inst, index[i], index[next], true, {}, {}});
+        }
+    }
+
+    // Decompress and filter in parallel
+    const size_t threadsNum = std::min(
+        jobs.size(),
+        query.jobs ? query.jobs
+                   : std::max<size_t>(std::thread::hardware_concurrency(), 1));
+    std::atomic<size_t> nextJob = 0;
+    const auto worker = [this, &jobs, &nextJob]() {
+        std::regex regex;
+        if (!query.pattern.empty())
+        {
+            regex.assign(query.pattern,
+                         std::regex::ECMAScript | std::regex::optimize);
+        }
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+        {
+            Job& job = jobs[i];
+            try
+            {
+                job.text = job.blocks ? ZlibBlockFile::readBlocks(
+                                            job.path, job.begin, job.end)
+                                      : decompress(job.path);
+            }
+            catch (const std::exception& ex)
+            {
+                fprintf(stderr, "%s\n", ex.what());
+                continue;
+            }
+
+            // Lines without time stamp belong to the previous record
+            const std::string_view text = job.text;
+            int64_t time = std::numeric_limits<int64_t>::min();
+            size_t pos = 0;
+            while (pos < text.size())
+            {
+                size_t eol = text.find('\n', pos);
+                if (eol == std::string_view::npos)
+                {
+                    eol = text.size();
+                }
+                const std::string_view line = text.substr(pos, eol - pos);
+                pos = eol + 1;
+
+                const int64_t lineTime = parseTime(line);
+                if (lineTime != std::numeric_limits<int64_t>::min())
+                {
+                    time = lineTime;
+                }
+                if (time < query.since || time > query.until ||
+                    (!query.pattern.empty() &&
+                     !std::regex_search(line.begin(), line.end(), regex)))
+                {
+                    continue;
+                }
+                job.records.push_back(Record{time, job.instance, line});
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadsNum; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Merge records of all jobs in time order, the order of records with
+    // the same time stamp is kept
+    using Cursor = std::pair<size_t, size_t>; // job, record
+    const auto later = [&jobs](const Cursor& lhs, const Cursor& rhs) {
+        const int64_t lhsTime = jobs[lhs.first].records[lhs.second].time;
+        const int64_t rhsTime = jobs[rhs.first].records[rhs.second].time;
+        return lhsTime != rhsTime ? lhsTime > rhsTime : lhs.first > rhs.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> queue(
+        later);
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        if (!jobs[i].records.empty())
+        {
+            queue.emplace(i, 0);
+        }
+    }
+    size_t count = 0;
+    while (!queue.empty())
+    {
+        const auto [job, record] = queue.top();
+        queue.pop();
+        handler(jobs[job].records[record]);
+        ++count;
+        if (record + 1 < jobs[job].records.size())
+        {
+            queue.emplace(job, record + 1);
+        }
+    }
+
+    return count;
+}
+
+std::string_view LogReader::instance(std::string_view fileName)
+{
+    // {instance}_{YYYYMMDD_HHMMSS}[_N]{ext}
+    std::string_view base;
+    for (const std::string_view ext : extensions)
+    {
+        if (fileName.ends_with(ext))
+        {
+            base = fileName.substr(0, fileName.size() - ext.size());
+        }
+    }
+    if (base.size() <= nameStampLen || fileName.front() == '.')
+    {
+        return {};
+    }
+    if (!isNameStamp(base.substr(base.size() - nameStampLen)))
+    {
+        // Postfix of duplicate names
+        const size_t sep = base.rfind('_');
+        int num;
+        if (sep == std::string_view::npos ||
+            !parseNum(base.substr(sep + 1), num))
+        {
+            return {};
+        }
+        base = base.substr(0, sep);
+        if (base.size() <= nameStampLen ||
+            !isNameStamp(base.substr(base.size() - nameStampLen)))
+        {
+            return {};
+        }
+    }
+    return base.substr(0, base.size() - nameStampLen);
+}
+
+int64_t LogReader::parseTime(std::string_view text)
+{
+    // [ YYYY-MM-DDTHH:MM:SS.mmm+hh:mm ]
+    constexpr int64_t invalid = std::numeric_limits<int64_t>::min();
+    if (!text.starts_with("[ "))
+    {
+        return invalid;
+    }
+    const size_t dash = text.find('-', 2);
+    if (dash == std::string_view::npos || dash < 3 || dash > 7)
+    {
+        return invalid;
+    }
+    const std::string_view stamp = text.substr(dash);
+    int year, month, day, hour, minute, second, ms, tzHour, tzMinute;
+    if (stamp.size() < 28 || stamp[3] != '-' || stamp[6] != 'T' ||
+        stamp[9] != ':' || stamp[12] != ':' || stamp[15] != '.' ||
+        (stamp[19] != '+' && stamp[19] != '-') || stamp[22] != ':' ||
+        stamp[25] != ' ' || stamp[26] != ']' ||
+        !parseNum(text.substr(2, dash - 2), year) ||
+        !parseNum(stamp.substr(1, 2), month) ||
+        !parseNum(stamp.substr(4, 2), day) ||
+        !parseNum(stamp.substr(7, 2), hour) ||
+        !parseNum(stamp.substr(10, 2), minute) ||
+        !parseNum(stamp.substr(13, 2), second) ||
+        !parseNum(stamp.substr(16, 3), ms) ||
+        !parseNum(stamp.substr(20, 2), tzHour) ||
+        !parseNum(stamp.substr(23, 2), tzMinute))
+    {
+        return invalid;
+    }
+    const int64_t offset =
+        (stamp[19] == '-' ? -1 : 1) * (tzHour * 3600 + tzMinute * 60);
+    const int64_t local = daysFromCivil(year, month, day) * 86400 +
+                          hour * 3600 + minute * 60 + second;
+    return (local - offset) * 1000 + ms;
+}
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class LogReader
+ * @brief Reader of the log files saved by FileStorage.
+ *
+ * Files of the output directory are filtered by instance (the file name
+ * prefix) and decompressed in parallel: the whole file or, if it has the
+ * block index, only the blocks that overlap the time range. Records are
+ * filtered by time and pattern, then merged from all files in time order.
+ */
+class LogReader
+{
+  public:
+    /**
+     * @struct Query
+     * @brief Filter of log records.
+     */
+    struct Query
+    {
+        /** @brief Min time stamp of records in milliseconds since epoch. */
+        int64_t since = std::numeric_limits<int64_t>::min();
+        /** @brief Max time stamp of records in milliseconds since epoch. */
+        int64_t until = std::numeric_limits<int64_t>::max();
+        /** @brief Names of instances to read, empty for all. */
+        std::vector<std::string> instances;
+        /** @brief Regular expression (ECMAScript) to search in records. */
+        std::string pattern;
+        /** @brief Number of threads, 0 for the number of CPUs. */
+        size_t jobs = 0;
+    };
+
+    /**
+     * @struct Record
+     * @brief Log record, valid within the handler call only.
+     */
+    struct Record
+    {
+        /** @brief Time stamp in milliseconds since epoch. */
+        int64_t time;
+        /** @brief Name of the instance that wrote the record. */
+        std::string_view instance;
+        /** @brief Text of the record with the time stamp, without EOL. */
+        std::string_view text;
+    };
+
+    /** @brief Handler of the records. */
+    using Handler = std::function<void(const Record&)>;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] dir path to the directory with log files
+     * @param[in] query filter of log records
+     *
+     * @throw std::regex_error if the pattern is invalid
+     */
+    LogReader(const std::string& dir, const Query& query);
+
+    /**
+     * @brief Read the log files and pass records to the handler in time
+     *        order. Files that can not be read are reported to stderr.
+     *
+     * @param[in] handler handler of the records
+     *
+     * @throw std::exception if the directory can not be read
+     *
+     * @return number of passed records
+     */
+    size_t read(const Handler& handler) const;
+
+    /**
+     * @brief Get name of the instance from the log file name.
+     *
+     * @param[in] fileName name of the file without directory
+     *
+     * @return name of the instance, empty if it is not a log file
+     */
+    static std::string_view instance(std::string_view fileName);
+
+    /**
+     * @brief Parse time stamp of the record written by LogWriter.
+     *
+     * @param[in] text text of the record
+     *
+     * @return time stamp in milliseconds since epoch, min int64 if the text
+     *         has no valid time stamp
+     */
+    static int64_t parseTime(std::string_view text);
+
+  private:
+    /** @brief Path to the directory with log files. */
+    std::string dir;
+    /** @brief Filter of log records. */
+    Query query;
+};
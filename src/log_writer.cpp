@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "log_writer.hpp"
+
+#include "plain_file.hpp"
+#include "zlib_block_file.hpp"
+#include "zlib_file.hpp"
+#include "zlib_parallel_file.hpp"
+#ifdef HAVE_LZ4
+#include "lz4_file.hpp"
+#endif
+#ifdef HAVE_ZSTD
+#include "zstd_file.hpp"
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+std::unique_ptr<LogWriter> LogWriter::create(Compression compression,
+                                             size_t level,
+                                             const std::string& fileName,
+                                             size_t threads, size_t blockSize)
+{
+    switch (compression)
+    {
+        case Compression::none:
+            return std::make_unique<PlainFile>(fileName);
+        case Compression::zlib:
+        {
+            const int zlevel =
+                level ? static_cast<int>(level) : Z_DEFAULT_COMPRESSION;
+            if (blockSize)
+            {
+                return std::make_unique<ZlibBlockFile>(fileName, zlevel,
+                                                       blockSize);
+            }
+            if (threads > 1)
+            {
+                return std::make_unique<ZlibParallelFile>(fileName, zlevel,
+                                                          threads);
+            }
+            return std::make_unique<ZlibFile>(fileName, zlevel);
+        }
+#ifdef HAVE_ZSTD
+        case Compression::zstd:
+            return std::make_unique<ZstdFile>(fileName,
+                                              static_cast<int>(level));
+#endif
+#ifdef HAVE_LZ4
+        case Compression::lz4:
+            return std::make_unique<Lz4File>(fileName,
+                                             static_cast<int>(level));
+#endif
+        default:
+            throw std::invalid_argument(
+                "Compression algorithm is not supported");
+    }
+}
+
+const char* LogWriter::extension(Compression compression)
+{
+    switch (compression)
+    {
+        case Compression::none:
+            return ".log";
+        case Compression::zlib:
+            return ".log.gz";
+        case Compression::zstd:
+            return ".log.zst";
+        case Compression::lz4:
+            return ".log.lz4";
+    }
+    return ".log";
+}
+
+LogWriter::LogWriter(const std::string& fileName) :
+    fileName(fileName), fd(-1), input(bufferSize), inputLen(0)
+{}
+
+LogWriter::~LogWriter()
+{
+    if (fd != -1)
+    {
+        ::close(fd);
+    }
+}
+
+void LogWriter::write(const timespec& timeStamp, std::string_view message,
+                      bool continued)
+{
+    startRecord(timeStamp);
+
+    // Write time stamp with milliseconds
+    const std::string_view prefix = timeFormatter.format(timeStamp);
+    put(prefix.data(), prefix.length());
+
+    if (continued)
+    {
+        put(continuationMark.data(), continuationMark.length());
+    }
+
+    // Write message
+    put(message.data(), message.length());
+
+    // Write EOL
+    put("\n", 1);
+}
+
+void LogWriter::sync()
+{
+    flushInput(Flush::sync);
+}
+
+void LogWriter::startRecord(const timespec& /*timeStamp*/) {}
+
+size_t LogWriter::buffered() const
+{
+    return inputLen;
+}
+
+void LogWriter::flushInput(Flush flush)
+{
+    // Staging buffer is consumed entirely
+    const size_t len = inputLen;
+    inputLen = 0;
+    encode(input.data(), len, flush);
+}
+
+bool LogWriter::openFile()
+{
+    fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+              0666);
+    return fd != -1;
+}
+
+bool LogWriter::writeFile(const void* data, size_t len)
+{
+    const char* ptr = static_cast<const char*>(data);
+    while (len)
+    {
+        const ssize_t rc = ::write(fd, ptr, len);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        ptr += rc;
+        len -= static_cast<size_t>(rc);
+    }
+    return true;
+}
+
+bool LogWriter::closeFile()
+{
+    const int rc = ::close(fd);
+    fd = -1;
+    return rc == 0;
+}
+
+bool LogWriter::isOpen() const
+{
+    return fd != -1;
+}
+
+void LogWriter::writeTrailer() {}
+
+void LogWriter::releaseEncoder() {}
+
+bool LogWriter::finishFile()
+{
+    if (!isOpen())
+    {
+        return true;
+    }
+
+    // The descriptor is released even if closing fails
+    try
+    {
+        flushInput(Flush::finish);
+        writeTrailer();
+    }
+    catch (const std::exception&)
+    {
+        releaseEncoder();
+        closeFile();
+        throw;
+    }
+    releaseEncoder();
+    if (!closeFile())
+    {
+        return false;
+    }
+    fileName.clear();
+    return true;
+}
+
+void LogWriter::abandonFile()
+{
+    if (isOpen())
+    {
+        try
+        {
+            flushInput(Flush::finish);
+        }
+        catch (const std::exception&)
+        {
+            // Nothing to do, the file is incomplete
+        }
+        releaseEncoder();
+    }
+}
+
+void LogWriter::failFile(const char* operation) const
+{
+    const int code = errno;
+    std::string err = "Unable to ";
+    err += operation;
+    err += " file ";
+    err += fileName;
+    throw std::system_error(code, std::generic_category(), err);
+}
+
+void LogWriter::put(const char* data, size_t len)
+{
+    if (len >= input.size())
+    {
+        // Large data is encoded directly without copying
+        if (inputLen)
+        {
+            flushInput(Flush::none);
+        }
+        while (len)
+        {
+            const size_t chunk = std::min(len, input.size());
+            encode(data, chunk, Flush::none);
+            data += chunk;
+            len -= chunk;
+        }
+        return;
+    }
+
+    while (len)
+    {
+        const size_t copyLen = std::min(len, input.size() - inputLen);
+        memcpy(input.data() + inputLen, data, copyLen);
+        inputLen += copyLen;
+        data += copyLen;
+        len -= copyLen;
+        if (inputLen == input.size())
+        {
+            flushInput(Flush::none);
+        }
+    }
+}
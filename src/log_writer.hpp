@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "config.hpp"
+#include "time_formatter.hpp"
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class LogWriter
+ * @brief Log file writer, base class for all compression algorithms.
+ *
+ * Records are formatted into a staging buffer, which is passed to the
+ * encoder when filled up, so writing a record is mostly a memory copy.
+ */
+class LogWriter
+{
+  public:
+    virtual ~LogWriter();
+
+    LogWriter(const LogWriter&) = delete;
+    LogWriter& operator=(const LogWriter&) = delete;
+
+    /**
+     * @brief Create writer for the specified compression algorithm.
+     *
+     * @param[in] compression compression algorithm
+     * @param[in] level compression level, 0 for the algorithm's default
+     * @param[in] fileName path to the file
+     * @param[in] threads number of compression threads, if supported
+     * @param[in] blockSize size of independently compressed blocks with the
+     *                      index, 0 to compress the file as a single stream
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return pointer to the writer
+     */
+    static std::unique_ptr<LogWriter> create(Compression compression,
+                                             size_t level,
+                                             const std::string& fileName,
+                                             size_t threads = 1,
+                                             size_t blockSize = 0);
+
+    /**
+     * @brief Get extension of log files for the compression algorithm.
+     *
+     * @param[in] compression compression algorithm
+     *
+     * @return file extension, including the leading dot
+     */
+    static const char* extension(Compression compression);
+
+    /**
+     * @brief Write single log message to the file.
+     *
+     * @param[in] timeStamp time stamp of the log message
+     * @param[in] message log message text
+     * @param[in] continued flag to indicate that the message continues
+     *                      the previous one, which has reached the max line
+     *                      length; such message is marked with the prefix
+     *
+     * @throw std::exception in case of errors
+     */
+    void write(const timespec& timeStamp, std::string_view message,
+               bool continued = false);
+
+    /** @brief Prefix of the message that continues a too long line. */
+    static constexpr std::string_view continuationMark = "... ";
+
+    /**
+     * @brief Flush pending output, so the file can be decompressed up to the
+     *        current point.
+     *
+     * @throw std::exception in case of errors
+     */
+    void sync();
+
+    /**
+     * @brief Close file.
+     *
+     * @throw std::exception in case of errors
+     */
+    virtual void close() = 0;
+
+  protected:
+    /** @brief Flush modes of the encoder. */
+    enum class Flush
+    {
+        none,
+        sync,
+        finish
+    };
+
+    /** @brief Max size of data passed to the encoder at once. */
+    static constexpr size_t bufferSize = 64 * 1024;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] fileName path to the file
+     */
+    explicit LogWriter(const std::string& fileName);
+
+    /**
+     * @brief Called before a record is put to the staging buffer, the buffer
+     *        contains only complete records at this point.
+     *
+     * @param[in] timeStamp time stamp of the record
+     */
+    virtual void startRecord(const timespec& timeStamp);
+
+    /** @brief Get size of data in the staging buffer. */
+    size_t buffered() const;
+
+    /**
+     * @brief Encode data and write the output to the file.
+     *
+     * @param[in] data pointer to the data
+     * @param[in] len size of the data in bytes, up to bufferSize
+     * @param[in] flush flush mode
+     *
+     * @throw std::exception in case of errors
+     */
+    virtual void encode(const char* data, size_t len, Flush flush) = 0;
+
+    /**
+     * @brief Encode content of the staging buffer.
+     *
+     * @param[in] flush flush mode
+     *
+     * @throw std::exception in case of errors
+     */
+    void flushInput(Flush flush);
+
+    /**
+     * @brief Create the file.
+     *
+     * @return false in case of errors, errno is set
+     */
+    bool openFile();
+
+    /**
+     * @brief Write data to the file.
+     *
+     * @param[in] data pointer to the data
+     * @param[in] len size of the data in bytes
+     *
+     * @return false in case of errors, errno is set
+     */
+    bool writeFile(const void* data, size_t len);
+
+    /**
+     * @brief Close the file.
+     *
+     * @return false in case of errors, errno is set
+     */
+    bool closeFile();
+
+    /** @brief Check if the file is opened. */
+    bool isOpen() const;
+
+    /**
+     * @brief Write data that follows the encoded stream, called on close.
+     *
+     * @throw std::exception in case of errors
+     */
+    virtual void writeTrailer();
+
+    /** @brief Release the encoder, called once when the file is closed. */
+    virtual void releaseEncoder();
+
+    /**
+     * @brief Finish the stream and close the file.
+     *        The encoder and the descriptor are released even if it fails.
+     *
+     * @throw std::exception in case of encoding errors
+     *
+     * @return false if the file could not be closed, errno is set
+     */
+    bool finishFile();
+
+    /**
+     * @brief Finish the stream on destruction, errors are ignored.
+     */
+    void abandonFile();
+
+    /**
+     * @brief Throw exception for the failed file operation, errno is used.
+     *
+     * @param[in] operation name of the operation: create, write, close
+     */
+    [[noreturn]] void failFile(const char* operation) const;
+
+  private:
+    /**
+     * @brief Add data to the staging buffer, encode it if buffer is full.
+     *
+     * @param[in] data pointer to the data
+     * @param[in] len size of the data in bytes
+     *
+     * @throw std::exception in case of errors
+     */
+    void put(const char* data, size_t len);
+
+  protected:
+    /** @brief File name. */
+    std::string fileName;
+
+  private:
+    /** @brief File descriptor, -1 if file is closed. */
+    int fd;
+    /** @brief Staging buffer with formatted records. */
+    std::vector<char> input;
+    /** @brief Size of data in the staging buffer. */
+    size_t inputLen;
+    /** @brief Time stamp formatter, keeps the timezone of the file. */
+    TimeFormatter timeFormatter;
+};
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "lz4_file.hpp"
+
+#include <stdexcept>
+
+Lz4File::Lz4File(const std::string& fileName, int level) :
+    LogWriter(fileName), ctx(nullptr)
+{
+    if (!openFile())
+    {
+        failFile("create");
+    }
+
+    const size_t rc = LZ4F_createCompressionContext(&ctx, LZ4F_VERSION);
+    if (LZ4F_isError(rc))
+    {
+        closeFile();
+        throw std::bad_alloc();
+    }
+
+    LZ4F_preferences_t prefs{};
+    prefs.compressionLevel = level;
+    // The bound covers the whole staging buffer and the frame end
+    output.resize(LZ4F_compressBound(bufferSize, &prefs));
+
+    try
+    {
+        writeOut(
+            LZ4F_compressBegin(ctx, output.data(), output.size(), &prefs));
+    }
+    catch (const std::exception&)
+    {
+        LZ4F_freeCompressionContext(ctx);
+        closeFile();
+        throw;
+    }
+}
+
+Lz4File::~Lz4File()
+{
+    abandonFile();
+}
+
+void Lz4File::close()
+{
+    if (!finishFile())
+    {
+        failFile("close");
+    }
+}
+
+void Lz4File::releaseEncoder()
+{
+    LZ4F_freeCompressionContext(ctx);
+    ctx = nullptr;
+}
+
+void Lz4File::encode(const char* data, size_t len, Flush flush)
+{
+    if (len)
+    {
+        writeOut(LZ4F_compressUpdate(ctx, output.data(), output.size(), data,
+                                     len, nullptr));
+    }
+    if (flush == Flush::sync)
+    {
+        writeOut(LZ4F_flush(ctx, output.data(), output.size(), nullptr));
+    }
+    else if (flush == Flush::finish)
+    {
+        writeOut(LZ4F_compressEnd(ctx, output.data(), output.size(), nullptr));
+    }
+}
+
+void Lz4File::writeOut(size_t rc)
+{
+    if (LZ4F_isError(rc))
+    {
+        std::string err = "Unable to write file ";
+        err += fileName;
+        err += ": ";
+        err += LZ4F_getErrorName(rc);
+        throw std::runtime_error(err);
+    }
+    if (!writeFile(output.data(), rc))
+    {
+        failFile("write");
+    }
+}
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <lz4frame.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @class Lz4File
+ * @brief Log file writer with LZ4 frame compression.
+ */
+class Lz4File : public LogWriter
+{
+  public:
+    /**
+     * @brief Constructor create new file for writing logs.
+     *
+     * @param[in] fileName path to the file
+     * @param[in] level compression level, 0 for default (fast mode)
+     *
+     * @throw std::exception in case of errors
+     */
+    Lz4File(const std::string& fileName, int level);
+
+    ~Lz4File() override;
+
+    /**
+     * @brief Close file.
+     *
+     * @throw std::exception in case of errors
+     */
+    void close() override;
+
+  protected:
+    void encode(const char* data, size_t len, Flush flush) override;
+    void releaseEncoder() override;
+
+  private:
+    /**
+     * @brief Check result of LZ4 function and write its output to the file.
+     *
+     * @param[in] rc return code of LZ4 function: output size or error code
+     *
+     * @throw std::exception in case of errors
+     */
+    void writeOut(size_t rc);
+
+  private:
+    /** @brief Compression context. */
+    LZ4F_cctx* ctx;
+    /** @brief Compressed output buffer. */
+    std::vector<char> output;
+};
@@ -3,7 +3,9 @@
 
 #include "buffer_service.hpp"
 #include "config.hpp"
+#include "config_file.hpp"
 #include "service.hpp"
+#include "shard_loop.hpp"
 #include "stream_service.hpp"
 #include "version.hpp"
 
@@ -11,6 +13,90 @@
 
 #include <phosphor-logging/log.hpp>
 
+#include <algorithm>
+#include <csignal>
+#include <list>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using phosphor::logging::entry;
+using phosphor::logging::level;
+using phosphor::logging::log;
+
+/**
+ * @struct Console
+ * @brief Host console served by the process: connection, storage and service.
+ */
+struct Console
+{
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] config configuration of the console
+     * @param[in] dbusLoop event loop shared by all consoles
+     *
+     * @throw std::exception in case of errors
+     */
+    Console(const Config& config, DbusLoop& dbusLoop) :
+        hostConsole(config.socketId)
+    {
+        if (config.mode == Mode::streamMode)
+        {
+            log<level::INFO>("HostLogger is in stream mode.",
+                             entry("SocketId=%s", config.socketId));
+            service = std::make_unique<StreamService>(config, dbusLoop,
+                                                      hostConsole);
+        }
+        else
+        {
+            log<level::INFO>(config.mode == Mode::bothMode
+                                 ? "HostLogger is in buffer and stream mode."
+                                 : "HostLogger is in buffer mode.",
+                             entry("SocketId=%s", config.socketId));
+            logBuffer = std::make_unique<LogBuffer>(
+                config.bufMaxSize, config.bufMaxTime, config.bufMaxBytes,
+                config.bufMaxLine);
+            if (*config.bufRingDir)
+            {
+                std::string path = config.bufRingDir;
+                path += '/';
+                path += *config.socketId ? config.socketId : "host";
+                path += ".ring";
+                const size_t recovered = logBuffer->persist(path);
+                log<level::INFO>("Log buffer placed in the ring file",
+                                 entry("Path=%s", path.c_str()),
+                                 entry("Recovered=%lu", recovered));
+            }
+            fileStorage = std::make_unique<FileStorage>(
+                config.outDir, config.socketId, config.maxFiles,
+                config.compression, config.compressionLevel,
+                config.saveThreads, config.maxBytes);
+            fileStorage->setBlockSize(config.blockSize);
+            if (*config.stageDir)
+            {
+                const size_t recovered = fileStorage->setStaging(
+                    config.stageDir, config.stageBytes);
+                log<level::INFO>("Log files are staged before commit",
+                                 entry("Path=%s", config.stageDir),
+                                 entry("Recovered=%lu", recovered));
+            }
+            service = std::make_unique<BufferService>(
+                config, dbusLoop, hostConsole, *logBuffer, *fileStorage);
+        }
+    }
+
+    /** @brief Host console connection. */
+    HostConsole hostConsole;
+    /** @brief Intermediate storage, used in buffer mode. */
+    std::unique_ptr<LogBuffer> logBuffer;
+    /** @brief Persistent storage, used in buffer mode. */
+    std::unique_ptr<FileStorage> fileStorage;
+    /** @brief Log service. */
+    std::unique_ptr<Service> service;
+};
+
 /** @brief Print version info. */
 static void printVersion()
 {
@@ -27,8 +113,9 @@ static void printHelp(const char* app)
     printVersion();
     puts("Copyright (c) 2020 YADRO.");
     printf("Usage: %s [OPTION...]\n", app);
-    puts("  -v, --version  Print version and exit");
-    puts("  -h, --help     Print this help and exit");
+    puts("  -c, --config=FILE  Serve all consoles listed in the file");
+    puts("  -v, --version      Print version and exit");
+    puts("  -h, --help         Print this help and exit");
 }
 
 /** @brief Application entry point. */
@@ -36,18 +123,23 @@ int main(int argc, char* argv[])
 {
     // clang-format off
     const struct option longOpts[] = {
-        { "version", no_argument, nullptr, 'v' },
-        { "help",    no_argument, nullptr, 'h' },
-        { nullptr,   0,           nullptr,  0  }
+        { "config",  required_argument, nullptr, 'c' },
+        { "version", no_argument,       nullptr, 'v' },
+        { "help",    no_argument,       nullptr, 'h' },
+        { nullptr,   0,                 nullptr,  0  }
     };
     // clang-format on
-    const char* shortOpts = "vh";
+    const char* shortOpts = "c:vh";
+    const char* configFile = nullptr;
     opterr = 0; // prevent native error messages
     int val;
     while ((val = getopt_long(argc, argv, shortOpts, longOpts, nullptr)) != -1)
     {
         switch (val)
         {
+            case 'c':
+                configFile = optarg;
+                break;
             case 'v':
                 printVersion();
                 return EXIT_SUCCESS;
@@ -65,29 +157,79 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
+    // Handled signals are blocked before any thread is started, so they are
+    // never delivered to a thread without the event loop
+    sigset_t ss;
+    sigemptyset(&ss);
+    sigaddset(&ss, SIGTERM);
+    sigaddset(&ss, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &ss, nullptr);
+
     try
     {
-        Config config;
+        if (!configFile)
+        {
+            // Single console configured with environment variables
+            Config config;
+            DbusLoop dbus_loop;
+            Console console(config, dbus_loop);
+            console.service->run();
+            return EXIT_SUCCESS;
+        }
+
+        // All consoles share the same process and D-Bus connection
+        ConfigFile config(configFile);
         DbusLoop dbus_loop;
-        HostConsole host_console(config.socketId);
-        using phosphor::logging::level;
-        using phosphor::logging::log;
-        if (config.mode == Mode::streamMode)
+
+        // Consoles are spread over the worker threads, each one has its own
+        // event loop. With a single worker the main loop serves everything.
+        std::list<ShardLoop> shards;
+        std::vector<DbusLoop*> loops;
+        const size_t workers =
+            std::min(config.workers(), config.consoles().size());
+        if (workers > 1)
         {
-            log<level::INFO>("HostLogger is in stream mode.");
-            StreamService service(config.streamDestination, dbus_loop,
-                                  host_console);
-            service.run();
+            for (size_t i = 0; i < workers; ++i)
+            {
+                loops.push_back(&shards.emplace_back(dbus_loop));
+            }
+            dbus_loop.addSignalHandler(SIGTERM,
+                                       [&dbus_loop]() { dbus_loop.stop(0); });
         }
         else
         {
-            log<level::INFO>("HostLogger is in buffer mode.");
-            LogBuffer logBuffer(config.bufMaxSize, config.bufMaxTime);
-            FileStorage fileStorage(config.outDir, config.socketId,
-                                    config.maxFiles);
-            BufferService service(config, dbus_loop, host_console, logBuffer,
-                                  fileStorage);
-            service.run();
+            loops.push_back(&dbus_loop);
+        }
+
+        std::list<Console> consoles;
+        for (const Config& consoleConfig : config.consoles())
+        {
+            consoles.emplace_back(consoleConfig,
+                                  *loops[consoles.size() % loops.size()]);
+        }
+        for (Console& console : consoles)
+        {
+            console.service->start();
+        }
+        for (ShardLoop& shard : shards)
+        {
+            shard.start();
+        }
+        int rc = dbus_loop.run();
+        for (ShardLoop& shard : shards)
+        {
+            const int shardRc = shard.join();
+            rc = rc < 0 ? rc : shardRc;
+        }
+        // Worker threads are stopped, buffers are saved by the main thread
+        for (Console& console : consoles)
+        {
+            console.service->finish();
+        }
+        if (rc < 0)
+        {
+            std::error_code ec(-rc, std::generic_category());
+            throw std::system_error(ec, "Error in event loop");
         }
     }
     catch (const std::exception& ex)
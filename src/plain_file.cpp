@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "plain_file.hpp"
+
+PlainFile::PlainFile(const std::string& fileName) : LogWriter(fileName)
+{
+    if (!openFile())
+    {
+        failFile("create");
+    }
+}
+
+PlainFile::~PlainFile()
+{
+    abandonFile();
+}
+
+void PlainFile::close()
+{
+    if (!finishFile())
+    {
+        failFile("close");
+    }
+}
+
+void PlainFile::encode(const char* data, size_t len, Flush /*flush*/)
+{
+    // Data is written as is, the staging buffer batches small records
+    if (!writeFile(data, len))
+    {
+        failFile("write");
+    }
+}
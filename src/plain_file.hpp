@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <string>
+
+/**
+ * @class PlainFile
+ * @brief Log file writer without compression.
+ */
+class PlainFile : public LogWriter
+{
+  public:
+    /**
+     * @brief Constructor create new file for writing logs.
+     *
+     * @param[in] fileName path to the file
+     *
+     * @throw std::system_error in case of errors
+     */
+    explicit PlainFile(const std::string& fileName);
+
+    ~PlainFile() override;
+
+    /**
+     * @brief Close file.
+     *
+     * @throw std::system_error in case of errors
+     */
+    void close() override;
+
+  protected:
+    void encode(const char* data, size_t len, Flush flush) override;
+};
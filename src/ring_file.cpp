@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "ring_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+/** @brief Size of the header page, the rings are page aligned. */
+static constexpr size_t headerSize = 4096;
+/** @brief Offset of the first state slot in the header page. */
+static constexpr size_t slotsOffset = 64;
+/** @brief File signature. */
+static constexpr char signature[8] = {'H', 'L', 'R', 'I', 'N', 'G', 0, 0};
+/** @brief File format version. */
+static constexpr uint32_t formatVersion = 1;
+
+/**
+ * @struct Header
+ * @brief File header: describes the layout of the file.
+ *        The file is reset if any field differs from the expected one.
+ *        The header has no checksum of its own: the state is protected by
+ *        the checksum of its slot, and the active slot is not stored here,
+ *        it is the valid one with the greatest sequence number.
+ */
+struct Header
+{
+    /** @brief File signature, see signature. */
+    char magic[sizeof(signature)];
+    /** @brief File format version, see formatVersion. */
+    uint32_t version;
+    /** @brief Size of the state in each of the two slots. */
+    uint32_t stateSize;
+    /** @brief Size of the index ring in bytes, before page alignment. */
+    uint64_t indexSize;
+    /** @brief Size of the data ring in bytes, before page alignment. */
+    uint64_t dataSize;
+};
+
+/**
+ * @struct SlotHeader
+ * @brief Header of the state slot, the state follows it.
+ */
+struct SlotHeader
+{
+    /** @brief Sequence number of the state, 0 if the slot was never written.
+     *         The slot is selected by the parity of the number, so commits
+     *         alternate between the slots. */
+    uint64_t seq;
+    /** @brief CRC-32 of the sequence number and the state, a slot with
+     *         a torn write fails the check and the other slot is used. */
+    uint32_t crc;
+    /** @brief Size of the state. */
+    uint32_t size;
+};
+
+/** @brief Round the size up to the page boundary. */
+static size_t pageAlign(size_t size)
+{
+    return (size + headerSize - 1) & ~(headerSize - 1);
+}
+
+/** @brief Get size of the state slot. */
+static size_t slotSize(size_t stateSize)
+{
+    return (sizeof(SlotHeader) + stateSize + 7) & ~size_t{7};
+}
+
+/** @brief Calculate checksum of the state slot. */
+static uint32_t slotCrc(const char* slot, size_t stateSize)
+{
+    const SlotHeader* hdr = reinterpret_cast<const SlotHeader*>(slot);
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(&hdr->seq),
+                      sizeof(hdr->seq));
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(slot + sizeof(SlotHeader)),
+                stateSize);
+    return static_cast<uint32_t>(crc);
+}
+
+RingFile::RingFile(const std::string& path, size_t stateSize,
+                   size_t indexSize, size_t dataSize) :
+    mem(nullptr), memSize(0), stateSize(stateSize),
+    dataOffset(headerSize + pageAlign(indexSize)), lastSeq(0)
+{
+    if (slotsOffset + 2 * slotSize(stateSize) > headerSize)
+    {
+        throw std::invalid_argument("Ring state is too large");
+    }
+    memSize = dataOffset + pageAlign(dataSize);
+
+    fs::create_directories(fs::path(path).parent_path());
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1)
+    {
+        std::error_code ec(errno, std::generic_category());
+        throw std::system_error(ec, "Unable to open " + path);
+    }
+
+    struct stat st;
+    int rc = fstat(fd, &st);
+    if (rc == 0 && static_cast<size_t>(st.st_size) != memSize)
+    {
+        // Drop the content of the file created with other sizes
+        rc = ftruncate(fd, 0);
+        if (rc == 0)
+        {
+            rc = ftruncate(fd, static_cast<off_t>(memSize));
+        }
+    }
+    if (rc == 0)
+    {
+        void* ptr = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            rc = -1;
+        }
+        else
+        {
+            mem = static_cast<char*>(ptr);
+        }
+    }
+    if (rc != 0)
+    {
+        std::error_code ec(errno, std::generic_category());
+        close(fd);
+        throw std::system_error(ec, "Unable to map " + path);
+    }
+    close(fd);
+
+    Header* hdr = reinterpret_cast<Header*>(mem);
+    if (memcmp(hdr->magic, signature, sizeof(signature)) != 0 ||
+        hdr->version != formatVersion || hdr->stateSize != stateSize ||
+        hdr->indexSize != indexSize || hdr->dataSize != dataSize)
+    {
+        memset(mem, 0, headerSize);
+        memcpy(hdr->magic, signature, sizeof(signature));
+        hdr->version = formatVersion;
+        hdr->stateSize = static_cast<uint32_t>(stateSize);
+        hdr->indexSize = indexSize;
+        hdr->dataSize = dataSize;
+        return;
+    }
+
+    uint64_t seq;
+    for (uint64_t i = 0; i < 2; ++i)
+    {
+        if (check(slot(i), seq) && seq > lastSeq)
+        {
+            lastSeq = seq;
+        }
+    }
+}
+
+RingFile::~RingFile()
+{
+    munmap(mem, memSize);
+}
+
+char* RingFile::index() const
+{
+    return mem + headerSize;
+}
+
+char* RingFile::data() const
+{
+    return mem + dataOffset;
+}
+
+bool RingFile::load(void* state) const
+{
+    uint64_t seq;
+    const char* last = slot(lastSeq);
+    if (!check(last, seq) || seq != lastSeq)
+    {
+        return false;
+    }
+    memcpy(state, last + sizeof(SlotHeader), stateSize);
+    return true;
+}
+
+void RingFile::commit(const void* state)
+{
+    // The rings must be written before the state that refers to them
+    std::atomic_signal_fence(std::memory_order_release);
+
+    // Overwrite the older slot, the newer one stays valid until the end
+    char* next = slot(++lastSeq);
+    SlotHeader* hdr = reinterpret_cast<SlotHeader*>(next);
+    hdr->seq = lastSeq;
+    hdr->size = static_cast<uint32_t>(stateSize);
+    memcpy(next + sizeof(SlotHeader), state, stateSize);
+    hdr->crc = slotCrc(next, stateSize);
+}
+
+char* RingFile::slot(uint64_t seq) const
+{
+    return mem + slotsOffset + (seq % 2) * slotSize(stateSize);
+}
+
+bool RingFile::check(const char* slot, uint64_t& seq) const
+{
+    const SlotHeader* hdr = reinterpret_cast<const SlotHeader*>(slot);
+    if (!hdr->seq || hdr->size != stateSize ||
+        hdr->crc != slotCrc(slot, stateSize))
+    {
+        return false;
+    }
+    seq = hdr->seq;
+    return true;
+}
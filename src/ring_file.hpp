@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class RingFile
+ * @brief Memory mapped file with the rings of the log buffer.
+ *
+ * The file consists of a header page and two regions: the index ring and the
+ * byte ring. The header keeps two slots with the state of the rings, they are
+ * written in turn with increasing sequence numbers and checksums. If the
+ * process is killed in the middle of writing a slot, the other one still
+ * holds the previous state, so the newest valid slot is always consistent.
+ * The file is expected to be placed in tmpfs, it survives the restart of the
+ * service but not the reboot.
+ */
+class RingFile
+{
+  public:
+    /**
+     * @brief Constructor: open or create the file and map it to memory.
+     *        The file created with other sizes is reinitialized.
+     *
+     * @param[in] path path to the file
+     * @param[in] stateSize size of the state in bytes
+     * @param[in] indexSize size of the index ring in bytes
+     * @param[in] dataSize size of the byte ring in bytes
+     *
+     * @throw std::system_error in case of errors
+     */
+    RingFile(const std::string& path, size_t stateSize, size_t indexSize,
+             size_t dataSize);
+
+    ~RingFile();
+
+    RingFile(const RingFile&) = delete;
+    RingFile& operator=(const RingFile&) = delete;
+
+    /** @brief Get pointer to the index ring. */
+    char* index() const;
+    /** @brief Get pointer to the byte ring. */
+    char* data() const;
+
+    /**
+     * @brief Load the last committed state.
+     *
+     * @param[out] state buffer for the state
+     *
+     * @return false if there is no valid state in the file
+     */
+    bool load(void* state) const;
+
+    /**
+     * @brief Commit the state: the rings must be consistent with it.
+     *
+     * @param[in] state state to write
+     */
+    void commit(const void* state);
+
+  private:
+    /**
+     * @brief Get pointer to the state slot.
+     *
+     * @param[in] seq sequence number of the state
+     *
+     * @return pointer to the slot
+     */
+    char* slot(uint64_t seq) const;
+
+    /**
+     * @brief Check the state slot.
+     *
+     * @param[in] slot pointer to the slot
+     * @param[out] seq sequence number of the state
+     *
+     * @return true if the slot holds a valid state
+     */
+    bool check(const char* slot, uint64_t& seq) const;
+
+  private:
+    /** @brief Mapped memory. */
+    char* mem;
+    /** @brief Size of the mapped memory. */
+    size_t memSize;
+    /** @brief Size of the state. */
+    size_t stateSize;
+    /** @brief Offset of the byte ring. */
+    size_t dataOffset;
+    /** @brief Sequence number of the last committed state. */
+    uint64_t lastSeq;
+};
@@ -16,4 +16,15 @@ class Service
      * @brief Run the service.
      */
     virtual void run() = 0;
+
+    /**
+     * @brief Register event handlers, used to run several services in a
+     *        shared event loop.
+     */
+    virtual void start() = 0;
+
+    /**
+     * @brief Save the collected data, called after the event loop is stopped.
+     */
+    virtual void finish() = 0;
 };
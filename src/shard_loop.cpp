@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "shard_loop.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <cstring>
+#include <memory>
+#include <system_error>
+
+using namespace phosphor::logging;
+
+/** @brief Max number of events waiting to be handled by the shard. */
+static constexpr size_t queueSize = 256;
+
+/**
+ * @brief Create a new event loop, not the default one of the calling thread.
+ *
+ * @throw std::system_error in case of errors
+ *
+ * @return event loop
+ */
+static sd_event* newEvent()
+{
+    sd_event* event = nullptr;
+    const int rc = sd_event_new(&event);
+    if (rc < 0)
+    {
+        std::error_code ec(-rc, std::generic_category());
+        throw std::system_error(ec, "Unable to create shard event loop");
+    }
+    return event;
+}
+
+ShardLoop::ShardLoop(DbusLoop& mainLoop) :
+    DbusLoop(newEvent()), mainLoop(mainLoop), eventFd(-1), queue(queueSize),
+    replyFd(-1), replies(queueSize), stopHandler([this]() { this->stop(0); }),
+    running(false), result(0)
+{
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd == -1)
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to create event descriptor");
+    }
+    DbusLoop::addIoHandler(eventFd, [this]() { this->dispatch(); });
+}
+
+ShardLoop::~ShardLoop()
+{
+    join();
+    close(eventFd);
+    // Calls not handled before the shard is stopped are not replied, the
+    // messages are released with them
+    while (const auto task = queue.pop())
+    {
+        delete task->call;
+    }
+    if (replyFd != -1)
+    {
+        // Calls completed after the main loop is stopped are not replied
+        while (const auto call = replies.pop())
+        {
+            delete *call;
+        }
+        close(replyFd);
+    }
+}
+
+void ShardLoop::addPropertyHandler(const std::string& objPath,
+                                   const WatchProperties& props,
+                                   std::function<void()> callback)
+{
+    mainLoop.addPropertyHandler(objPath, props,
+                                [this, event = addEvent(callback)]() {
+                                    this->postEvent(*event);
+                                });
+}
+
+void ShardLoop::addSignalHandler(int signal, std::function<void()> callback)
+{
+    mainLoop.addSignalHandler(signal, [this, event = addEvent(callback)]() {
+        this->postEvent(*event);
+    });
+}
+
+ShardLoop::Event* ShardLoop::addEvent(const std::function<void()>& callback)
+{
+    Event& event = events.emplace_back();
+    event.callback = callback;
+    event.handler = [&event]() {
+        // Events that come while the callback runs are posted again
+        event.pending = false;
+        event.callback();
+    };
+    return &event;
+}
+
+void ShardLoop::postEvent(Event& event)
+{
+    // The shard is already notified, the event is coalesced with that one
+    if (event.pending.exchange(true))
+    {
+        return;
+    }
+    if (!post(&event.handler))
+    {
+        event.pending = false;
+        log<level::WARNING>("Shard queue is full, event lost");
+    }
+}
+
+void ShardLoop::requestName(const std::string& name)
+{
+    mainLoop.requestName(name);
+}
+
+void ShardLoop::addObject(const std::string& objPath,
+                          const std::string& interface, const Methods& methods)
+{
+    if (replyFd == -1)
+    {
+        replyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (replyFd == -1)
+        {
+            std::error_code ec(errno ? errno : EIO, std::generic_category());
+            throw std::system_error(ec, "Unable to create event descriptor");
+        }
+        mainLoop.addIoHandler(replyFd, [this]() { this->sendReplies(); });
+    }
+
+    Methods proxies;
+    for (const auto& [name, method] : methods)
+    {
+        const auto* handler = &methodHandlers.emplace_back(method.callback);
+        proxies[name] = Method{method.result,
+                               [this, handler](const Reply& reply) {
+                                   this->callMethod(*handler, reply);
+                               }};
+    }
+    mainLoop.addObject(objPath, interface, proxies);
+}
+
+void ShardLoop::callMethod(const std::function<void(const Reply&)>& method,
+                           const Reply& reply)
+{
+    auto call = std::make_unique<MethodCall>();
+    MethodCall* ptr = call.get();
+    call->reply = reply;
+    call->handler = [this, ptr, &method]() {
+        // Only the first reply is passed, the call is freed after it
+        const auto replied = std::make_shared<bool>(false);
+        const Reply done = [this, ptr, replied](const MethodResult& result,
+                                                const std::string& error) {
+            if (*replied)
+            {
+                return;
+            }
+            *replied = true;
+            ptr->result = result;
+            ptr->error = error;
+            this->complete(ptr);
+        };
+        try
+        {
+            method(done);
+        }
+        catch (const std::exception& ex)
+        {
+            done(MethodResult(), ex.what());
+        }
+    };
+    if (!post(&call->handler, ptr))
+    {
+        throw std::system_error(EBUSY, std::generic_category(),
+                                "Shard queue is full");
+    }
+    call.release(); // Owned by the shard until the reply is sent
+}
+
+void ShardLoop::start()
+{
+    running = true;
+    thread = std::thread([this]() {
+        result = this->run();
+        running = false;
+    });
+}
+
+int ShardLoop::join()
+{
+    if (!thread.joinable())
+    {
+        return result;
+    }
+    // The queue is drained by the shard while it is running
+    while (!post(&stopHandler) && running)
+    {
+        std::this_thread::yield();
+    }
+    thread.join();
+    return result;
+}
+
+bool ShardLoop::post(const std::function<void()>* callback,
+                     MethodCall* call)
+{
+    if (!queue.push(Task{callback, call}))
+    {
+        return false;
+    }
+    const uint64_t counter = 1;
+    if (write(eventFd, &counter, sizeof(counter)) == -1 && errno != EAGAIN)
+    {
+        log<level::WARNING>("Unable to wake up shard",
+                            entry("Error=%s", strerror(errno)));
+    }
+    return true;
+}
+
+void ShardLoop::complete(MethodCall* call)
+{
+    if (!replies.push(call))
+    {
+        log<level::WARNING>("Reply queue is full, method reply lost");
+        delete call;
+        return;
+    }
+    const uint64_t counter = 1;
+    if (write(replyFd, &counter, sizeof(counter)) == -1 && errno != EAGAIN)
+    {
+        log<level::WARNING>("Unable to wake up main thread",
+                            entry("Error=%s", strerror(errno)));
+    }
+}
+
+void ShardLoop::sendReplies()
+{
+    uint64_t counter;
+    while (read(replyFd, &counter, sizeof(counter)) > 0)
+    {}
+
+    while (const auto call = replies.pop())
+    {
+        const std::unique_ptr<MethodCall> done(*call);
+        done->reply(done->result, done->error);
+    }
+}
+
+void ShardLoop::dispatch()
+{
+    uint64_t counter;
+    while (read(eventFd, &counter, sizeof(counter)) > 0)
+    {}
+
+    while (const auto task = queue.pop())
+    {
+        (*task->handler)();
+    }
+}
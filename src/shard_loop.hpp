@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "dbus_loop.hpp"
+#include "spsc_queue.hpp"
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <thread>
+
+/**
+ * @class ShardLoop
+ * @brief Event loop of a worker thread that serves a subset of consoles.
+ *
+ * IO and timer handlers are served by the shard's own loop in its thread.
+ * The shard has no D-Bus connection: property and signal handlers are
+ * registered in the main loop, which passes the events to the shard through
+ * a lock-free queue and wakes the shard up with an event descriptor.
+ * All handlers must be added before the worker thread is started.
+ */
+class ShardLoop : public DbusLoop
+{
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] mainLoop event loop with D-Bus connection that runs in the
+     *                     main thread, should outlive this class
+     *
+     * @throw std::system_error in case of errors
+     */
+    explicit ShardLoop(DbusLoop& mainLoop);
+
+    ~ShardLoop() override;
+
+    /**
+     * @brief Add property change handler called in the shard's thread.
+     *
+     * @param[in] objPath path to the D-Bus object
+     * @param[in] props watched properties description
+     * @param[in] callback function to call when property get one the listed
+     *            values
+     *
+     * @throw std::system_error in case of errors
+     */
+    void addPropertyHandler(const std::string& objPath,
+                            const WatchProperties& props,
+                            std::function<void()> callback) override;
+
+    /**
+     * @brief Add signal handler called in the shard's thread.
+     *
+     * @param[in] signal signal to watch
+     * @param[in] callback function to call when signal is triggered
+     *
+     * @throw std::system_error in case of errors
+     */
+    void addSignalHandler(int signal, std::function<void()> callback) override;
+
+    /**
+     * @brief Request the well-known name on the bus of the main loop.
+     *
+     * @param[in] name D-Bus service name
+     *
+     * @throw std::system_error in case of errors
+     */
+    void requestName(const std::string& name) override;
+
+    /**
+     * @brief Add D-Bus object, its methods are called in the shard's thread.
+     *        Replies are passed back and sent by the main thread.
+     *
+     * @param[in] objPath path to the D-Bus object
+     * @param[in] interface name of the interface
+     * @param[in] methods methods of the interface
+     *
+     * @throw std::system_error in case of errors
+     */
+    void addObject(const std::string& objPath, const std::string& interface,
+                   const Methods& methods) override;
+
+    /**
+     * @brief Run the loop in the worker thread.
+     *
+     * @throw std::system_error in case of errors
+     */
+    void start();
+
+    /**
+     * @brief Stop the loop and wait for the worker thread, called from the
+     *        main thread.
+     *
+     * @return exit code from the loop
+     */
+    int join();
+
+  protected:
+    /**
+     * @struct MethodCall
+     * @brief Method call passed to the shard's thread and back.
+     */
+    struct MethodCall
+    {
+        /** @brief Sender of the reply, called by the main thread. */
+        Reply reply;
+        /** @brief Handler called in the shard's thread. */
+        std::function<void()> handler;
+        /** @brief Result of the method. */
+        MethodResult result;
+        /** @brief Error text, empty if the method succeeded. */
+        std::string error;
+    };
+
+    /**
+     * @brief Queue the handler to be called in the shard's thread.
+     *        Called from the main thread only.
+     *
+     * @param[in] callback handler to call
+     * @param[in] call method call of the handler, the queue takes ownership
+     *                 of it if the handler is queued
+     *
+     * @return false if the queue is full
+     */
+    bool post(const std::function<void()>* callback,
+              MethodCall* call = nullptr);
+
+    /**
+     * @brief IO handler: call the queued handlers.
+     */
+    void dispatch();
+
+    /**
+     * @brief IO handler of the main loop: send replies of the completed
+     *        method calls.
+     */
+    void sendReplies();
+
+  private:
+    /**
+     * @struct Task
+     * @brief Handler waiting in the queue of the shard.
+     */
+    struct Task
+    {
+        /** @brief Handler to call in the shard's thread. */
+        const std::function<void()>* handler;
+        /** @brief Method call of the handler, nullptr for events. */
+        MethodCall* call;
+    };
+
+    /**
+     * @struct Event
+     * @brief Property change or signal passed to the shard's thread.
+     */
+    struct Event
+    {
+        /** @brief Handler of the event. */
+        std::function<void()> callback;
+        /** @brief Queued handler, clears the pending flag and calls back. */
+        std::function<void()> handler;
+        /** @brief Flag to indicate that the event is queued and not handled
+         *         yet, repeated events are coalesced until then. */
+        std::atomic<bool> pending = false;
+    };
+
+    /**
+     * @brief Register the event handler.
+     *
+     * @param[in] callback function to call in the shard's thread
+     *
+     * @return event descriptor, valid while the shard exists
+     */
+    Event* addEvent(const std::function<void()>& callback);
+
+    /**
+     * @brief Queue the event unless it is already queued.
+     *        Called from the main thread only.
+     *
+     * @param[in] event event to pass to the shard
+     */
+    void postEvent(Event& event);
+
+    /**
+     * @brief Pass the method call to the shard's thread.
+     *        Called from the main thread only.
+     *
+     * @param[in] method method handler
+     * @param[in] reply sender of the reply
+     *
+     * @throw std::system_error if the queue is full
+     */
+    void callMethod(const std::function<void(const Reply&)>& method,
+                    const Reply& reply);
+
+    /**
+     * @brief Pass the completed call to the main thread.
+     *        Called from the shard's thread only.
+     *
+     * @param[in] call completed call, the queue takes ownership of it
+     */
+    void complete(MethodCall* call);
+
+    /** @brief Event loop with D-Bus connection. */
+    DbusLoop& mainLoop;
+    /** @brief Event descriptor used to wake the shard up. */
+    int eventFd;
+    /** @brief Handlers waiting to be called in the shard's thread. */
+    SpscQueue<Task> queue;
+    /** @brief Property and signal events. */
+    std::list<Event> events;
+    /** @brief Method handlers called in the shard's thread. */
+    std::list<std::function<void(const Reply&)>> methodHandlers;
+    /** @brief Event descriptor used to wake the main thread up, -1 until
+     *         the first object is added. */
+    int replyFd;
+    /** @brief Completed method calls waiting for the reply. */
+    SpscQueue<MethodCall*> replies;
+    /** @brief Handler that stops the loop. */
+    std::function<void()> stopHandler;
+    /** @brief Worker thread. */
+    std::thread thread;
+    /** @brief Flag to indicate that the loop is running. */
+    std::atomic<bool> running;
+    /** @brief Exit code from the loop. */
+    int result;
+};
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @class SpscQueue
+ * @brief Bounded lock-free queue with a single producer and a single consumer.
+ *
+ * The producer and the consumer may run in different threads without any
+ * locking: each side modifies only its own index, the other one is read with
+ * acquire semantics to see the items published by the release store.
+ */
+template <typename T>
+class SpscQueue
+{
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] capacity max number of items, rounded up to a power of 2
+     */
+    explicit SpscQueue(size_t capacity) :
+        items(std::bit_ceil(capacity ? capacity : 1)), mask(items.size() - 1)
+    {}
+
+    /**
+     * @brief Add item to the queue, called by the producer only.
+     *
+     * @param[in] item item to add
+     *
+     * @return false if the queue is full
+     */
+    bool push(const T& item)
+    {
+        const size_t pos = tail.load(std::memory_order_relaxed);
+        if (pos - head.load(std::memory_order_acquire) == items.size())
+        {
+            return false;
+        }
+        items[pos & mask] = item;
+        tail.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get the oldest item from the queue, called by the consumer only.
+     *
+     * @return item or nothing if the queue is empty
+     */
+    std::optional<T> pop()
+    {
+        const size_t pos = head.load(std::memory_order_relaxed);
+        if (pos == tail.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        T item = items[pos & mask];
+        head.store(pos + 1, std::memory_order_release);
+        return item;
+    }
+
+  private:
+    /** @brief Ring of items. */
+    std::vector<T> items;
+    /** @brief Mask to get position in the ring from the index. */
+    size_t mask;
+    /** @brief Index of the oldest item, modified by the consumer. */
+    alignas(64) std::atomic<size_t> head = 0;
+    /** @brief Index following the newest item, modified by the producer. */
+    alignas(64) std::atomic<size_t> tail = 0;
+};
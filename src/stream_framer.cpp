@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "stream_framer.hpp"
+
+#include <algorithm>
+
+StreamFramer::StreamFramer(size_t maxSize, bool pack) :
+    maxSize(std::max(maxSize, size_t{2})), pack(pack), first(0)
+{}
+
+void StreamFramer::append(const char* data, size_t sz)
+{
+    tokenizer.split(data, sz, [this](const char* text, size_t len, bool eol) {
+        addPart(text, len, eol);
+    });
+}
+
+void StreamFramer::addPart(const char* text, size_t len, bool eol)
+{
+    if (!eol)
+    {
+        partial.append(text, len);
+        // Don't wait for EOL if the line doesn't fit a datagram anyway
+        const size_t fullSize = partial.size() / (maxSize - 1) * (maxSize - 1);
+        if (fullSize)
+        {
+            addLine(partial.data(), fullSize);
+            partial.erase(0, fullSize);
+        }
+    }
+    else if (partial.empty())
+    {
+        addLine(text, len);
+    }
+    else
+    {
+        partial.append(text, len);
+        addLine(partial.data(), partial.size());
+        partial.clear();
+    }
+}
+
+void StreamFramer::addLine(const char* text, size_t len)
+{
+    // Append the line to the last datagram if it fits there entirely
+    if (pack && size() &&
+        ends.back() - offset(ends.size() - 1) + len + 1 <= maxSize)
+    {
+        data.insert(data.end(), text, text + len);
+        data.push_back('\n');
+        ends.back() = data.size();
+        return;
+    }
+
+    // Put the line into new datagrams, each one is terminated by EOL
+    do
+    {
+        const size_t part = std::min(len, maxSize - 1);
+        data.insert(data.end(), text, text + part);
+        data.push_back('\n');
+        ends.push_back(data.size());
+        text += part;
+        len -= part;
+    } while (len);
+}
+
+bool StreamFramer::flushPartial()
+{
+    if (partial.empty())
+    {
+        return false;
+    }
+    addLine(partial.data(), partial.size());
+    partial.clear();
+    return true;
+}
+
+bool StreamFramer::hasPartial() const
+{
+    return !partial.empty();
+}
+
+size_t StreamFramer::size() const
+{
+    return ends.size() - first;
+}
+
+size_t StreamFramer::bytes() const
+{
+    return data.size() - offset(first);
+}
+
+std::string_view StreamFramer::operator[](size_t index) const
+{
+    const size_t pos = first + index;
+    const size_t begin = offset(pos);
+    return std::string_view(data.data() + begin, ends[pos] - begin);
+}
+
+void StreamFramer::removeFront(size_t count)
+{
+    first += count;
+    if (first == ends.size())
+    {
+        clear();
+        return;
+    }
+
+    // Move the rest to the beginning when at least a half of data is unused
+    const size_t unused = offset(first);
+    if (unused * 2 >= data.size())
+    {
+        data.erase(data.begin(), data.begin() + unused);
+        ends.erase(ends.begin(), ends.begin() + first);
+        for (size_t& end : ends)
+        {
+            end -= unused;
+        }
+        first = 0;
+    }
+}
+
+void StreamFramer::removeBack()
+{
+    ends.pop_back();
+    if (first == ends.size())
+    {
+        clear();
+    }
+    else
+    {
+        data.resize(ends.back());
+    }
+}
+
+void StreamFramer::clear()
+{
+    // Keep allocated memory for reuse
+    data.clear();
+    ends.clear();
+    first = 0;
+}
+
+size_t StreamFramer::offset(size_t pos) const
+{
+    return pos ? ends[pos - 1] : 0;
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "line_tokenizer.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class StreamFramer
+ * @brief Splitter of the console output into line-aligned datagrams.
+ *
+ * Each complete line is terminated by '\n' and placed into its own datagram,
+ * or packed together with the previous lines if packing is enabled.
+ * Lines longer than a datagram are split into several datagrams.
+ * The last line of the stream is kept until it is completed by EOL or
+ * flushed explicitly. Datagrams are kept until they are removed, so the framer
+ * is also used as a backlog of datagrams waiting to be sent.
+ */
+class StreamFramer
+{
+  public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in] maxSize max size of a datagram in bytes
+     * @param[in] pack flag to pack several lines into one datagram
+     */
+    StreamFramer(size_t maxSize, bool pack);
+
+    /**
+     * @brief Add raw data from host's console output.
+     *
+     * @param[in] data pointer to raw data buffer
+     * @param[in] sz size of the buffer in bytes
+     */
+    void append(const char* data, size_t sz);
+
+    /**
+     * @brief Add a part of the stream already split into lines.
+     *
+     * @param[in] text pointer to the text without EOL
+     * @param[in] len size of the text in bytes
+     * @param[in] eol flag to indicate that the text is terminated by EOL
+     */
+    void addPart(const char* text, size_t len, bool eol);
+
+    /**
+     * @brief Put a complete line into datagrams, bypassing the line splitter.
+     *
+     * @param[in] text pointer to the line text without EOL
+     * @param[in] len size of the line text in bytes
+     */
+    void addLine(const char* text, size_t len);
+
+    /**
+     * @brief Put the incomplete line into a datagram as is.
+     *
+     * @return true if there was an incomplete line
+     */
+    bool flushPartial();
+
+    /** @brief Check if the last line is not terminated by EOL yet. */
+    bool hasPartial() const;
+
+    /** @brief Get number of the datagrams ready to send. */
+    size_t size() const;
+
+    /** @brief Get total size of the datagrams ready to send. */
+    size_t bytes() const;
+
+    /**
+     * @brief Get datagram by its index.
+     *
+     * @param[in] index index of the datagram, must be less than size()
+     *
+     * @return content of the datagram, valid until the framer is modified
+     */
+    std::string_view operator[](size_t index) const;
+
+    /**
+     * @brief Remove the oldest datagrams.
+     *
+     * @param[in] count number of datagrams to remove, must be <= size()
+     */
+    void removeFront(size_t count);
+
+    /** @brief Remove the newest datagram, the framer must not be empty. */
+    void removeBack();
+
+    /** @brief Remove all datagrams, keeping the incomplete line. */
+    void clear();
+
+  private:
+    /**
+     * @brief Get offset of the datagram in the data.
+     *
+     * @param[in] pos position of the datagram in the ends array
+     *
+     * @return offset of the first byte of the datagram
+     */
+    size_t offset(size_t pos) const;
+
+  private:
+    /** @brief Splitter of the console output into lines. */
+    LineTokenizer tokenizer;
+    /** @brief Max size of a datagram. */
+    size_t maxSize;
+    /** @brief Flag to pack several lines into one datagram. */
+    bool pack;
+    /** @brief Content of the datagrams placed back to back. */
+    std::vector<char> data;
+    /** @brief End offsets of the datagrams in the data. */
+    std::vector<size_t> ends;
+    /** @brief Position of the oldest datagram in the ends array. */
+    size_t first;
+    /** @brief Incomplete last line of the stream. */
+    std::string partial;
+};
@@ -4,13 +4,11 @@
 #pragma once
 
 #include "config.hpp"
+#include "console_reader.hpp"
 #include "dbus_loop.hpp"
-#include "file_storage.hpp"
 #include "host_console.hpp"
-#include "log_buffer.hpp"
 #include "service.hpp"
-
-#include <sys/un.h>
+#include "stream_sink.hpp"
 
 /**
  * @class Service
@@ -23,17 +21,14 @@ class StreamService : public Service
      * @brief Constructor for stream-only mode. All arguments should outlive
      * this class.
      *
-     * @param streamDestination the destination socket to stream logs.
+     * @param config the configuration of the service.
      * @param dbusLoop the DbusLoop instance.
      * @param hostConsole the HostConsole instance.
      */
-    StreamService(const char* streamDestination, DbusLoop& dbusLoop,
+    StreamService(const Config& config, DbusLoop& dbusLoop,
                   HostConsole& hostConsole);
 
-    /**
-     * @brief Destructor; close the file descriptor.
-     */
-    ~StreamService() override;
+    ~StreamService() override = default;
 
     /**
      * @brief Run the service.
@@ -42,6 +37,18 @@ class StreamService : public Service
      */
     void run() override;
 
+    /**
+     * @brief Register event handlers.
+     *
+     * @throw std::exception in case of errors
+     */
+    void start() override;
+
+    /**
+     * @brief Save the collected data after the event loop is stopped.
+     */
+    void finish() override;
+
   protected:
     /**
      * @brief Read data from host console and perform actions according to
@@ -50,7 +57,7 @@ class StreamService : public Service
     virtual void readConsole();
 
     /**
-     * @brief Stream console data to a datagram unix socket.
+     * @brief Pass console data to the stream output.
      *
      * @param data the bytes to stream
      * @param len the length of the bytes array
@@ -59,22 +66,13 @@ class StreamService : public Service
      */
     virtual void streamConsole(const char* data, size_t len);
 
-    /**
-     * @brief Set up stream socket
-     *
-     * @throw std::exception in case of errors
-     */
-    virtual void setStreamSocket();
-
   private:
-    /** @brief Path to the destination (the rsyslog unix socket) */
-    const char* destinationPath;
     /** @brief D-Bus event loop. */
     DbusLoop* dbusLoop;
     /** @brief Host console connection. */
     HostConsole* hostConsole;
-    /** @brief File descriptor of the output socket */
-    int outputSocketFd;
-    /** @brief Address of the destination (the rsyslog unix socket) */
-    sockaddr_un destination;
+    /** @brief Host console reader, chunks are limited by datagram size. */
+    ConsoleReader consoleReader;
+    /** @brief Output of the log stream. */
+    StreamSink sink;
 };
@@ -0,0 +1,399 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2021 Google
+
+#include "stream_sink.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+using namespace phosphor::logging;
+
+/** @brief Interval of the spool file replay, in microseconds. */
+static constexpr uint64_t replayInterval = 1'000'000;
+
+StreamSink::StreamSink(const Config& config, DbusLoop& dbusLoop) :
+    config(config), dbusLoop(&dbusLoop),
+    framer(config.streamDatagramSize, config.streamPack), flushArmed(false),
+    replayArmed(false), outputBlocked(false), outputWatch(false),
+    overflow(false), connected(false), destinationDown(false),
+    datagramsSent(0), sendCalls(0), droppedLines(0), droppedBytes(0),
+    spooledLines(0), outputSocketFd(-1), destination(), destinationLen(0)
+{
+    if (*config.streamSpool)
+    {
+        spool = std::make_unique<StreamSpool>(config.streamSpool,
+                                              config.streamSpoolSize);
+    }
+}
+
+StreamSink::~StreamSink()
+{
+    if (outputSocketFd != -1)
+    {
+        close(outputSocketFd);
+    }
+}
+
+void StreamSink::start()
+{
+    setStreamSocket();
+    dbusLoop->addOutputHandler(outputSocketFd,
+                               [this]() { this->resumeOutput(); });
+    // Register timer to send incomplete lines, it runs only while there is
+    // an incomplete line, so an idle console doesn't wake up the service
+    if (config.streamTimeout)
+    {
+        flushTimer = dbusLoop->addTimerHandler(
+            config.streamTimeout * 1'000, [this]() { this->flushPartial(); });
+        flushArmed = true;
+        armTimer(flushTimer, flushArmed, partialSince.has_value());
+    }
+    // Register timer to replay the spool file, it runs only while the spool
+    // has data, which may be left by the previous run
+    if (spool)
+    {
+        replayTimer = dbusLoop->addTimerHandler(
+            replayInterval, [this]() { this->replaySpool(); });
+        replayArmed = true;
+        armTimer(replayTimer, replayArmed, spool->pending());
+    }
+}
+
+void StreamSink::stop()
+{
+    if (spool && destinationDown)
+    {
+        // Save the backlog, it will be replayed on the next start
+        spoolBacklog();
+    }
+    log<level::INFO>("Stream statistics",
+                     entry("Datagrams=%llu", datagramsSent),
+                     entry("Syscalls=%llu", sendCalls),
+                     entry("DroppedLines=%llu", droppedLines),
+                     entry("DroppedBytes=%llu", droppedBytes),
+                     entry("SpooledLines=%llu", spooledLines));
+}
+
+void StreamSink::append(const char* data, size_t len)
+{
+    framer.append(data, len);
+}
+
+void StreamSink::addPart(const char* text, size_t len, bool eol)
+{
+    framer.addPart(text, len, eol);
+}
+
+void StreamSink::commit()
+{
+    if (!config.streamTimeout)
+    {
+        framer.flushPartial();
+    }
+    if (!framer.hasPartial())
+    {
+        partialSince.reset();
+    }
+    else if (!partialSince)
+    {
+        partialSince = std::chrono::steady_clock::now();
+    }
+    armTimer(flushTimer, flushArmed, partialSince.has_value());
+    // Send the whole read cycle at once
+    sendDatagrams();
+}
+
+void StreamSink::sendDatagrams()
+{
+    if (outputBlocked)
+    {
+        // Receiver is busy, wait for the output event
+        limitBacklog();
+        return;
+    }
+
+    int err = 0;
+    size_t sent = 0;
+    const size_t count = framer.size();
+    if (count && !connected)
+    {
+        err = connectDestination();
+    }
+    if (count && connected)
+    {
+        messages.resize(count);
+        vectors.resize(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::string_view dgram = framer[i];
+            vectors[i].iov_base = const_cast<char*>(dgram.data());
+            vectors[i].iov_len = dgram.size();
+            msghdr& hdr = messages[i].msg_hdr;
+            hdr = msghdr{};
+            hdr.msg_iov = &vectors[i];
+            hdr.msg_iovlen = 1;
+        }
+
+        // Datagram sockets preserve message boundaries. Furthermore,
+        // In most implementation, UNIX domain datagram sockets are
+        // always reliable and don't reorder datagrams.
+        while (sent < count)
+        {
+            const int rc = sendmmsg(outputSocketFd, messages.data() + sent,
+                                    count - sent, 0);
+            ++sendCalls;
+            if (rc == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                err = errno;
+                break;
+            }
+            sent += rc;
+        }
+        framer.removeFront(sent);
+        datagramsSent += sent;
+        if (err == ECONNREFUSED || err == ENOTCONN)
+        {
+            // Receiver has gone, connect again on the next attempt
+            connected = false;
+        }
+    }
+
+    // Destination is down if the socket doesn't exist or nobody listens it
+    if (count && destinationDown == connected)
+    {
+        destinationDown = !connected;
+        if (destinationDown)
+        {
+            log<level::WARNING>("Stream destination is unavailable",
+                                entry("Destination=%s",
+                                      config.streamDestination),
+                                entry("Spool=%s", config.streamSpool));
+        }
+        else
+        {
+            log<level::INFO>("Stream destination is available",
+                             entry("Destination=%s",
+                                   config.streamDestination));
+        }
+    }
+    if (destinationDown && spool)
+    {
+        spoolBacklog();
+        armTimer(replayTimer, replayArmed, spool->pending());
+    }
+
+    // Keep unsent data in the backlog
+    limitBacklog();
+    outputBlocked = err == EAGAIN || err == EWOULDBLOCK;
+    if (outputBlocked != outputWatch)
+    {
+        dbusLoop->enableOutputHandler(outputSocketFd, outputBlocked);
+        outputWatch = outputBlocked;
+    }
+    if (overflow && !framer.size())
+    {
+        overflow = false;
+        log<level::INFO>("Stream backlog is drained",
+                         entry("DroppedLines=%llu", droppedLines),
+                         entry("DroppedBytes=%llu", droppedBytes));
+    }
+
+    if (err && !outputBlocked && !(destinationDown && spool))
+    {
+        std::string error = "Unable to send to the destination ";
+        error += config.streamDestination;
+        std::error_code ec(err, std::generic_category());
+        throw std::system_error(ec, error);
+    }
+}
+
+void StreamSink::resumeOutput()
+{
+    outputBlocked = false;
+    try
+    {
+        sendDatagrams();
+    }
+    catch (const std::system_error& ex)
+    {
+        log<level::ERR>(ex.what());
+    }
+}
+
+void StreamSink::limitBacklog()
+{
+    while (framer.bytes() > config.streamBacklog)
+    {
+        if (!overflow)
+        {
+            overflow = true;
+            log<level::WARNING>("Stream backlog is full, dropping messages",
+                                entry("Backlog=%lu", config.streamBacklog));
+        }
+        if (config.streamOverflow == Overflow::dropOldest)
+        {
+            countDropped(framer[0]);
+            framer.removeFront(1);
+        }
+        else
+        {
+            countDropped(framer[framer.size() - 1]);
+            framer.removeBack();
+        }
+    }
+}
+
+void StreamSink::spoolBacklog()
+{
+    if (!spool->writable())
+    {
+        // Previous spool is not replayed yet, keep data in the backlog
+        return;
+    }
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    size_t pos = 0;
+    try
+    {
+        for (; pos < framer.size(); ++pos)
+        {
+            const std::string_view dgram = framer[pos];
+            if (spool->write(now, dgram))
+            {
+                spooledLines += std::count(dgram.begin(), dgram.end(), '\n');
+            }
+            else
+            {
+                countDropped(dgram);
+            }
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>("Unable to write spool file",
+                        entry("File=%s", config.streamSpool),
+                        entry("Error=%s", ex.what()));
+    }
+    framer.removeFront(pos);
+}
+
+void StreamSink::replaySpool()
+{
+    if (!spool->pending())
+    {
+        // Nothing to replay until the next outage
+        armTimer(replayTimer, replayArmed, false);
+        return;
+    }
+    if (outputBlocked)
+    {
+        return;
+    }
+
+    try
+    {
+        if (!connected && connectDestination())
+        {
+            // Destination is still unavailable
+            return;
+        }
+
+        // Replay at limited rate without overflowing the backlog
+        size_t budget = config.streamReplayRate;
+        while (budget && framer.bytes() + config.streamDatagramSize <=
+                             config.streamBacklog)
+        {
+            const std::optional<std::string_view> line = spool->read();
+            if (!line)
+            {
+                log<level::INFO>("Stream spool is replayed",
+                                 entry("File=%s", config.streamSpool));
+                break;
+            }
+            framer.addLine(line->data(), line->size());
+            budget -= std::min(budget, line->size() + 1);
+        }
+        sendDatagrams();
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>(ex.what());
+    }
+    armTimer(replayTimer, replayArmed, spool->pending());
+}
+
+int StreamSink::connectDestination()
+{
+    // Connected datagram socket reports readiness for writing only
+    // when the receiver has room for the data.
+    if (connect(outputSocketFd, reinterpret_cast<const sockaddr*>(&destination),
+                destinationLen) == -1)
+    {
+        return errno ? errno : EIO;
+    }
+    connected = true;
+    return 0;
+}
+
+void StreamSink::armTimer(const std::optional<size_t>& timer, bool& armed,
+                          bool arm)
+{
+    if (timer && armed != arm)
+    {
+        dbusLoop->enableTimerHandler(*timer, arm);
+        armed = arm;
+    }
+}
+
+void StreamSink::countDropped(std::string_view datagram)
+{
+    droppedLines += std::count(datagram.begin(), datagram.end(), '\n');
+    droppedBytes += datagram.size();
+}
+
+void StreamSink::flushPartial()
+{
+    if (partialSince && std::chrono::steady_clock::now() - *partialSince >=
+                            std::chrono::milliseconds(config.streamTimeout))
+    {
+        partialSince.reset();
+        armTimer(flushTimer, flushArmed, false);
+        framer.flushPartial();
+        try
+        {
+            sendDatagrams();
+        }
+        catch (const std::system_error& ex)
+        {
+            log<level::ERR>(ex.what());
+        }
+    }
+}
+
+void StreamSink::setStreamSocket()
+{
+    destination.sun_family = AF_UNIX;
+    // To deal with abstract namespace unix socket.
+    size_t len = strlen(config.streamDestination + 1) + 1;
+    memcpy(destination.sun_path, config.streamDestination, len);
+    destination.sun_path[len] = '\0';
+    destinationLen = sizeof(destination) - sizeof(destination.sun_path) + len;
+    outputSocketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (outputSocketFd == -1)
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to create output socket.");
+    }
+}
@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2021 Google
+
+#pragma once
+
+#include "config.hpp"
+#include "dbus_loop.hpp"
+#include "stream_framer.hpp"
+#include "stream_spool.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * @class StreamSink
+ * @brief Output of the console stream: sends line-aligned datagrams to the
+ *        unix socket without blocking, keeping a bounded backlog and spooling
+ *        it to a file while the destination is down.
+ */
+class StreamSink
+{
+  public:
+    /**
+     * @brief Constructor. All arguments should outlive this class.
+     *
+     * @param config the configuration of the service.
+     * @param dbusLoop the DbusLoop instance.
+     */
+    StreamSink(const Config& config, DbusLoop& dbusLoop);
+
+    /**
+     * @brief Destructor; close the file descriptor.
+     */
+    virtual ~StreamSink();
+
+    /**
+     * @brief Create the output socket and register event handlers.
+     *
+     * @throw std::exception in case of errors
+     */
+    void start();
+
+    /**
+     * @brief Write the backlog to the spool file if the destination is down
+     *        and report statistics, called after the event loop is stopped.
+     */
+    void stop();
+
+    /**
+     * @brief Add raw data from host's console output.
+     *
+     * @param data the bytes to stream
+     * @param len the length of the bytes array
+     */
+    void append(const char* data, size_t len);
+
+    /**
+     * @brief Add a part of the console output already split into lines.
+     *
+     * @param text pointer to the text without EOL
+     * @param len size of the text in bytes
+     * @param eol flag to indicate that the text is terminated by EOL
+     */
+    void addPart(const char* text, size_t len, bool eol);
+
+    /**
+     * @brief Send the data added since the last call, called at the end of
+     * each console read cycle.
+     *
+     * @throw std::system_error in case of errors
+     */
+    void commit();
+
+  protected:
+    /**
+     * @brief Send prepared datagrams to the datagram unix socket without
+     * blocking. Datagrams that can't be sent now are kept in the backlog.
+     *
+     * @throw std::system_error in case of errors
+     */
+    void sendDatagrams();
+
+    /**
+     * @brief Output handler: send the backlog when the receiver is ready.
+     */
+    void resumeOutput();
+
+    /**
+     * @brief Drop datagrams if the backlog exceeds its size limit.
+     */
+    void limitBacklog();
+
+    /**
+     * @brief Move the backlog to the spool file.
+     */
+    void spoolBacklog();
+
+    /**
+     * @brief Timer handler: send next part of the spool file.
+     */
+    void replaySpool();
+
+    /**
+     * @brief Timer handler: send the incomplete line if it waits too long.
+     */
+    void flushPartial();
+
+    /**
+     * @brief Set up stream socket
+     *
+     * @throw std::exception in case of errors
+     */
+    virtual void setStreamSocket();
+
+  private:
+    /**
+     * @brief Connect the output socket to the destination.
+     *
+     * @return 0 on success or error code
+     */
+    int connectDestination();
+
+    /**
+     * @brief Enable or disable the timer if its state differs.
+     *
+     * @param timer id of the timer, empty if the timer is not registered
+     * @param armed current state of the timer, updated by the call
+     * @param arm true to enable the timer, false to disable it
+     */
+    void armTimer(const std::optional<size_t>& timer, bool& armed, bool arm);
+
+    /**
+     * @brief Account the datagram as dropped.
+     *
+     * @param datagram content of the datagram
+     */
+    void countDropped(std::string_view datagram);
+
+  private:
+    /** @brief Configuration of the service. */
+    const Config& config;
+    /** @brief D-Bus event loop. */
+    DbusLoop* dbusLoop;
+    /** @brief Splitter of the console data into datagrams. */
+    StreamFramer framer;
+    /** @brief Time when the incomplete line was seen first. */
+    std::optional<std::chrono::steady_clock::time_point> partialSince;
+    /** @brief Timer to send the incomplete line. */
+    std::optional<size_t> flushTimer;
+    /** @brief Flag to indicate that the flush timer is enabled. */
+    bool flushArmed;
+    /** @brief Spool file used while the destination is down. */
+    std::unique_ptr<StreamSpool> spool;
+    /** @brief Timer to replay the spool file. */
+    std::optional<size_t> replayTimer;
+    /** @brief Flag to indicate that the replay timer is enabled. */
+    bool replayArmed;
+    /** @brief Flag to indicate that the receiver has no room for data. */
+    bool outputBlocked;
+    /** @brief Flag to indicate that the output handler is enabled. */
+    bool outputWatch;
+    /** @brief Flag to indicate that the backlog overflow is in progress. */
+    bool overflow;
+    /** @brief Flag to indicate that the output socket is connected. */
+    bool connected;
+    /** @brief Flag to indicate that the destination is unavailable. */
+    bool destinationDown;
+    /** @brief Message headers for sendmmsg, reused between calls. */
+    std::vector<mmsghdr> messages;
+    /** @brief IO vectors for sendmmsg, reused between calls. */
+    std::vector<iovec> vectors;
+    /** @brief Number of datagrams sent. */
+    uint64_t datagramsSent;
+    /** @brief Number of send system calls. */
+    uint64_t sendCalls;
+    /** @brief Number of lines dropped due to the backlog overflow. */
+    uint64_t droppedLines;
+    /** @brief Number of bytes dropped due to the backlog overflow. */
+    uint64_t droppedBytes;
+    /** @brief Number of lines written to the spool file. */
+    uint64_t spooledLines;
+    /** @brief File descriptor of the output socket */
+    int outputSocketFd;
+    /** @brief Address of the destination (the rsyslog unix socket) */
+    sockaddr_un destination;
+    /** @brief Size of the destination address */
+    socklen_t destinationLen;
+};
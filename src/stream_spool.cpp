@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "stream_spool.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+/** @brief Max length of a line read from the spool at once. */
+static constexpr size_t maxLineLength = 2048;
+
+StreamSpool::StreamSpool(const std::string& fileName, size_t maxSize) :
+    fileName(fileName), maxSize(maxSize), size(0), reader(nullptr),
+    hasData(false)
+{
+    // Spool of the previous run is read first
+    struct stat st;
+    hasData = stat(fileName.c_str(), &st) == 0 && st.st_size > 0;
+}
+
+StreamSpool::~StreamSpool()
+{
+    if (reader)
+    {
+        gzclose(reader);
+    }
+}
+
+bool StreamSpool::write(const timespec& timeStamp, std::string_view datagram)
+{
+    if (!writable() || size + datagram.size() > maxSize)
+    {
+        return false;
+    }
+    if (!writer)
+    {
+        writer = LogWriter::create(Compression::zlib, 0, fileName);
+        size = 0;
+    }
+
+    size += datagram.size();
+    hasData = true;
+    while (!datagram.empty())
+    {
+        const size_t eol = datagram.find('\n');
+        writer->write(timeStamp, datagram.substr(0, eol));
+        datagram.remove_prefix(
+            eol == std::string_view::npos ? datagram.size() : eol + 1);
+    }
+    return true;
+}
+
+bool StreamSpool::pending() const
+{
+    return hasData;
+}
+
+bool StreamSpool::writable() const
+{
+    // Data of the current writer can be appended, but not a file being read
+    // or a file left from the previous run
+    return !reader && (!hasData || writer);
+}
+
+std::optional<std::string_view> StreamSpool::read()
+{
+    if (!hasData)
+    {
+        return std::nullopt;
+    }
+
+    if (!reader)
+    {
+        if (writer)
+        {
+            writer->close();
+            writer.reset();
+        }
+        reader = gzopen(fileName.c_str(), "rb");
+        if (!reader)
+        {
+            const int err = errno ? errno : EIO;
+            hasData = false;
+            std::error_code ec(err, std::generic_category());
+            throw std::system_error(ec, "Unable to open spool file");
+        }
+        line.resize(maxLineLength);
+    }
+
+    // End of the file and errors (incomplete file) complete the reading
+    if (!gzgets(reader, line.data(), static_cast<int>(line.size())))
+    {
+        remove();
+        return std::nullopt;
+    }
+    size_t len = strlen(line.data());
+    if (len && line[len - 1] == '\n')
+    {
+        --len;
+    }
+    return std::string_view(line.data(), len);
+}
+
+void StreamSpool::remove()
+{
+    gzclose(reader);
+    reader = nullptr;
+    hasData = false;
+    size = 0;
+    unlink(fileName.c_str());
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <zlib.h>
+
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * @class StreamSpool
+ * @brief Compressed spool file for the stream output while the destination
+ *        is unavailable.
+ *
+ * Lines are written with time stamps through the gzip log writer. When the
+ * destination is back, the spool is closed and read back line by line, then
+ * the file is removed. The spool can't be written until it is read to the
+ * end.
+ */
+class StreamSpool
+{
+  public:
+    /**
+     * @brief Constructor. An existing spool file is kept to be read.
+     *
+     * @param[in] fileName path to the spool file
+     * @param[in] maxSize max size of the spooled text in bytes
+     */
+    StreamSpool(const std::string& fileName, size_t maxSize);
+
+    ~StreamSpool();
+
+    StreamSpool(const StreamSpool&) = delete;
+    StreamSpool& operator=(const StreamSpool&) = delete;
+
+    /**
+     * @brief Write lines of the datagram to the spool.
+     *
+     * @param[in] timeStamp time stamp of the lines
+     * @param[in] datagram lines terminated by '\n'
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return false if the spool is full or being read, nothing is written
+     */
+    bool write(const timespec& timeStamp, std::string_view datagram);
+
+    /** @brief Check if the spool has data to read. */
+    bool pending() const;
+
+    /** @brief Check if the spool can be written. */
+    bool writable() const;
+
+    /**
+     * @brief Read the next line from the spool, the file is removed after
+     *        the last line is read.
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return line without EOL, valid until the next call, or nothing if
+     *         the spool is read to the end
+     */
+    std::optional<std::string_view> read();
+
+  private:
+    /** @brief Remove the spool file. */
+    void remove();
+
+  private:
+    /** @brief Path to the spool file. */
+    std::string fileName;
+    /** @brief Max size of the spooled text in bytes. */
+    size_t maxSize;
+    /** @brief Size of the text written to the current spool file. */
+    size_t size;
+    /** @brief Writer of the spool file. */
+    std::unique_ptr<LogWriter> writer;
+    /** @brief Reader of the spool file. */
+    gzFile reader;
+    /** @brief Flag to indicate that the spool file has unread data. */
+    bool hasData;
+    /** @brief Buffer for the line being read. */
+    std::string line;
+};
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "time_formatter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+TimeFormatter::TimeFormatter() :
+    cached(false), second(0), minute(0), gmtOffset(0), msPos(0), length(0),
+    text{}
+{}
+
+std::string_view TimeFormatter::format(const timespec& timeStamp)
+{
+    if (!cached || timeStamp.tv_sec != second)
+    {
+        if (!cached)
+        {
+            tm tmLocal;
+            localtime_r(&timeStamp.tv_sec, &tmLocal);
+            gmtOffset = tmLocal.tm_gmtoff;
+        }
+        const time_t local = timeStamp.tv_sec + gmtOffset;
+        if (cached && local / 60 == minute)
+        {
+            // Only seconds are changed
+            const time_t sec = local % 60;
+            text[msPos - 3] = static_cast<char>('0' + sec / 10);
+            text[msPos - 2] = static_cast<char>('0' + sec % 10);
+        }
+        else
+        {
+            // Much cheaper than localtime_r, which checks timezone settings
+            tm tmLocal;
+            gmtime_r(&local, &tmLocal);
+
+            // "tm_gmtoff" is the number of seconds east of UTC, so we need to
+            // calculate timezone offset. For example, for U.S. Eastern
+            // Standard Time, the value is -18000 = -5*60*60.
+            const int datePart = snprintf(
+                text, sizeof(text), "[ %i-%02i-%02iT%02i:%02i:%02i.",
+                tmLocal.tm_year + 1900, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+                tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec);
+            msPos = static_cast<size_t>(datePart);
+            const int tzPart =
+                snprintf(text + msPos, sizeof(text) - msPos,
+                         "000%+03ld:%02ld ] ", gmtOffset / (60 * 60),
+                         labs(gmtOffset % (60 * 60)) / 60);
+            length = msPos + static_cast<size_t>(tzPart);
+            minute = local / 60;
+        }
+        second = timeStamp.tv_sec;
+        cached = true;
+    }
+
+    const long ms = timeStamp.tv_nsec / 1'000'000;
+    text[msPos] = static_cast<char>('0' + ms / 100);
+    text[msPos + 1] = static_cast<char>('0' + ms / 10 % 10);
+    text[msPos + 2] = static_cast<char>('0' + ms % 10);
+
+    return std::string_view(text, length);
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <ctime>
+#include <string_view>
+
+/**
+ * @class TimeFormatter
+ * @brief Formatter of log message time stamps in the form of
+ *        "[ YYYY-MM-DDTHH:MM:SS.mmm+hh:mm ] ".
+ *
+ * The formatted string is cached, only milliseconds are updated within the
+ * same second and only seconds are updated within the same minute.
+ * The timezone offset is obtained once for the first time stamp and used for
+ * all subsequent ones, so the output stays consistent (local time always
+ * matches the printed offset) even if the daylight saving time switches in
+ * the middle of the log.
+ */
+class TimeFormatter
+{
+  public:
+    TimeFormatter();
+
+    /**
+     * @brief Format time stamp.
+     *
+     * @param[in] timeStamp time stamp to format
+     *
+     * @return formatted string, valid until the next call
+     */
+    std::string_view format(const timespec& timeStamp);
+
+  private:
+    /** @brief Max length of the formatted string, including terminator. */
+    static constexpr size_t maxLength = 64;
+
+    /** @brief Flag to indicate that the cache is filled. */
+    bool cached;
+    /** @brief Second of the cached string (time since epoch). */
+    time_t second;
+    /** @brief Minute of the cached string (local time since epoch). */
+    time_t minute;
+    /** @brief Timezone offset in seconds east of UTC. */
+    long gmtOffset;
+    /** @brief Position of milliseconds in the cached string. */
+    size_t msPos;
+    /** @brief Length of the cached string. */
+    size_t length;
+    /** @brief Cached string. */
+    char text[maxLength];
+};
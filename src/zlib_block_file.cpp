@@ -0,0 +1,394 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "zlib_block_file.hpp"
+
+#include "zlib_exception.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+/** @brief Window bits of deflate: max window with gzip wrapper. */
+static constexpr int gzipWindowBits = MAX_WBITS + 16;
+/** @brief Memory level of deflate, the same as used by gzopen. */
+static constexpr int defaultMemLevel = 8;
+
+/** @brief Header of the trailer member, up to the extra field length. */
+static constexpr uint8_t trailerHeader[] = {
+    0x1f, 0x8b,             // gzip magic
+    Z_DEFLATED,             // compression method
+    0x04,                   // flags: FEXTRA
+    0,    0,    0,    0,    // modification time
+    0,                      // extra flags
+    0xff                    // OS: unknown
+};
+/** @brief Subfield ID of the index in the extra field. */
+static constexpr uint8_t indexId[] = {'H', 'L'};
+/** @brief End of the trailer member: empty deflate block, CRC and size. */
+static constexpr uint8_t trailerEnd[] = {0x03, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+/** @brief Size of an index entry in the file. */
+static constexpr size_t entrySize = 3 * sizeof(uint64_t);
+/** @brief Max size of the index: the extra field is limited to 64 KiB. */
+static constexpr size_t maxIndexSize =
+    (UINT16_MAX - sizeof(indexId) - sizeof(uint16_t)) / entrySize * entrySize;
+
+/** @brief Store the number in little-endian byte order. */
+static uint8_t* storeLe(uint8_t* ptr, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        *ptr++ = static_cast<uint8_t>(value >> (i * 8));
+    }
+    return ptr;
+}
+
+/** @brief Load the number in little-endian byte order. */
+static uint64_t loadLe(const uint8_t* ptr, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        value |= static_cast<uint64_t>(ptr[i]) << (i * 8);
+    }
+    return value;
+}
+
+/**
+ * @brief Read the part of the file.
+ *
+ * @param[in] fd file descriptor
+ * @param[out] buf buffer for the data
+ * @param[in] len size of the data
+ * @param[in] offset position in the file
+ *
+ * @return false if the file is too short or can not be read
+ */
+static bool readAt(int fd, void* buf, size_t len, uint64_t offset)
+{
+    uint8_t* ptr = static_cast<uint8_t*>(buf);
+    while (len)
+    {
+        const ssize_t rc = pread(fd, ptr, len, static_cast<off_t>(offset));
+        if (rc < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (rc <= 0)
+        {
+            return false;
+        }
+        ptr += rc;
+        len -= static_cast<size_t>(rc);
+        offset += static_cast<uint64_t>(rc);
+    }
+    return true;
+}
+
+/**
+ * @class FileReader
+ * @brief Read-only file descriptor closed on scope exit.
+ */
+class FileReader
+{
+  public:
+    explicit FileReader(const std::string& fileName) :
+        fd(open(fileName.c_str(), O_RDONLY | O_CLOEXEC))
+    {
+        if (fd == -1)
+        {
+            std::error_code ec(errno, std::generic_category());
+            throw std::system_error(ec, "Unable to open " + fileName);
+        }
+    }
+
+    ~FileReader()
+    {
+        close(fd);
+    }
+
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    /** @brief File descriptor. */
+    const int fd;
+};
+
+ZlibBlockFile::ZlibBlockFile(const std::string& fileName, int level,
+                             size_t blockSize) :
+    LogWriter(fileName), stream{}, blockSize(blockSize ? blockSize : 1),
+    blockBytes(0), memberDone(false), fileOffset(0), lines(0), lastTime(0)
+{
+    if (!openFile())
+    {
+        throw ZlibException(ZlibException::create, Z_ERRNO, nullptr,
+                            fileName);
+    }
+
+    const int rc = deflateInit2(&stream, level, Z_DEFLATED, gzipWindowBits,
+                                defaultMemLevel, Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK)
+    {
+        closeFile();
+        throw ZlibException(ZlibException::create, rc, &stream, fileName);
+    }
+
+    output.resize(bufferSize);
+}
+
+ZlibBlockFile::~ZlibBlockFile()
+{
+    abandonFile();
+}
+
+void ZlibBlockFile::close()
+{
+    if (!finishFile())
+    {
+        throw ZlibException(ZlibException::close, Z_ERRNO, nullptr, fileName);
+    }
+}
+
+std::vector<ZlibBlockFile::Block>
+    ZlibBlockFile::readIndex(const std::string& fileName)
+{
+    const FileReader file(fileName);
+    struct stat st;
+    if (fstat(file.fd, &st) != 0)
+    {
+        std::error_code ec(errno, std::generic_category());
+        throw std::system_error(ec, "Unable to read " + fileName);
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+
+    // The last entry points to the trailer
+    uint8_t tail[entrySize + sizeof(trailerEnd)];
+    if (fileSize < sizeof(trailerHeader) + sizeof(tail) ||
+        !readAt(file.fd, tail, sizeof(tail), fileSize - sizeof(tail)) ||
+        memcmp(tail + entrySize, trailerEnd, sizeof(trailerEnd)) != 0)
+    {
+        return {};
+    }
+    const uint64_t trailer = loadLe(tail, sizeof(uint64_t));
+    constexpr size_t headerSize =
+        sizeof(trailerHeader) + 2 * sizeof(uint16_t) + sizeof(indexId);
+    uint8_t header[headerSize];
+    if (trailer >= fileSize ||
+        !readAt(file.fd, header, sizeof(header), trailer) ||
+        memcmp(header, trailerHeader, sizeof(trailerHeader)) != 0)
+    {
+        return {};
+    }
+    const uint8_t* field = header + sizeof(trailerHeader);
+    const size_t extraSize = loadLe(field, sizeof(uint16_t));
+    field += sizeof(uint16_t);
+    const size_t indexSize = loadLe(field + sizeof(indexId), sizeof(uint16_t));
+    if (memcmp(field, indexId, sizeof(indexId)) != 0 ||
+        extraSize != indexSize + sizeof(indexId) + sizeof(uint16_t) ||
+        indexSize % entrySize != 0 ||
+        trailer + headerSize + indexSize + sizeof(trailerEnd) != fileSize)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> data(indexSize);
+    if (!readAt(file.fd, data.data(), data.size(), trailer + headerSize))
+    {
+        return {};
+    }
+    std::vector<Block> index;
+    index.reserve(indexSize / entrySize);
+    for (const uint8_t* ptr = data.data(); ptr < data.data() + data.size();
+         ptr += entrySize)
+    {
+        index.push_back(Block{
+            loadLe(ptr, sizeof(uint64_t)),
+            loadLe(ptr + sizeof(uint64_t), sizeof(uint64_t)),
+            static_cast<int64_t>(
+                loadLe(ptr + 2 * sizeof(uint64_t), sizeof(uint64_t)))});
+    }
+    return index;
+}
+
+std::string ZlibBlockFile::readBlocks(const std::string& fileName,
+                                      const Block& begin, const Block& end)
+{
+    if (end.offset < begin.offset)
+    {
+        throw std::invalid_argument("Invalid range of blocks");
+    }
+    const FileReader file(fileName);
+    std::vector<Bytef> input(end.offset - begin.offset);
+    if (!readAt(file.fd, input.data(), input.size(), begin.offset))
+    {
+        std::error_code ec(errno ? errno : EIO, std::generic_category());
+        throw std::system_error(ec, "Unable to read " + fileName);
+    }
+
+    z_stream strm{};
+    int rc = inflateInit2(&strm, gzipWindowBits);
+    if (rc != Z_OK)
+    {
+        throw std::runtime_error("Unable to initialize zlib");
+    }
+    std::string text;
+    std::vector<Bytef> buf(bufferSize);
+    strm.next_in = input.data();
+    strm.avail_in = static_cast<uInt>(input.size());
+    bool memberEnd = true; // Empty range has no members
+    do
+    {
+        const uInt availIn = strm.avail_in;
+        strm.next_out = buf.data();
+        strm.avail_out = static_cast<uInt>(buf.size());
+        rc = inflate(&strm, Z_NO_FLUSH);
+        text.append(reinterpret_cast<const char*>(buf.data()),
+                    buf.size() - strm.avail_out);
+        if (rc == Z_STREAM_END)
+        {
+            memberEnd = true;
+            rc = inflateReset(&strm); // Next member
+        }
+        else if (strm.avail_in != availIn || strm.avail_out != buf.size())
+        {
+            memberEnd = false;
+        }
+        if (rc != Z_OK && rc != Z_BUF_ERROR)
+        {
+            inflateEnd(&strm);
+            throw std::runtime_error("Corrupted block in " + fileName);
+        }
+    } while (strm.avail_in || strm.avail_out == 0);
+    inflateEnd(&strm);
+    if (!memberEnd)
+    {
+        throw std::runtime_error("Truncated block in " + fileName);
+    }
+    return text;
+}
+
+void ZlibBlockFile::startRecord(const timespec& timeStamp)
+{
+    const int64_t time = static_cast<int64_t>(timeStamp.tv_sec) * 1000 +
+                         timeStamp.tv_nsec / 1'000'000;
+    if (blocks.empty() || blockBytes + buffered() >= blockSize)
+    {
+        if (!blocks.empty())
+        {
+            // Staging buffer has complete records only
+            flushInput(Flush::finish);
+        }
+        blocks.push_back(Block{fileOffset, lines, time});
+        blockBytes = 0;
+    }
+    ++lines;
+    lastTime = time;
+}
+
+void ZlibBlockFile::encode(const char* data, size_t len, Flush flush)
+{
+    if (memberDone)
+    {
+        if (!len && flush == Flush::finish)
+        {
+            return; // Nothing was written since the last block
+        }
+        deflateReset(&stream);
+        memberDone = false;
+    }
+
+    int zflush = Z_NO_FLUSH;
+    if (flush == Flush::sync)
+    {
+        zflush = Z_SYNC_FLUSH;
+    }
+    else if (flush == Flush::finish)
+    {
+        zflush = Z_FINISH;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(len);
+    int rc;
+    do
+    {
+        stream.next_out = output.data();
+        stream.avail_out = static_cast<uInt>(output.size());
+        rc = deflate(&stream, zflush);
+        if (rc == Z_STREAM_ERROR)
+        {
+            throw ZlibException(ZlibException::write, rc, &stream, fileName);
+        }
+        const size_t outLen = output.size() - stream.avail_out;
+        if (!writeFile(output.data(), outLen))
+        {
+            throw ZlibException(ZlibException::write, Z_ERRNO, nullptr,
+                                fileName);
+        }
+        fileOffset += outLen;
+    } while (stream.avail_out == 0 ||
+             (zflush == Z_FINISH && rc != Z_STREAM_END));
+
+    blockBytes += len;
+    memberDone = zflush == Z_FINISH;
+}
+
+void ZlibBlockFile::writeTrailer()
+{
+    writeIndex();
+}
+
+void ZlibBlockFile::releaseEncoder()
+{
+    deflateEnd(&stream);
+}
+
+void ZlibBlockFile::writeIndex()
+{
+    // The end of the log points to the trailer
+    std::vector<Block> index = blocks;
+    index.push_back(Block{fileOffset, lines, lastTime});
+
+    // Merge neighbor blocks until the index fits the extra field
+    while (index.size() * entrySize > maxIndexSize)
+    {
+        const Block last = index.back();
+        size_t count = 0;
+        for (size_t i = 0; i + 1 < index.size(); i += 2)
+        {
+            index[count++] = index[i];
+        }
+        index.resize(count);
+        index.push_back(last);
+    }
+
+    const size_t indexSize = index.size() * entrySize;
+    std::vector<uint8_t> trailer(sizeof(trailerHeader) + 2 * sizeof(uint16_t) +
+                                 sizeof(indexId) + indexSize +
+                                 sizeof(trailerEnd));
+    uint8_t* ptr = trailer.data();
+    memcpy(ptr, trailerHeader, sizeof(trailerHeader));
+    ptr += sizeof(trailerHeader);
+    ptr = storeLe(ptr, indexSize + sizeof(indexId) + sizeof(uint16_t),
+                  sizeof(uint16_t));
+    memcpy(ptr, indexId, sizeof(indexId));
+    ptr += sizeof(indexId);
+    ptr = storeLe(ptr, indexSize, sizeof(uint16_t));
+    for (const Block& block : index)
+    {
+        ptr = storeLe(ptr, block.offset, sizeof(uint64_t));
+        ptr = storeLe(ptr, block.line, sizeof(uint64_t));
+        ptr = storeLe(ptr, static_cast<uint64_t>(block.time),
+                      sizeof(uint64_t));
+    }
+    memcpy(ptr, trailerEnd, sizeof(trailerEnd));
+
+    if (!writeFile(trailer.data(), trailer.size()))
+    {
+        throw ZlibException(ZlibException::write, Z_ERRNO, nullptr, fileName);
+    }
+}
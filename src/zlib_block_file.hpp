@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class ZlibBlockFile
+ * @brief Log file writer with gzip compression split into seekable blocks.
+ *
+ * Each block is a complete gzip member that starts at a record boundary, so
+ * any block can be decompressed alone and the whole file is still read by
+ * zcat. The index of blocks is stored in the trailer: an empty gzip member
+ * with the index in the extra field of its header, which is ignored by gzip.
+ * The last index entry describes the end of the log and points to the
+ * trailer itself, so the index is found from the end of the file.
+ */
+class ZlibBlockFile : public LogWriter
+{
+  public:
+    /**
+     * @struct Block
+     * @brief Index entry: position of the block in the file and in the log.
+     */
+    struct Block
+    {
+        /** @brief Offset of the gzip member in the file. */
+        uint64_t offset;
+        /** @brief Number of the first record in the block, from 0. */
+        uint64_t line;
+        /** @brief Time stamp of the first record in milliseconds. */
+        int64_t time;
+    };
+
+    /**
+     * @brief Constructor create new file for writing logs.
+     *
+     * @param[in] fileName path to the file
+     * @param[in] level compression level
+     * @param[in] blockSize size of uncompressed data in a block
+     *
+     * @throw ZlibException in case of errors
+     */
+    ZlibBlockFile(const std::string& fileName, int level, size_t blockSize);
+
+    ~ZlibBlockFile() override;
+
+    /**
+     * @brief Close file: finish the last block and write the index.
+     *
+     * @throw ZlibException in case of errors
+     */
+    void close() override;
+
+    /**
+     * @brief Read the index of blocks from the file.
+     *
+     * @param[in] fileName path to the file
+     *
+     * @throw std::system_error if the file can not be read
+     *
+     * @return index entries followed by the end of the log entry, empty if
+     *         the file has no index
+     */
+    static std::vector<Block> readIndex(const std::string& fileName);
+
+    /**
+     * @brief Decompress the range of blocks.
+     *
+     * @param[in] fileName path to the file
+     * @param[in] begin index entry of the first block
+     * @param[in] end index entry that follows the last block
+     *
+     * @throw std::exception in case of errors
+     *
+     * @return text of the log records in the blocks
+     */
+    static std::string readBlocks(const std::string& fileName,
+                                  const Block& begin, const Block& end);
+
+  protected:
+    void startRecord(const timespec& timeStamp) override;
+    void encode(const char* data, size_t len, Flush flush) override;
+    void writeTrailer() override;
+    void releaseEncoder() override;
+
+  private:
+    /**
+     * @brief Write the trailer with the index.
+     *
+     * @throw ZlibException in case of errors
+     */
+    void writeIndex();
+
+  private:
+    /** @brief Compression stream. */
+    z_stream stream;
+    /** @brief Compressed output buffer. */
+    std::vector<Bytef> output;
+    /** @brief Size of uncompressed data in a block. */
+    size_t blockSize;
+    /** @brief Size of uncompressed data in the current block. */
+    size_t blockBytes;
+    /** @brief Flag to start a new gzip member on the next input. */
+    bool memberDone;
+    /** @brief Size of the written output. */
+    uint64_t fileOffset;
+    /** @brief Number of written records. */
+    uint64_t lines;
+    /** @brief Time stamp of the last record in milliseconds. */
+    int64_t lastTime;
+    /** @brief Index of blocks. */
+    std::vector<Block> blocks;
+};
@@ -5,7 +5,7 @@
 
 #include <cstring>
 
-ZlibException::ZlibException(Operation op, int code, gzFile fd,
+ZlibException::ZlibException(Operation op, int code, const z_stream* stream,
                              const std::string& fileName)
 {
     std::string details;
@@ -15,18 +15,13 @@ ZlibException::ZlibException(Operation op, int code, gzFile fd,
         const int errCode = errno ? errno : EIO;
         details = strerror(errCode);
     }
-    else if (fd != Z_NULL)
+    else if (stream && stream->msg)
     {
         // Try to get description from zLib
-        int lastErrCode = 0;
-        const char* lastErrDesc = gzerror(fd, &lastErrCode);
-        if (lastErrCode)
-        {
-            details = '[';
-            details += std::to_string(lastErrCode);
-            details += "] ";
-            details += lastErrDesc;
-        }
+        details = '[';
+        details += std::to_string(code);
+        details += "] ";
+        details += stream->msg;
     }
     if (details.empty())
     {
@@ -28,10 +28,10 @@ class ZlibException : public std::exception
      *
      * @param[in] op type of operation
      * @param[in] code zLib status code
-     * @param[in] fd zLib file descriptor
+     * @param[in] stream zLib compression stream, may be null
      * @param[in] fileName file name
      */
-    ZlibException(Operation op, int code, gzFile fd,
+    ZlibException(Operation op, int code, const z_stream* stream,
                   const std::string& fileName);
 
     // From std::exception
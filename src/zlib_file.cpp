@@ -5,73 +5,78 @@
 
 #include "zlib_exception.hpp"
 
-ZlibFile::ZlibFile(const std::string& fileName)
+/** @brief Window bits of deflate: max window with gzip wrapper. */
+static constexpr int gzipWindowBits = MAX_WBITS + 16;
+/** @brief Memory level of deflate, the same as used by gzopen. */
+static constexpr int defaultMemLevel = 8;
+
+ZlibFile::ZlibFile(const std::string& fileName, int level) :
+    LogWriter(fileName), stream{}
 {
-    fd = gzopen(fileName.c_str(), "w");
-    if (fd == Z_NULL)
+    if (!openFile())
+    {
+        throw ZlibException(ZlibException::create, Z_ERRNO, nullptr,
+                            fileName);
+    }
+
+    const int rc = deflateInit2(&stream, level, Z_DEFLATED, gzipWindowBits,
+                                defaultMemLevel, Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK)
     {
-        throw ZlibException(ZlibException::create, Z_ERRNO, fd, fileName);
+        closeFile();
+        throw ZlibException(ZlibException::create, rc, &stream, fileName);
     }
-    this->fileName = fileName;
+
+    output.resize(bufferSize);
 }
 
 ZlibFile::~ZlibFile()
 {
-    if (fd != Z_NULL)
-    {
-        gzclose_w(fd);
-    }
+    abandonFile();
 }
 
 void ZlibFile::close()
 {
-    if (fd != Z_NULL)
+    if (!finishFile())
     {
-        const int rc = gzclose_w(fd);
-        if (rc != Z_OK)
-        {
-            throw ZlibException(ZlibException::close, rc, fd, fileName);
-        }
-        fd = Z_NULL;
-        fileName.clear();
+        throw ZlibException(ZlibException::close, Z_ERRNO, nullptr, fileName);
     }
 }
 
-void ZlibFile::write(const tm& timeStamp, const std::string& message) const
+void ZlibFile::encode(const char* data, size_t len, Flush flush)
 {
-    int rc;
-
-    // Write time stamp.
-    // "tm_gmtoff" is the number of seconds east of UTC, so we need to calculate
-    // timezone offset. For example, for U.S. Eastern Standard Time, the value
-    // is -18000 = -5*60*60."
-
-    rc = gzprintf(fd, "[ %i-%02i-%02iT%02i:%02i:%02i%+03ld:%02ld ] ",
-                  timeStamp.tm_year + 1900, timeStamp.tm_mon + 1,
-                  timeStamp.tm_mday, timeStamp.tm_hour, timeStamp.tm_min,
-                  timeStamp.tm_sec, timeStamp.tm_gmtoff / (60 * 60),
-                  labs(timeStamp.tm_gmtoff % (60 * 60)) / 60);
-
-    if (rc <= 0)
+    int zflush = Z_NO_FLUSH;
+    if (flush == Flush::sync)
+    {
+        zflush = Z_SYNC_FLUSH;
+    }
+    else if (flush == Flush::finish)
     {
-        throw ZlibException(ZlibException::write, rc, fd, fileName);
+        zflush = Z_FINISH;
     }
 
-    // Write message
-    const size_t len = message.length();
-    if (len)
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(len);
+    int rc;
+    do
     {
-        rc = gzwrite(fd, message.data(), static_cast<unsigned int>(len));
-        if (rc <= 0)
+        stream.next_out = output.data();
+        stream.avail_out = static_cast<uInt>(output.size());
+        rc = deflate(&stream, zflush);
+        if (rc == Z_STREAM_ERROR)
         {
-            throw ZlibException(ZlibException::write, rc, fd, fileName);
+            throw ZlibException(ZlibException::write, rc, &stream, fileName);
         }
-    }
+        if (!writeFile(output.data(), output.size() - stream.avail_out))
+        {
+            throw ZlibException(ZlibException::write, Z_ERRNO, nullptr,
+                                fileName);
+        }
+    } while (stream.avail_out == 0 ||
+             (zflush == Z_FINISH && rc != Z_STREAM_END));
+}
 
-    // Write EOL
-    rc = gzputc(fd, '\n');
-    if (rc <= 0)
-    {
-        throw ZlibException(ZlibException::write, rc, fd, fileName);
-    }
+void ZlibFile::releaseEncoder()
+{
+    deflateEnd(&stream);
 }
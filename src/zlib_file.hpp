@@ -3,52 +3,48 @@
 
 #pragma once
 
+#include "log_writer.hpp"
+
 #include <zlib.h>
 
-#include <ctime>
 #include <string>
+#include <vector>
 
 /**
  * @class ZlibFile
- * @brief Log file writer.
+ * @brief Log file writer with gzip compression.
+ *
+ * The output is the same as produced by zlib's gz* functions.
  */
-class ZlibFile
+class ZlibFile : public LogWriter
 {
   public:
     /**
      * @brief Constructor create new file for writing logs.
      *
      * @param[in] fileName path to the file
+     * @param[in] level compression level
      *
      * @throw ZlibException in case of errors
      */
-    ZlibFile(const std::string& fileName);
-
-    ~ZlibFile();
+    ZlibFile(const std::string& fileName, int level = Z_DEFAULT_COMPRESSION);
 
-    ZlibFile(const ZlibFile&) = delete;
-    ZlibFile& operator=(const ZlibFile&) = delete;
+    ~ZlibFile() override;
 
     /**
      * @brief Close file.
      *
      * @throw ZlibException in case of errors
      */
-    void close();
+    void close() override;
 
-    /**
-     * @brief Write single log message to the file.
-     *
-     * @param[in] timeStamp time stamp of the log message
-     * @param[in] message log message text
-     *
-     * @throw ZlibException in case of errors
-     */
-    void write(const tm& timeStamp, const std::string& message) const;
+  protected:
+    void encode(const char* data, size_t len, Flush flush) override;
+    void releaseEncoder() override;
 
   private:
-    /** @brief File name. */
-    std::string fileName;
-    /** @brief zLib file descriptor. */
-    gzFile fd;
+    /** @brief Compression stream. */
+    z_stream stream;
+    /** @brief Compressed output buffer. */
+    std::vector<Bytef> output;
 };
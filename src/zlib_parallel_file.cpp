@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "zlib_parallel_file.hpp"
+
+#include "zlib_exception.hpp"
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+
+/** @brief Size of the log data in a single block. */
+static constexpr size_t blockSize = 128 * 1024;
+/** @brief Max size of the dictionary, the deflate window. */
+static constexpr size_t dictSize = 32 * 1024;
+/** @brief Memory level of deflate, the same as used by gzopen. */
+static constexpr int defaultMemLevel = 8;
+/** @brief OS code in the gzip header, the same as written by zlib. */
+static constexpr Bytef osCodeUnix = 3;
+
+ZlibParallelFile::ZlibParallelFile(const std::string& fileName, int level,
+                                   size_t threads) :
+    LogWriter(fileName), level(level), maxPending(threads * 2), crc(0),
+    totalLen(0), stopping(false)
+{
+    if (!openFile())
+    {
+        throw ZlibException(ZlibException::create, Z_ERRNO, nullptr,
+                            fileName);
+    }
+
+    // Header of gzip stream, extra flags are the same as set by deflate
+    const Bytef header[] = {
+        0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0,
+        static_cast<Bytef>(level == 9 ? 2 : (level == 0 || level == 1 ? 4 : 0)),
+        osCodeUnix};
+    try
+    {
+        writeOut(header, sizeof(header));
+    }
+    catch (const ZlibException&)
+    {
+        closeFile();
+        throw;
+    }
+
+    current = std::make_shared<Block>();
+    current->input.reserve(blockSize + bufferSize);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(&ZlibParallelFile::process, this);
+    }
+}
+
+ZlibParallelFile::~ZlibParallelFile()
+{
+    abandonFile();
+    stop();
+}
+
+void ZlibParallelFile::close()
+{
+    if (!finishFile())
+    {
+        throw ZlibException(ZlibException::close, Z_ERRNO, nullptr, fileName);
+    }
+}
+
+void ZlibParallelFile::releaseEncoder()
+{
+    stop();
+}
+
+void ZlibParallelFile::encode(const char* data, size_t len, Flush flush)
+{
+    std::vector<Bytef>& input = current->input;
+    input.insert(input.end(), data, data + len);
+
+    const size_t dataLen = input.size() - current->dictLen;
+    if (dataLen >= blockSize || (flush == Flush::sync && dataLen) ||
+        flush == Flush::finish)
+    {
+        submit(flush == Flush::finish);
+    }
+
+    if (flush == Flush::none)
+    {
+        writeBlocks(maxPending);
+    }
+    else
+    {
+        writeBlocks(0);
+    }
+
+    if (flush == Flush::finish)
+    {
+        // Trailer of gzip stream: check sum and size of uncompressed data
+        Bytef trailer[8];
+        for (size_t i = 0; i < 4; ++i)
+        {
+            trailer[i] = static_cast<Bytef>(crc >> (i * 8));
+            trailer[i + 4] = static_cast<Bytef>(totalLen >> (i * 8));
+        }
+        writeOut(trailer, sizeof(trailer));
+    }
+}
+
+void ZlibParallelFile::submit(bool last)
+{
+    std::shared_ptr<Block> next = std::make_shared<Block>();
+    next->input.reserve(blockSize + bufferSize);
+
+    // Prime the next block with the tail of the current one
+    const std::vector<Bytef>& input = current->input;
+    const size_t dataLen = input.size() - current->dictLen;
+    if (dataLen >= dictSize)
+    {
+        next->input.assign(input.end() - dictSize, input.end());
+    }
+    else
+    {
+        // Short block: the dictionary is continued with its data
+        const size_t keep = std::min(input.size(), dictSize);
+        next->input.assign(input.end() - keep, input.end());
+    }
+    next->dictLen = next->input.size();
+
+    current->last = last;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(current);
+        pending.push_back(current);
+        jobCond.notify_one();
+    }
+    current = std::move(next);
+}
+
+void ZlibParallelFile::writeBlocks(size_t limit)
+{
+    while (true)
+    {
+        std::shared_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (pending.empty() ||
+                (pending.size() <= limit && !pending.front()->done))
+            {
+                return;
+            }
+            doneCond.wait(lock, [this]() { return pending.front()->done; });
+            block = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        if (block->status != Z_OK)
+        {
+            throw ZlibException(ZlibException::write, block->status, nullptr,
+                                fileName);
+        }
+        writeOut(block->output.data(), block->output.size());
+
+        const size_t dataLen = block->input.size() - block->dictLen;
+        crc = crc32_combine(crc, block->crc, static_cast<z_off_t>(dataLen));
+        totalLen += dataLen;
+    }
+}
+
+void ZlibParallelFile::writeOut(const void* data, size_t len)
+{
+    if (!writeFile(data, len))
+    {
+        throw ZlibException(ZlibException::write, Z_ERRNO, nullptr, fileName);
+    }
+}
+
+void ZlibParallelFile::process()
+{
+    // Signals are handled by the event loop of the main thread only
+    sigset_t ss;
+    sigfillset(&ss);
+    pthread_sigmask(SIG_BLOCK, &ss, nullptr);
+
+    // Each worker reuses its own raw deflate stream
+    z_stream stream{};
+    const int initRc = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS,
+                                    defaultMemLevel, Z_DEFAULT_STRATEGY);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        jobCond.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+        {
+            break;
+        }
+        std::shared_ptr<Block> block = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        Bytef* data = block->input.data() + block->dictLen;
+        const size_t dataLen = block->input.size() - block->dictLen;
+        int rc = initRc;
+        if (rc == Z_OK)
+        {
+            deflateReset(&stream);
+            if (block->dictLen)
+            {
+                rc = deflateSetDictionary(&stream, block->input.data(),
+                                          static_cast<uInt>(block->dictLen));
+            }
+        }
+        if (rc == Z_OK)
+        {
+            const int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+            // Extra space for the sync flush marker
+            block->output.resize(deflateBound(&stream, dataLen) + 16);
+            stream.next_in = data;
+            stream.avail_in = static_cast<uInt>(dataLen);
+            stream.next_out = block->output.data();
+            stream.avail_out = static_cast<uInt>(block->output.size());
+            rc = deflate(&stream, flush);
+            if (rc == Z_STREAM_END || (rc == Z_OK && stream.avail_out))
+            {
+                block->output.resize(block->output.size() -
+                                     stream.avail_out);
+                rc = Z_OK;
+            }
+            else if (rc == Z_OK)
+            {
+                rc = Z_BUF_ERROR; // Output buffer is too small
+            }
+        }
+        block->crc = crc32(0, data, static_cast<uInt>(dataLen));
+        block->status = rc;
+
+        lock.lock();
+        block->done = true;
+        doneCond.notify_all();
+    }
+    lock.unlock();
+
+    if (initRc == Z_OK)
+    {
+        deflateEnd(&stream);
+    }
+}
+
+void ZlibParallelFile::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobCond.notify_all();
+    }
+    for (auto& worker : workers)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+    workers.clear();
+}
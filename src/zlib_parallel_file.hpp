@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <zlib.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ZlibParallelFile
+ * @brief Log file writer with gzip compression on multiple threads.
+ *
+ * The log is split into blocks, each block is deflated independently by a
+ * pool of worker threads. The tail of the previous block is used as a
+ * dictionary, so the compression ratio is close to the single-threaded one.
+ * Every block ends on a byte boundary (sync flush), so compressed blocks are
+ * concatenated into a single gzip stream, check sums of the blocks are
+ * combined into the trailer.
+ */
+class ZlibParallelFile : public LogWriter
+{
+  public:
+    /**
+     * @brief Constructor create new file for writing logs.
+     *
+     * @param[in] fileName path to the file
+     * @param[in] level compression level
+     * @param[in] threads number of compression threads
+     *
+     * @throw std::exception in case of errors
+     */
+    ZlibParallelFile(const std::string& fileName, int level, size_t threads);
+
+    ~ZlibParallelFile() override;
+
+    /**
+     * @brief Close file.
+     *
+     * @throw ZlibException in case of errors
+     */
+    void close() override;
+
+  protected:
+    void encode(const char* data, size_t len, Flush flush) override;
+    void releaseEncoder() override;
+
+  private:
+    /**
+     * @struct Block
+     * @brief Compression job: a part of the log.
+     */
+    struct Block
+    {
+        /** @brief Dictionary followed by the data to compress. */
+        std::vector<Bytef> input;
+        /** @brief Size of the dictionary at the beginning of input. */
+        size_t dictLen = 0;
+        /** @brief Flag to indicate that this is the last block. */
+        bool last = false;
+        /** @brief Compressed data. */
+        std::vector<Bytef> output;
+        /** @brief Check sum of the data. */
+        uLong crc = 0;
+        /** @brief zLib status code of compression. */
+        int status = Z_OK;
+        /** @brief Flag to indicate that the block is processed. */
+        bool done = false;
+    };
+
+    /**
+     * @brief Queue the current block for compression and start a new one.
+     *
+     * @param[in] last flag to indicate that this is the last block
+     */
+    void submit(bool last);
+
+    /**
+     * @brief Write compressed blocks to the file in order.
+     *
+     * @param[in] limit number of blocks that can be left in progress
+     *
+     * @throw ZlibException in case of errors
+     */
+    void writeBlocks(size_t limit);
+
+    /**
+     * @brief Write data to the file.
+     *
+     * @param[in] data pointer to the data
+     * @param[in] len size of the data in bytes
+     *
+     * @throw ZlibException in case of errors
+     */
+    void writeOut(const void* data, size_t len);
+
+    /** @brief Worker thread function. */
+    void process();
+
+    /** @brief Stop worker threads. */
+    void stop();
+
+  private:
+    /** @brief Compression level. */
+    int level;
+    /** @brief Max number of blocks in progress. */
+    size_t maxPending;
+    /** @brief Block being filled. */
+    std::shared_ptr<Block> current;
+    /** @brief Check sum of the data written to the file. */
+    uLong crc;
+    /** @brief Size of the data written to the file. */
+    uLong totalLen;
+
+    /** @brief Mutex protecting the fields below. */
+    std::mutex mutex;
+    /** @brief Condition used to signal new jobs. */
+    std::condition_variable jobCond;
+    /** @brief Condition used to signal processed blocks. */
+    std::condition_variable doneCond;
+    /** @brief Blocks waiting for compression. */
+    std::deque<std::shared_ptr<Block>> jobs;
+    /** @brief Blocks waiting for writing, in order of the log. */
+    std::deque<std::shared_ptr<Block>> pending;
+    /** @brief Flag to stop worker threads. */
+    bool stopping;
+
+    /** @brief Worker threads. */
+    std::vector<std::thread> workers;
+};
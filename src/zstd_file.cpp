@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "zstd_file.hpp"
+
+#include <stdexcept>
+
+ZstdFile::ZstdFile(const std::string& fileName, int level) :
+    LogWriter(fileName), ctx(nullptr)
+{
+    if (!openFile())
+    {
+        failFile("create");
+    }
+
+    ctx = ZSTD_createCCtx();
+    if (!ctx)
+    {
+        closeFile();
+        throw std::bad_alloc();
+    }
+    const size_t rc = ZSTD_CCtx_setParameter(
+        ctx, ZSTD_c_compressionLevel, level ? level : ZSTD_CLEVEL_DEFAULT);
+    if (ZSTD_isError(rc))
+    {
+        ZSTD_freeCCtx(ctx);
+        closeFile();
+        std::string err = "Unable to initialize zstd for ";
+        err += fileName;
+        err += ": ";
+        err += ZSTD_getErrorName(rc);
+        throw std::invalid_argument(err);
+    }
+
+    output.resize(ZSTD_CStreamOutSize());
+}
+
+ZstdFile::~ZstdFile()
+{
+    abandonFile();
+}
+
+void ZstdFile::close()
+{
+    if (!finishFile())
+    {
+        failFile("close");
+    }
+}
+
+void ZstdFile::releaseEncoder()
+{
+    ZSTD_freeCCtx(ctx);
+    ctx = nullptr;
+}
+
+void ZstdFile::encode(const char* data, size_t len, Flush flush)
+{
+    ZSTD_EndDirective mode = ZSTD_e_continue;
+    if (flush == Flush::sync)
+    {
+        mode = ZSTD_e_flush;
+    }
+    else if (flush == Flush::finish)
+    {
+        mode = ZSTD_e_end;
+    }
+
+    ZSTD_inBuffer in{data, len, 0};
+    size_t remaining;
+    do
+    {
+        ZSTD_outBuffer out{output.data(), output.size(), 0};
+        remaining = ZSTD_compressStream2(ctx, &out, &in, mode);
+        if (ZSTD_isError(remaining))
+        {
+            fail(remaining);
+        }
+        if (!writeFile(output.data(), out.pos))
+        {
+            failFile("write");
+        }
+    } while (mode == ZSTD_e_continue ? in.pos < in.size : remaining != 0);
+}
+
+void ZstdFile::fail(size_t code) const
+{
+    std::string err = "Unable to write file ";
+    err += fileName;
+    err += ": ";
+    err += ZSTD_getErrorName(code);
+    throw std::runtime_error(err);
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include "log_writer.hpp"
+
+#include <zstd.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * @class ZstdFile
+ * @brief Log file writer with Zstandard compression.
+ */
+class ZstdFile : public LogWriter
+{
+  public:
+    /**
+     * @brief Constructor create new file for writing logs.
+     *
+     * @param[in] fileName path to the file
+     * @param[in] level compression level, 0 for default
+     *
+     * @throw std::invalid_argument if the encoder can't be initialized
+     * @throw std::exception in case of errors
+     */
+    ZstdFile(const std::string& fileName, int level);
+
+    ~ZstdFile() override;
+
+    /**
+     * @brief Close file.
+     *
+     * @throw std::exception in case of errors
+     */
+    void close() override;
+
+  protected:
+    void encode(const char* data, size_t len, Flush flush) override;
+    void releaseEncoder() override;
+
+  private:
+    /**
+     * @brief Throw exception for the zstd error code.
+     *
+     * @param[in] code zstd error code
+     */
+    [[noreturn]] void fail(size_t code) const;
+
+  private:
+    /** @brief Compression context. */
+    ZSTD_CCtx* ctx;
+    /** @brief Compressed output buffer. */
+    std::vector<char> output;
+};
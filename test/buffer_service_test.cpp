@@ -8,9 +8,14 @@
 #include "host_console_mock.hpp"
 #include "log_buffer_mock.hpp"
 
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 #include <memory>
 #include <string>
 #include <system_error>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -19,6 +24,7 @@ namespace
 {
 
 constexpr char firstDatagram[] = "Hello world";
+constexpr char socketPath[] = "\0hostlogger_both";
 // Shouldn't read more than maximum size of a datagram.
 constexpr int consoleReadMaxSize = 1024;
 
@@ -29,6 +35,7 @@ using ::testing::InSequence;
 using ::testing::Le;
 using ::testing::Ref;
 using ::testing::Return;
+using ::testing::SaveArg;
 using ::testing::SetArrayArgument;
 using ::testing::StrEq;
 using ::testing::Test;
@@ -48,7 +55,11 @@ class BufferServiceTest : public Test, public ConfigInTest, public BufferService
     BufferServiceTest() :
         BufferService(ConfigInTest::config, dbusLoopMock, hostConsoleMock,
                       logBufferMock, fileStorageMock)
-    {}
+    {
+        // Size of queued data is unknown, read until the console is drained.
+        EXPECT_CALL(hostConsoleMock, pending())
+            .WillRepeatedly(Return(std::nullopt));
+    }
 
     MOCK_METHOD(void, flush, (), (override));
     MOCK_METHOD(void, readConsole, (), (override));
@@ -92,6 +103,37 @@ TEST_F(BufferServiceTest, FlushOk)
     EXPECT_NO_THROW(BufferService::flush());
 }
 
+TEST_F(BufferServiceTest, FlushMethod)
+{
+    std::string fileName = "none";
+    const DbusLoop::Reply reply = [&fileName](const DbusLoop::MethodResult& res,
+                                              const std::string& error) {
+        EXPECT_EQ(error, "");
+        fileName = std::get<std::string>(res);
+    };
+
+    InSequence sequence;
+    EXPECT_CALL(logBufferMock, empty()).WillOnce(Return(false));
+    EXPECT_CALL(fileStorageMock, save(Ref(logBufferMock)))
+        .WillOnce(Return("/tmp/fake_20200101_000000.log.gz"));
+    EXPECT_CALL(logBufferMock, clear());
+    flushMethod(reply);
+    EXPECT_EQ(fileName, "/tmp/fake_20200101_000000.log.gz");
+
+    // Nothing to save
+    EXPECT_CALL(logBufferMock, empty()).WillOnce(Return(true));
+    flushMethod(reply);
+    EXPECT_EQ(fileName, "");
+
+    // Errors are passed to the caller
+    fileName = "none";
+    EXPECT_CALL(logBufferMock, empty()).WillOnce(Return(false));
+    EXPECT_CALL(fileStorageMock, save(Ref(logBufferMock)))
+        .WillOnce(Throw(std::runtime_error("Mock error")));
+    EXPECT_THROW(flushMethod(reply), std::runtime_error);
+    EXPECT_EQ(fileName, "none");
+}
+
 TEST_F(BufferServiceTest, ReadConsoleExceptionCaught)
 {
     InSequence sequence;
@@ -144,9 +186,139 @@ TEST_F(BufferServiceTest, RunOk)
     EXPECT_CALL(dbusLoopMock,
                 addPropertyHandler(StrEq(ConfigInTest::config.hostState), _, _))
         .WillOnce(Return());
+    DbusLoop::Methods methods;
+    EXPECT_CALL(dbusLoopMock,
+                addObject(StrEq("/xyz/openbmc_project/HostLogger"),
+                          StrEq("xyz.openbmc_project.HostLogger"), _))
+        .WillOnce(SaveArg<2>(&methods));
+    EXPECT_CALL(dbusLoopMock,
+                requestName(StrEq("xyz.openbmc_project.HostLogger")))
+        .WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, run).WillOnce(Return(0));
     EXPECT_CALL(logBufferMock, empty()).WillOnce(Return(false));
     EXPECT_CALL(*this, flush()).WillOnce(Return());
     EXPECT_NO_THROW(run());
+
+    ASSERT_EQ(methods.size(), 2);
+    EXPECT_STREQ(methods["Flush"].result, "s");
+    EXPECT_STREQ(methods["Snapshot"].result, "h");
+}
+
+TEST_F(BufferServiceTest, DbusObjectName)
+{
+    ConfigInTest::config.socketId = "0host.1";
+    EXPECT_CALL(dbusLoopMock,
+                addObject(StrEq("/xyz/openbmc_project/HostLogger/_0host_1"),
+                          StrEq("xyz.openbmc_project.HostLogger"), _))
+        .WillOnce(Return());
+    EXPECT_CALL(dbusLoopMock,
+                requestName(StrEq("xyz.openbmc_project.HostLogger._0host_1")))
+        .WillOnce(Throw(std::system_error(EEXIST, std::generic_category(),
+                                          "Mock error")));
+    // Registration errors don't stop the service
+    EXPECT_NO_THROW(start());
+}
+
+// A helper class that owns config for buffer + stream mode.
+struct BothConfigInTest
+{
+    Config config;
+    BothConfigInTest() : config()
+    {
+        config.mode = Mode::bothMode;
+        config.streamDestination = socketPath;
+        // Send each line in its own datagram without delay.
+        config.streamPack = false;
+        config.streamTimeout = 0;
+    }
+};
+
+/**
+ * @class BufferStreamTest
+ * @brief Tests of buffer + stream mode, both consumers share a single read.
+ */
+class BufferStreamTest :
+    public Test,
+    public BothConfigInTest,
+    public BufferService
+{
+  public:
+    BufferStreamTest() :
+        BufferService(BothConfigInTest::config, dbusLoopMock, hostConsoleMock,
+                      logBuffer, fileStorageMock),
+        logBuffer(0, 0)
+    {
+        EXPECT_CALL(hostConsoleMock, pending())
+            .WillRepeatedly(Return(std::nullopt));
+    }
+    ~BufferStreamTest() override
+    {
+        if (serverSocket != -1)
+        {
+            close(serverSocket);
+        }
+    }
+
+    MOCK_METHOD(void, flush, (), (override));
+
+  protected:
+    // Start a server for reading datagrams.
+    void startServer()
+    {
+        serverSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        ASSERT_NE(serverSocket, -1);
+        sockaddr_un sa{};
+        sa.sun_family = AF_UNIX;
+        memcpy(sa.sun_path, socketPath, sizeof(socketPath) - 1);
+        const socklen_t len =
+            sizeof(sa) - sizeof(sa.sun_path) + sizeof(socketPath) - 1;
+        ASSERT_EQ(
+            bind(serverSocket, reinterpret_cast<const sockaddr*>(&sa), len),
+            0);
+    }
+
+    DbusLoopMock dbusLoopMock;
+    HostConsoleMock hostConsoleMock;
+    FileStorageMock fileStorageMock;
+    LogBuffer logBuffer;
+    int serverSocket = -1;
+};
+
+TEST_F(BufferStreamTest, SharedRead)
+{
+    startServer();
+
+    const std::string data = "line 1\r\nline 2\nline";
+    EXPECT_CALL(hostConsoleMock, connect()).WillOnce(Return());
+    EXPECT_CALL(hostConsoleMock, read(_, _))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.end()),
+                        Return(data.size())))
+        .WillOnce(Return(0));
+    EXPECT_CALL(dbusLoopMock, run).WillOnce([this]() {
+        this->readConsole();
+        return 0;
+    });
+    EXPECT_CALL(*this, flush()).WillOnce(Return());
+    EXPECT_NO_THROW(run());
+
+    // Messages are stored in the buffer
+    std::vector<std::string> messages;
+    for (const auto& msg : logBuffer)
+    {
+        messages.emplace_back(msg.text);
+    }
+    EXPECT_EQ(messages, std::vector<std::string>({"line 1", "line 2", "line"}));
+
+    // The same lines are streamed
+    std::vector<std::string> datagrams;
+    char buffer[consoleReadMaxSize];
+    ssize_t rsz;
+    while ((rsz = recv(serverSocket, buffer, sizeof(buffer), MSG_DONTWAIT)) >
+           0)
+    {
+        datagrams.emplace_back(buffer, rsz);
+    }
+    EXPECT_EQ(datagrams, std::vector<std::string>(
+                             {"line 1\n", "line 2\n", "line\n"}));
 }
 } // namespace
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "config_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+/**
+ * @class ConfigFileTest
+ * @brief Multi-console configuration file tests.
+ */
+class ConfigFileTest : public ::testing::Test
+{
+  protected:
+    void TearDown() override
+    {
+        fs::remove(path);
+    }
+
+    /** @brief Write the configuration file. */
+    void write(const char* content) const
+    {
+        std::ofstream file(path);
+        file << content;
+    }
+
+    const std::string path = "/tmp/hostlogger_config_file_test.conf";
+};
+
+TEST_F(ConfigFileTest, Sections)
+{
+    write("# Shared by all consoles\n"
+          "MAX_FILES=5\n"
+          "OUT_DIR = \"/tmp/logs\"\n"
+          "\n"
+          "[host0]\n"
+          "SOCKET_ID=host0\n"
+          "HOST_STATE=/xyz/openbmc_project/state/host0\n"
+          "\n"
+          "[ host1 ]\n"
+          "SOCKET_ID=host1\n"
+          "MODE=stream\n"
+          "MAX_FILES=7\n");
+
+    const ConfigFile config(path);
+    ASSERT_EQ(config.consoles().size(), 2);
+    EXPECT_EQ(config.name(0), "host0");
+    EXPECT_EQ(config.name(1), "host1");
+
+    const Config& host0 = config.consoles()[0];
+    EXPECT_STREQ(host0.socketId, "host0");
+    EXPECT_EQ(host0.mode, Mode::bufferMode);
+    EXPECT_STREQ(host0.outDir, "/tmp/logs");
+    EXPECT_STREQ(host0.hostState, "/xyz/openbmc_project/state/host0");
+    EXPECT_EQ(host0.maxFiles, 5);
+
+    const Config& host1 = config.consoles()[1];
+    EXPECT_STREQ(host1.socketId, "host1");
+    EXPECT_EQ(host1.mode, Mode::streamMode);
+    EXPECT_EQ(host1.maxFiles, 10); // Buffer parameters are not used
+}
+
+TEST_F(ConfigFileTest, Override)
+{
+    write("BUF_MAXSIZE=100\n"
+          "[host0]\n"
+          "SOCKET_ID=host0\n"
+          "[host1]\n"
+          "SOCKET_ID=host1\n"
+          "BUF_MAXSIZE=200\n");
+
+    const ConfigFile config(path);
+    ASSERT_EQ(config.consoles().size(), 2);
+    EXPECT_EQ(config.consoles()[0].bufMaxSize, 100);
+    EXPECT_EQ(config.consoles()[1].bufMaxSize, 200);
+}
+
+TEST_F(ConfigFileTest, NoFile)
+{
+    EXPECT_THROW(ConfigFile("/tmp/hostlogger_no_such_file.conf"),
+                 std::system_error);
+}
+
+TEST_F(ConfigFileTest, NoSections)
+{
+    write("SOCKET_ID=host0\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+}
+
+TEST_F(ConfigFileTest, InvalidFormat)
+{
+    write("[host0]\nSOCKET_ID\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+    write("[host0\nSOCKET_ID=host0\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+    write("[]\nSOCKET_ID=host0\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+}
+
+TEST_F(ConfigFileTest, Duplicates)
+{
+    write("[host0]\nSOCKET_ID=host0\n[host0]\nSOCKET_ID=host1\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+    write("[host0]\nSOCKET_ID=host0\n[host1]\nSOCKET_ID=host0\n");
+    EXPECT_THROW(ConfigFile config(path), std::invalid_argument);
+}
+
+TEST_F(ConfigFileTest, InvalidParameter)
+{
+    write("[host0]\nSOCKET_ID=host0\n[host1]\nSOCKET_ID=host1\nMODE=x\n");
+    try
+    {
+        ConfigFile config(path);
+        FAIL() << "Exception expected";
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        EXPECT_EQ(std::string(ex.what()).find("Section [host1]: "), 0);
+    }
+}
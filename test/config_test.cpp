@@ -12,11 +12,35 @@ static const char* SOCKET_ID = "SOCKET_ID";
 static const char* MODE = "MODE";
 static const char* BUF_MAXSIZE = "BUF_MAXSIZE";
 static const char* BUF_MAXTIME = "BUF_MAXTIME";
+static const char* BUF_MAXBYTES = "BUF_MAXBYTES";
+static const char* BUF_MAXLINE = "BUF_MAXLINE";
+static const char* BUF_RING_DIR = "BUF_RING_DIR";
 static const char* FLUSH_FULL = "FLUSH_FULL";
 static const char* HOST_STATE = "HOST_STATE";
 static const char* OUT_DIR = "OUT_DIR";
 static const char* MAX_FILES = "MAX_FILES";
+static const char* MAX_BYTES = "MAX_BYTES";
+static const char* STAGE_DIR = "STAGE_DIR";
+static const char* STAGE_INTERVAL = "STAGE_INTERVAL";
+static const char* STAGE_BYTES = "STAGE_BYTES";
+static const char* FLUSH_ASYNC = "FLUSH_ASYNC";
+static const char* FLUSH_QUEUE = "FLUSH_QUEUE";
+static const char* FLUSH_INCREMENTAL = "FLUSH_INCREMENTAL";
+static const char* SYNC_INTERVAL = "SYNC_INTERVAL";
+static const char* COMPRESSION = "COMPRESSION";
+static const char* COMPRESSION_LEVEL = "COMPRESSION_LEVEL";
+static const char* SAVE_THREADS = "SAVE_THREADS";
+static const char* BLOCK_SIZE = "BLOCK_SIZE";
+static const char* READ_MAXSIZE = "READ_MAXSIZE";
 static const char* STREAM_DST = "STREAM_DST";
+static const char* STREAM_PACK = "STREAM_PACK";
+static const char* STREAM_DATAGRAM_SIZE = "STREAM_DATAGRAM_SIZE";
+static const char* STREAM_TIMEOUT = "STREAM_TIMEOUT";
+static const char* STREAM_BACKLOG = "STREAM_BACKLOG";
+static const char* STREAM_OVERFLOW = "STREAM_OVERFLOW";
+static const char* STREAM_SPOOL = "STREAM_SPOOL";
+static const char* STREAM_SPOOL_SIZE = "STREAM_SPOOL_SIZE";
+static const char* STREAM_REPLAY_RATE = "STREAM_REPLAY_RATE";
 
 /**
  * @class ConfigTest
@@ -42,11 +66,35 @@ class ConfigTest : public ::testing::Test
         unsetenv(MODE);
         unsetenv(BUF_MAXSIZE);
         unsetenv(BUF_MAXTIME);
+        unsetenv(BUF_MAXBYTES);
+        unsetenv(BUF_MAXLINE);
+        unsetenv(BUF_RING_DIR);
         unsetenv(FLUSH_FULL);
         unsetenv(HOST_STATE);
         unsetenv(OUT_DIR);
         unsetenv(MAX_FILES);
+        unsetenv(MAX_BYTES);
+        unsetenv(STAGE_DIR);
+        unsetenv(STAGE_INTERVAL);
+        unsetenv(STAGE_BYTES);
+        unsetenv(FLUSH_ASYNC);
+        unsetenv(FLUSH_QUEUE);
+        unsetenv(FLUSH_INCREMENTAL);
+        unsetenv(SYNC_INTERVAL);
+        unsetenv(COMPRESSION);
+        unsetenv(COMPRESSION_LEVEL);
+        unsetenv(SAVE_THREADS);
+        unsetenv(BLOCK_SIZE);
+        unsetenv(READ_MAXSIZE);
         unsetenv(STREAM_DST);
+        unsetenv(STREAM_PACK);
+        unsetenv(STREAM_DATAGRAM_SIZE);
+        unsetenv(STREAM_TIMEOUT);
+        unsetenv(STREAM_BACKLOG);
+        unsetenv(STREAM_OVERFLOW);
+        unsetenv(STREAM_SPOOL);
+        unsetenv(STREAM_SPOOL_SIZE);
+        unsetenv(STREAM_REPLAY_RATE);
     }
 };
 
@@ -57,11 +105,35 @@ TEST_F(ConfigTest, Defaults)
     EXPECT_EQ(cfg.mode, Mode::bufferMode);
     EXPECT_EQ(cfg.bufMaxSize, 3000);
     EXPECT_EQ(cfg.bufMaxTime, 0);
+    EXPECT_EQ(cfg.bufMaxBytes, 0);
+    EXPECT_EQ(cfg.bufMaxLine, 65536);
+    EXPECT_STREQ(cfg.bufRingDir, "");
     EXPECT_EQ(cfg.bufFlushFull, false);
     EXPECT_STREQ(cfg.hostState, "/xyz/openbmc_project/state/host0");
     EXPECT_STREQ(cfg.outDir, "/var/lib/obmc/hostlogs");
     EXPECT_EQ(cfg.maxFiles, 10);
+    EXPECT_EQ(cfg.maxBytes, 0);
+    EXPECT_STREQ(cfg.stageDir, "");
+    EXPECT_EQ(cfg.stageInterval, 600);
+    EXPECT_EQ(cfg.stageBytes, 1024 * 1024);
+    EXPECT_EQ(cfg.flushAsync, false);
+    EXPECT_EQ(cfg.flushQueue, 2);
+    EXPECT_EQ(cfg.flushIncremental, false);
+    EXPECT_EQ(cfg.syncInterval, 10);
+    EXPECT_EQ(cfg.compression, Compression::zlib);
+    EXPECT_EQ(cfg.compressionLevel, 0);
+    EXPECT_EQ(cfg.saveThreads, 1);
+    EXPECT_EQ(cfg.blockSize, 0);
+    EXPECT_EQ(cfg.readMaxSize, 65536);
     EXPECT_STREQ(cfg.streamDestination, "/run/rsyslog/console_input");
+    EXPECT_EQ(cfg.streamPack, true);
+    EXPECT_EQ(cfg.streamDatagramSize, 1024);
+    EXPECT_EQ(cfg.streamTimeout, 100);
+    EXPECT_EQ(cfg.streamBacklog, 256 * 1024);
+    EXPECT_EQ(cfg.streamOverflow, Overflow::dropOldest);
+    EXPECT_STREQ(cfg.streamSpool, "");
+    EXPECT_EQ(cfg.streamSpoolSize, 1024 * 1024);
+    EXPECT_EQ(cfg.streamReplayRate, 64 * 1024);
 }
 
 TEST_F(ConfigTest, LoadInBufferMode)
@@ -70,42 +142,106 @@ TEST_F(ConfigTest, LoadInBufferMode)
     setenv(MODE, "buffer", 1);
     setenv(BUF_MAXSIZE, "1234", 1);
     setenv(BUF_MAXTIME, "4321", 1);
+    setenv(BUF_MAXBYTES, "65536", 1);
+    setenv(BUF_MAXLINE, "1024", 1);
+    setenv(BUF_RING_DIR, "/run/test", 1);
     setenv(FLUSH_FULL, "true", 1);
     setenv(HOST_STATE, "host123", 1);
     setenv(OUT_DIR, "path123", 1);
     setenv(MAX_FILES, "1122", 1);
+    setenv(MAX_BYTES, "1048576", 1);
+    setenv(STAGE_DIR, "/run/stage", 1);
+    setenv(STAGE_INTERVAL, "60", 1);
+    setenv(STAGE_BYTES, "4096", 1);
+    setenv(FLUSH_ASYNC, "true", 1);
+    setenv(FLUSH_QUEUE, "5", 1);
+    setenv(SYNC_INTERVAL, "60", 1);
+    setenv(COMPRESSION, "none", 1);
+    setenv(COMPRESSION_LEVEL, "5", 1);
+    setenv(SAVE_THREADS, "4", 1);
+    setenv(READ_MAXSIZE, "4096", 1);
 
     Config cfg;
     EXPECT_STREQ(cfg.socketId, "id123");
     EXPECT_EQ(cfg.mode, Mode::bufferMode);
     EXPECT_EQ(cfg.bufMaxSize, 1234);
     EXPECT_EQ(cfg.bufMaxTime, 4321);
+    EXPECT_EQ(cfg.bufMaxBytes, 65536);
+    EXPECT_EQ(cfg.bufMaxLine, 1024);
+    EXPECT_STREQ(cfg.bufRingDir, "/run/test");
     EXPECT_EQ(cfg.bufFlushFull, true);
     EXPECT_STREQ(cfg.hostState, "host123");
     EXPECT_STREQ(cfg.outDir, "path123");
     EXPECT_EQ(cfg.maxFiles, 1122);
+    EXPECT_EQ(cfg.maxBytes, 1048576);
+    EXPECT_STREQ(cfg.stageDir, "/run/stage");
+    EXPECT_EQ(cfg.stageInterval, 60);
+    EXPECT_EQ(cfg.stageBytes, 4096);
+    EXPECT_EQ(cfg.flushAsync, true);
+    EXPECT_EQ(cfg.flushQueue, 5);
+    EXPECT_EQ(cfg.syncInterval, 60);
+    EXPECT_EQ(cfg.compression, Compression::none);
+    EXPECT_EQ(cfg.compressionLevel, 5);
+    EXPECT_EQ(cfg.saveThreads, 4);
+    EXPECT_EQ(cfg.readMaxSize, 4096);
     // This should be default.
     EXPECT_STREQ(cfg.streamDestination, "/run/rsyslog/console_input");
 }
 
+TEST_F(ConfigTest, IncrementalFlushFull)
+{
+    // Incremental mode always flushes the buffer as it fills
+    setenv(FLUSH_INCREMENTAL, "true", 1);
+    setenv(FLUSH_FULL, "false", 1);
+    setenv(BUF_MAXSIZE, "1234", 1);
+    Config cfg;
+    EXPECT_EQ(cfg.flushIncremental, true);
+    EXPECT_EQ(cfg.bufFlushFull, true);
+}
+
 TEST_F(ConfigTest, LoadInStreamMode)
 {
     setenv(SOCKET_ID, "id123", 1);
     setenv(MODE, "stream", 1);
     setenv(STREAM_DST, "path123", 1);
+    setenv(STREAM_PACK, "false", 1);
+    setenv(STREAM_DATAGRAM_SIZE, "512", 1);
+    setenv(STREAM_TIMEOUT, "0", 1);
+    setenv(STREAM_BACKLOG, "1000", 1);
+    setenv(STREAM_OVERFLOW, "drop-newest", 1);
+    setenv(STREAM_SPOOL, "spool123", 1);
+    setenv(STREAM_SPOOL_SIZE, "2000", 1);
+    setenv(STREAM_REPLAY_RATE, "3000", 1);
+    setenv(READ_MAXSIZE, "4096", 1);
 
     Config cfg;
     EXPECT_STREQ(cfg.socketId, "id123");
     EXPECT_EQ(cfg.mode, Mode::streamMode);
+    EXPECT_EQ(cfg.readMaxSize, 4096);
     EXPECT_STREQ(cfg.streamDestination, "path123");
+    EXPECT_EQ(cfg.streamPack, false);
+    EXPECT_EQ(cfg.streamDatagramSize, 512);
+    EXPECT_EQ(cfg.streamTimeout, 0);
+    EXPECT_EQ(cfg.streamBacklog, 1000);
+    EXPECT_EQ(cfg.streamOverflow, Overflow::dropNewest);
+    EXPECT_STREQ(cfg.streamSpool, "spool123");
+    EXPECT_EQ(cfg.streamSpoolSize, 2000);
+    EXPECT_EQ(cfg.streamReplayRate, 3000);
 
     // These should be default.
     EXPECT_EQ(cfg.bufMaxSize, 3000);
     EXPECT_EQ(cfg.bufMaxTime, 0);
+    EXPECT_EQ(cfg.bufMaxBytes, 0);
+    EXPECT_EQ(cfg.bufMaxLine, 65536);
+    EXPECT_STREQ(cfg.bufRingDir, "");
     EXPECT_EQ(cfg.bufFlushFull, false);
     EXPECT_STREQ(cfg.hostState, "/xyz/openbmc_project/state/host0");
     EXPECT_STREQ(cfg.outDir, "/var/lib/obmc/hostlogs");
     EXPECT_EQ(cfg.maxFiles, 10);
+    EXPECT_EQ(cfg.maxBytes, 0);
+    EXPECT_STREQ(cfg.stageDir, "");
+    EXPECT_EQ(cfg.stageInterval, 600);
+    EXPECT_EQ(cfg.stageBytes, 1024 * 1024);
 }
 
 TEST_F(ConfigTest, InvalidNumeric)
@@ -130,6 +266,60 @@ TEST_F(ConfigTest, Mode)
     EXPECT_EQ(Config().mode, Mode::streamMode);
     setenv(MODE, "buffer", 1);
     EXPECT_EQ(Config().mode, Mode::bufferMode);
+    setenv(MODE, "both", 1);
+    EXPECT_EQ(Config().mode, Mode::bothMode);
+}
+
+TEST_F(ConfigTest, LoadInBothMode)
+{
+    setenv(MODE, "both", 1);
+    setenv(BUF_MAXSIZE, "1234", 1);
+    setenv(STREAM_DST, "path123", 1);
+
+    Config cfg;
+    EXPECT_EQ(cfg.mode, Mode::bothMode);
+    EXPECT_EQ(cfg.bufMaxSize, 1234);
+    EXPECT_STREQ(cfg.streamDestination, "path123");
+
+    // Parameters of both modes are validated
+    setenv(STREAM_REPLAY_RATE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+    unsetenv(STREAM_REPLAY_RATE);
+    setenv(FLUSH_QUEUE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+}
+
+TEST_F(ConfigTest, Compression)
+{
+    setenv(COMPRESSION, "invalid", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    setenv(COMPRESSION, "zlib", 1);
+    setenv(COMPRESSION_LEVEL, "9", 1);
+    EXPECT_EQ(Config().compression, Compression::zlib);
+    setenv(COMPRESSION_LEVEL, "10", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    // Seekable blocks are written by the gzip writer only
+    unsetenv(COMPRESSION_LEVEL);
+    setenv(BLOCK_SIZE, "65536", 1);
+    EXPECT_EQ(Config().blockSize, 65536);
+    setenv(COMPRESSION, "none", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+    unsetenv(BLOCK_SIZE);
+
+    setenv(COMPRESSION, "zstd", 1);
+#ifdef HAVE_ZSTD
+    EXPECT_EQ(Config().compression, Compression::zstd);
+#else
+    EXPECT_THROW(Config(), std::invalid_argument);
+#endif
+    setenv(COMPRESSION, "lz4", 1);
+#ifdef HAVE_LZ4
+    EXPECT_EQ(Config().compression, Compression::lz4);
+#else
+    EXPECT_THROW(Config(), std::invalid_argument);
+#endif
 }
 
 TEST_F(ConfigTest, InvalidBufferModeConfig)
@@ -138,6 +328,37 @@ TEST_F(ConfigTest, InvalidBufferModeConfig)
     setenv(BUF_MAXTIME, "0", 1);
     setenv(FLUSH_FULL, "true", 1);
     EXPECT_THROW(Config(), std::invalid_argument);
+    setenv(BUF_MAXBYTES, "65536", 1);
+    EXPECT_NO_THROW(Config());
+
+    resetEnv();
+    setenv(BUF_RING_DIR, "/run/test", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+    setenv(BUF_MAXBYTES, "65536", 1);
+    setenv(BUF_RING_DIR, "relative", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(STAGE_DIR, "relative", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(FLUSH_QUEUE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(SAVE_THREADS, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(READ_MAXSIZE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(FLUSH_INCREMENTAL, "true", 1);
+    EXPECT_NO_THROW(Config());
+    setenv(FLUSH_ASYNC, "true", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
 }
 
 TEST_F(ConfigTest, InvalidStreamModeConfig)
@@ -146,4 +367,19 @@ TEST_F(ConfigTest, InvalidStreamModeConfig)
     setenv(MODE, "stream", 1);
     setenv(STREAM_DST, tooLong.c_str(), 1);
     EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(MODE, "stream", 1);
+    setenv(STREAM_OVERFLOW, "invalid", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(MODE, "stream", 1);
+    setenv(STREAM_DATAGRAM_SIZE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
+
+    resetEnv();
+    setenv(MODE, "stream", 1);
+    setenv(STREAM_REPLAY_RATE, "0", 1);
+    EXPECT_THROW(Config(), std::invalid_argument);
 }
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "console_reader.hpp"
+#include "host_console_mock.hpp"
+
+#include <string>
+#include <system_error>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Eq;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::SetArrayArgument;
+using ::testing::Throw;
+
+/**
+ * @class ConsoleReaderTest
+ * @brief Console reader tests.
+ */
+class ConsoleReaderTest : public ::testing::Test
+{
+  protected:
+    /** @brief Read all chunks of a single IO event. */
+    std::string readEvent(ConsoleReader& reader)
+    {
+        std::string data;
+        std::string_view chunk;
+        while (!(chunk = reader.read()).empty())
+        {
+            data += chunk;
+        }
+        return data;
+    }
+
+    HostConsoleMock console;
+};
+
+TEST_F(ConsoleReaderTest, KnownSize)
+{
+    const std::string data(1000, 'a');
+    ConsoleReader reader(console, 64 * 1024);
+
+    InSequence sequence;
+    EXPECT_CALL(console, pending()).WillOnce(Return(data.size()));
+    EXPECT_CALL(console, read(_, Eq(data.size())))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.end()),
+                        Return(data.size())));
+
+    EXPECT_EQ(readEvent(reader), data);
+    EXPECT_EQ(reader.capacity(), 1024);
+    EXPECT_EQ(reader.stats().syscalls, 2);
+    EXPECT_EQ(reader.stats().reads, 1);
+    EXPECT_EQ(reader.stats().bytes, data.size());
+}
+
+TEST_F(ConsoleReaderTest, MaxSize)
+{
+    const std::string data(1000, 'b');
+    ConsoleReader reader(console, 256);
+
+    InSequence sequence;
+    EXPECT_CALL(console, pending()).WillOnce(Return(data.size()));
+    EXPECT_CALL(console, read(_, Eq(256)))
+        .Times(3)
+        .WillRepeatedly(
+            DoAll(SetArrayArgument<0>(data.begin(), data.begin() + 256),
+                  Return(256)));
+    EXPECT_CALL(console, read(_, Eq(1000 - 3 * 256)))
+        .WillOnce(
+            DoAll(SetArrayArgument<0>(data.begin() + 3 * 256, data.end()),
+                  Return(1000 - 3 * 256)));
+
+    EXPECT_EQ(readEvent(reader), data);
+    EXPECT_EQ(reader.capacity(), 256);
+    EXPECT_EQ(reader.stats().syscalls, 5);
+}
+
+TEST_F(ConsoleReaderTest, UnknownSize)
+{
+    const std::string data(128 + 256 + 10, 'c');
+    ConsoleReader reader(console, 64 * 1024);
+
+    InSequence sequence;
+    EXPECT_CALL(console, pending()).WillOnce(Return(std::nullopt));
+    EXPECT_CALL(console, read(_, Eq(128)))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.begin() + 128),
+                        Return(128)));
+    EXPECT_CALL(console, read(_, Eq(256)))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.begin() + 256),
+                        Return(256)));
+    EXPECT_CALL(console, read(_, Eq(512)))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.begin() + 10),
+                        Return(10)))
+        .WillOnce(Return(0));
+
+    EXPECT_EQ(readEvent(reader), data);
+    EXPECT_EQ(reader.capacity(), 512);
+    EXPECT_EQ(reader.stats().syscalls, 5);
+    EXPECT_EQ(reader.stats().reads, 4);
+}
+
+TEST_F(ConsoleReaderTest, Shrink)
+{
+    const std::string data(4000, 'd');
+    ConsoleReader reader(console, 64 * 1024);
+
+    EXPECT_CALL(console, pending())
+        .WillOnce(Return(data.size()))
+        .WillRepeatedly(Return(10));
+    EXPECT_CALL(console, read(_, _))
+        .WillRepeatedly([](char*, size_t sz) { return sz; });
+
+    EXPECT_EQ(readEvent(reader).size(), data.size());
+    EXPECT_EQ(reader.capacity(), 4096);
+
+    // The first period has a large burst, the buffer is kept
+    for (size_t i = 0; i < 255; ++i)
+    {
+        EXPECT_EQ(readEvent(reader).size(), 10);
+    }
+    EXPECT_EQ(reader.capacity(), 4096);
+
+    // The next period has only small bursts
+    for (size_t i = 0; i < 256; ++i)
+    {
+        EXPECT_EQ(readEvent(reader).size(), 10);
+    }
+    EXPECT_EQ(reader.capacity(), 128);
+}
+
+TEST_F(ConsoleReaderTest, Error)
+{
+    const std::string data(10, 'e');
+    ConsoleReader reader(console, 64 * 1024);
+
+    InSequence sequence;
+    EXPECT_CALL(console, pending()).WillOnce(Return(data.size()));
+    EXPECT_CALL(console, read(_, _))
+        .WillOnce(Throw(std::system_error(std::error_code(), "Mock error")));
+    EXPECT_THROW(reader.read(), std::system_error);
+
+    // Next IO event starts from the queue size check
+    EXPECT_CALL(console, pending()).WillOnce(Return(data.size()));
+    EXPECT_CALL(console, read(_, Eq(data.size())))
+        .WillOnce(DoAll(SetArrayArgument<0>(data.begin(), data.end()),
+                        Return(data.size())));
+    EXPECT_EQ(readEvent(reader), data);
+}
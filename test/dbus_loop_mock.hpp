@@ -13,10 +13,23 @@ class DbusLoopMock : public DbusLoop
     MOCK_METHOD(int, run, (), (const, override));
     MOCK_METHOD(void, addIoHandler, (int fd, std::function<void()> callback),
                 (override));
+    MOCK_METHOD(void, addOutputHandler,
+                (int fd, std::function<void()> callback), (override));
+    MOCK_METHOD(void, enableOutputHandler, (int fd, bool enable), (override));
     MOCK_METHOD(void, addSignalHandler,
                 (int signal, std::function<void()> callback), (override));
     MOCK_METHOD(void, addPropertyHandler,
                 (const std::string& objPath, const WatchProperties& props,
                  std::function<void()> callback),
                 (override));
+    MOCK_METHOD(void, requestName, (const std::string& name), (override));
+    MOCK_METHOD(void, addObject,
+                (const std::string& objPath, const std::string& interface,
+                 const Methods& methods),
+                (override));
+    MOCK_METHOD(size_t, addTimerHandler,
+                (uint64_t interval, std::function<void()> callback),
+                (override));
+    MOCK_METHOD(void, enableTimerHandler, (size_t timer, bool enable),
+                (override));
 };
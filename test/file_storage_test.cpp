@@ -3,6 +3,9 @@
 
 #include "file_storage.hpp"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <fstream>
 
 #include <gtest/gtest.h>
@@ -28,6 +31,7 @@ class FileStorageTest : public ::testing::Test
 
     const fs::path logPath =
         fs::temp_directory_path() / "file_storage_test_out";
+    const fs::path stagePath = logPath / "stage";
 };
 
 TEST_F(FileStorageTest, InvalidPath)
@@ -54,6 +58,38 @@ TEST_F(FileStorageTest, Save)
     EXPECT_NE(fs::file_size(file), 0);
 }
 
+TEST_F(FileStorageTest, Snapshot)
+{
+    const char* data = "first message\nsecond message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    const int fd = FileStorage::snapshot(buf);
+    ASSERT_NE(fd, -1);
+    EXPECT_EQ(fcntl(fd, F_GET_SEALS),
+              F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    EXPECT_EQ(write(fd, "x", 1), -1);
+
+    // Same text as in a saved file, read from the start
+    char text[256];
+    const ssize_t len = read(fd, text, sizeof(text));
+    close(fd);
+    ASSERT_GT(len, 0);
+    const std::string content(text, len);
+    EXPECT_NE(content.find(">>> Log collection started at "),
+              std::string::npos);
+    EXPECT_NE(content.find(" first message\n"), std::string::npos);
+    EXPECT_NE(content.find(" second message\n"), std::string::npos);
+    EXPECT_FALSE(fs::exists(logPath));
+
+    // Empty buffer gives an empty file
+    buf.clear();
+    const int empty = FileStorage::snapshot(buf);
+    ASSERT_NE(empty, -1);
+    EXPECT_EQ(lseek(empty, 0, SEEK_END), 0);
+    close(empty);
+}
+
 TEST_F(FileStorageTest, Rotation)
 {
     const size_t limit = 5;
@@ -90,3 +126,220 @@ TEST_F(FileStorageTest, Rotation)
         EXPECT_TRUE(fs::exists(i));
     }
 }
+
+TEST_F(FileStorageTest, Compression)
+{
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    // Files of other algorithms are rotated together with the current ones
+    fs::create_directories(logPath);
+    std::ofstream(logPath / "host_11111111_000001.log.zst") << "old";
+    std::ofstream(logPath / "host_11111111_000002.log") << "old";
+    std::ofstream(logPath / "host_11111111_000003.log.lz4") << "old";
+
+    FileStorage fs(logPath, "", 2, Compression::none);
+    const std::string fileName = fs.save(buf);
+    EXPECT_EQ(fs::path(fileName).extension(), ".log");
+    EXPECT_EQ(std::distance(fs::directory_iterator(logPath),
+                            fs::directory_iterator{}),
+              2);
+    EXPECT_TRUE(fs::exists(logPath / "host_11111111_000003.log.lz4"));
+    EXPECT_TRUE(fs::exists(fileName));
+}
+
+TEST_F(FileStorageTest, Index)
+{
+    fs::create_directories(logPath);
+    std::ofstream(logPath / "host_11111111_000001.log.gz") << "old";
+
+    LogBuffer buf(0, 0);
+    buf.append("first\n", 6);
+    buf.append("second\n", 7);
+
+    FileStorage fs(logPath, "", 3, Compression::none);
+    const std::string fileName = fs.save(buf);
+    const std::string dupName = fs.save(buf);
+    EXPECT_NE(fileName, dupName);
+
+    const auto files = fs.files();
+    ASSERT_EQ(files.size(), 3);
+    auto it = files.begin();
+    EXPECT_EQ(it->first, "host_11111111_000001.log.gz");
+    EXPECT_EQ(it->second.size, 3);
+    EXPECT_EQ(it->second.first.tv_sec, 0);
+    EXPECT_NE(it->second.last.tv_sec, 0);
+    ++it;
+    EXPECT_EQ(logPath / it->first, fileName);
+    EXPECT_EQ(it->second.size, fs::file_size(fileName));
+    EXPECT_EQ(it->second.first.tv_sec, buf.begin()->timeStamp.tv_sec);
+    EXPECT_EQ(it->second.first.tv_nsec, buf.begin()->timeStamp.tv_nsec);
+
+    // Files removed by others are dropped from the index on rotation
+    fs::remove(logPath / "host_11111111_000001.log.gz");
+    fs.save(buf);
+    EXPECT_EQ(fs.files().size(), 3);
+    EXPECT_FALSE(fs.files().contains("host_11111111_000001.log.gz"));
+
+    // Files added by others are not known until restart
+    std::ofstream(logPath / "host_11111111_000002.log.gz") << "old";
+    fs.save(buf);
+    EXPECT_EQ(fs.files().size(), 3);
+    EXPECT_TRUE(fs::exists(logPath / "host_11111111_000002.log.gz"));
+    EXPECT_EQ(FileStorage(logPath, "", 0).files().size(), 4);
+}
+
+TEST_F(FileStorageTest, Commit)
+{
+    fs::create_directories(logPath);
+    const fs::path temp = logPath / "temp";
+    std::ofstream(temp) << "data";
+
+    FileStorage fs(logPath, "", 0);
+    const timespec first{100, 1}, last{200, 2};
+    const std::string fileName = fs.commit(temp, first, last);
+    EXPECT_FALSE(fs::exists(temp));
+
+    const auto files = fs.files();
+    ASSERT_EQ(files.size(), 1);
+    EXPECT_EQ(logPath / files.begin()->first, fileName);
+    EXPECT_EQ(files.begin()->second.size, 4);
+    EXPECT_EQ(files.begin()->second.first.tv_sec, 100);
+    EXPECT_EQ(files.begin()->second.last.tv_sec, 200);
+
+    // Failed commit doesn't leave the name in the index
+    EXPECT_THROW(fs.commit(temp), fs::filesystem_error);
+    EXPECT_EQ(fs.files().size(), 1);
+}
+
+TEST_F(FileStorageTest, MaxBytes)
+{
+    fs::create_directories(logPath);
+    const std::string old(100, 'o');
+    std::ofstream(logPath / "host_11111111_000001.log") << old;
+    std::ofstream(logPath / "host_11111111_000002.log") << old;
+
+    LogBuffer buf(0, 0);
+    const std::string msg(50, 'x');
+    for (size_t i = 0; i < 4; ++i)
+    {
+        buf.append(msg.data(), msg.size());
+        buf.append("\n", 1);
+    }
+
+    FileStorage fs(logPath, "", 0, Compression::none, 0, 1, 600);
+    EXPECT_EQ(fs.usage(), 200);
+
+    // The oldest files are removed until the new one fits
+    const std::string fileName = fs.save(buf);
+    const uintmax_t size = fs::file_size(fileName);
+    ASSERT_GT(size, 400);
+    ASSERT_LT(size, 500);
+    EXPECT_EQ(fs.usage(), size + 100);
+    EXPECT_FALSE(fs::exists(logPath / "host_11111111_000001.log"));
+    EXPECT_TRUE(fs::exists(logPath / "host_11111111_000002.log"));
+
+    // The newest file is kept even if it exceeds the limit alone
+    for (size_t i = 0; i < 4; ++i)
+    {
+        buf.append(msg.data(), msg.size());
+        buf.append("\n", 1);
+    }
+    const std::string bigName = fs.save(buf);
+    ASSERT_GT(fs::file_size(bigName), 600);
+    ASSERT_EQ(fs.files().size(), 1);
+    EXPECT_EQ(fs.usage(), fs::file_size(bigName));
+    EXPECT_FALSE(fs::exists(fileName));
+}
+
+TEST_F(FileStorageTest, Staging)
+{
+    LogBuffer buf(0, 0);
+    buf.append("test message\n", 13);
+
+    FileStorage fs(logPath, "", 2, Compression::none);
+    EXPECT_EQ(fs.setStaging(stagePath, 0), 0);
+    EXPECT_EQ(fs.tempFile(), stagePath / ".host.log.part");
+
+    // Files are written to the staging directory, staged files are not
+    // rotated until they are committed
+    std::string fileNames[3];
+    for (std::string& fileName : fileNames)
+    {
+        fileName = fs.save(buf);
+        EXPECT_EQ(fs::path(fileName).parent_path(), stagePath);
+    }
+    EXPECT_TRUE(fs::exists(fileNames[0]));
+    EXPECT_FALSE(fs.stageFull());
+    auto files = fs.files();
+    ASSERT_EQ(files.size(), 3);
+    EXPECT_TRUE(files.begin()->second.staged);
+
+    EXPECT_EQ(fs.commitStaged(), 3);
+    EXPECT_EQ(fs.commitStaged(), 0);
+    EXPECT_TRUE(fs::is_empty(stagePath));
+    files = fs.files();
+    ASSERT_EQ(files.size(), 2);
+    for (const auto& [name, info] : files)
+    {
+        EXPECT_FALSE(info.staged);
+        EXPECT_EQ(fs::file_size(logPath / name), info.size);
+    }
+    EXPECT_FALSE(fs::exists(logPath / fs::path(fileNames[0]).filename()));
+    EXPECT_TRUE(fs::exists(logPath / fs::path(fileNames[2]).filename()));
+    EXPECT_EQ(std::distance(fs::directory_iterator(logPath),
+                            fs::directory_iterator{}),
+              3 /*two files and staging dir*/);
+}
+
+TEST_F(FileStorageTest, StagingBatch)
+{
+    LogBuffer buf(0, 0);
+    buf.append("test message\n", 13);
+
+    FileStorage fs(logPath, "", 0, Compression::none);
+    fs.setStaging(stagePath, 1);
+    EXPECT_FALSE(fs.stageFull());
+    fs.save(buf);
+    EXPECT_TRUE(fs.stageFull());
+    EXPECT_EQ(fs.commitStaged(), 1);
+    EXPECT_FALSE(fs.stageFull());
+}
+
+TEST_F(FileStorageTest, StagingCommitFile)
+{
+    LogBuffer buf(0, 0);
+    buf.append("test message\n", 13);
+
+    FileStorage fs(logPath, "", 0, Compression::none);
+    fs.setStaging(stagePath, 0);
+    const std::string fileName = fs.save(buf);
+    const std::string committed = fs.commitFile(fileName);
+    EXPECT_EQ(committed, logPath / fs::path(fileName).filename());
+    EXPECT_TRUE(fs::exists(committed));
+    EXPECT_EQ(fs.commitFile(""), "");
+
+    // Unknown file is not committed
+    EXPECT_THROW(fs.commitFile(stagePath / "unknown.log"), std::runtime_error);
+}
+
+TEST_F(FileStorageTest, StagingRecovery)
+{
+    // Files left by the previous instance and the interrupted commit
+    fs::create_directories(stagePath);
+    std::ofstream(stagePath / "host_11111111_000001.log") << "staged";
+    std::ofstream(logPath / ".host_11111111_000001.log.stage") << "sta";
+
+    FileStorage fs(logPath, "", 0, Compression::none);
+    EXPECT_EQ(fs.setStaging(stagePath, 0), 1);
+    EXPECT_FALSE(fs::exists(logPath / ".host_11111111_000001.log.stage"));
+    EXPECT_EQ(fs.usage(), 6);
+
+    EXPECT_EQ(fs.commitStaged(), 1);
+    std::ifstream file(logPath / "host_11111111_000001.log");
+    std::string content;
+    file >> content;
+    EXPECT_EQ(content, "staged");
+    EXPECT_EQ(fs.usage(), 6);
+}
@@ -0,0 +1,197 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "flush_worker.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+/**
+ * @class FlushWorkerTest
+ * @brief Background saver tests.
+ */
+class FlushWorkerTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fs::remove_all(logPath);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(logPath);
+    }
+
+    /** @brief Wait for results and collect them. */
+    std::vector<FlushWorker::Result> waitResults(FlushWorker& worker,
+                                                 size_t expect)
+    {
+        std::vector<FlushWorker::Result> results;
+        while (results.size() < expect)
+        {
+            pollfd pfd{worker, POLLIN, 0};
+            if (poll(&pfd, 1, 10000) <= 0)
+            {
+                break;
+            }
+            for (auto& res : worker.results())
+            {
+                results.push_back(std::move(res));
+            }
+        }
+        return results;
+    }
+
+    const fs::path logPath =
+        fs::temp_directory_path() / "flush_worker_test_out";
+};
+
+TEST_F(FlushWorkerTest, Save)
+{
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    FileStorage storage(logPath, "", 0);
+    FlushWorker worker(storage, 1);
+    worker.submit(buf);
+    EXPECT_TRUE(buf.empty());
+
+    // The buffer must be usable while the snapshot is being saved
+    buf.append(data, strlen(data));
+    EXPECT_FALSE(buf.empty());
+
+    const auto results = waitResults(worker, 1);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_TRUE(results[0].error.empty());
+    EXPECT_TRUE(fs::exists(results[0].fileName));
+}
+
+TEST_F(FlushWorkerTest, Commit)
+{
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    // The file is committed to the output directory with the snapshot
+    FileStorage storage(logPath, "", 0);
+    storage.setStaging(logPath / "stage", 1000000);
+    FlushWorker worker(storage, 1);
+    worker.submit(buf, true);
+
+    const auto results = waitResults(worker, 1);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_TRUE(results[0].error.empty());
+    EXPECT_EQ(fs::path(results[0].fileName).parent_path(), logPath);
+    EXPECT_TRUE(fs::exists(results[0].fileName));
+    EXPECT_TRUE(fs::is_empty(logPath / "stage"));
+}
+
+TEST_F(FlushWorkerTest, QueueOverflow)
+{
+    const size_t count = 10;
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+
+    // Snapshots are rejected without waiting if the queue is short, the
+    // buffer keeps the messages until the next submit
+    FileStorage storage(logPath, "", 0);
+    FlushWorker worker(storage, 1);
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        buf.append(data, strlen(data));
+        if (worker.submit(buf))
+        {
+            ++accepted;
+            EXPECT_TRUE(buf.empty());
+        }
+        else
+        {
+            EXPECT_FALSE(buf.empty());
+        }
+    }
+    EXPECT_GT(accepted, 0);
+    EXPECT_EQ(accepted + worker.rejected(), count);
+    std::vector<FlushWorker::Result> results;
+    while (!buf.empty())
+    {
+        if (worker.submit(buf))
+        {
+            ++accepted;
+        }
+        else
+        {
+            for (auto& res : waitResults(worker, 1))
+            {
+                results.push_back(std::move(res));
+            }
+        }
+    }
+    worker.stop();
+
+    for (auto& res : worker.results())
+    {
+        results.push_back(std::move(res));
+    }
+    ASSERT_EQ(results.size(), accepted);
+    for (const auto& res : results)
+    {
+        EXPECT_TRUE(res.error.empty());
+    }
+    EXPECT_EQ(std::distance(fs::directory_iterator(logPath),
+                            fs::directory_iterator{}),
+              accepted);
+}
+
+TEST_F(FlushWorkerTest, Error)
+{
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    FileStorage storage(logPath, "", 0);
+    FlushWorker worker(storage, 1);
+    fs::remove_all(logPath);
+    std::ofstream dummy(logPath); // file instead of directory
+    dummy.close();
+    worker.submit(buf);
+
+    const auto results = waitResults(worker, 1);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_FALSE(results[0].error.empty());
+    fs::remove(logPath);
+}
+
+TEST_F(FlushWorkerTest, Signal)
+{
+    const char* data = "test message\n";
+    LogBuffer buf(0, 0);
+    buf.append(data, strlen(data));
+
+    // The worker is started while the signal is not blocked yet
+    FileStorage storage(logPath, "", 0);
+    FlushWorker worker(storage, 1);
+    worker.submit(buf);
+    ASSERT_EQ(waitResults(worker, 1).size(), 1);
+
+    // The signal is left for the main thread, the default action of the
+    // worker would terminate the process
+    sigset_t ss;
+    sigemptyset(&ss);
+    sigaddset(&ss, SIGUSR1);
+    sigset_t old;
+    ASSERT_EQ(pthread_sigmask(SIG_BLOCK, &ss, &old), 0);
+    kill(getpid(), SIGUSR1);
+    const timespec timeout{5, 0};
+    EXPECT_EQ(sigtimedwait(&ss, nullptr, &timeout), SIGUSR1);
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+}
@@ -13,6 +13,7 @@ class HostConsoleMock : public HostConsole
     HostConsoleMock() : HostConsole("") {}
     MOCK_METHOD(void, connect, (), (override));
     MOCK_METHOD(size_t, read, (char* buf, size_t sz), (const, override));
+    MOCK_METHOD(std::optional<size_t>, pending, (), (const, override));
     // Returns a fixed integer for testing.
     virtual operator int() const override
     {
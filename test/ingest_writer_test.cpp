@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "ingest_writer.hpp"
+
+#include <zlib.h>
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+/**
+ * @class IngestWriterTest
+ * @brief Incremental log file writer tests.
+ */
+class IngestWriterTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fs::remove_all(logPath);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(logPath);
+    }
+
+    /** @brief Read decompressed file, time stamps are removed. */
+    static std::string readFile(const std::string& path)
+    {
+        std::string text;
+        gzFile fd = gzopen(path.c_str(), "r");
+        if (fd == Z_NULL)
+        {
+            return text;
+        }
+        char buf[256];
+        while (gzgets(fd, buf, sizeof(buf)))
+        {
+            const char* msg = strstr(buf, " ] ");
+            text += msg ? msg + 3 : buf;
+        }
+        gzclose(fd);
+        return text;
+    }
+
+    const fs::path logPath =
+        fs::temp_directory_path() / "ingest_writer_test_out";
+};
+
+TEST_F(IngestWriterTest, Finalize)
+{
+    FileStorage storage(logPath, "", 0);
+    IngestWriter writer(storage);
+    LogBuffer buf(0, 0);
+    buf.setMessageHandler(
+        [&writer](const LogBuffer::Message& msg) { writer.write(msg); });
+
+    // Nothing to save
+    EXPECT_TRUE(writer.finalize(buf).empty());
+
+    const char* data = "line 1\nline 2\nline";
+    buf.append(data, strlen(data));
+
+    // The file is readable up to the checkpoint
+    writer.sync();
+    const std::string partial = readFile(storage.tempFile());
+    EXPECT_NE(partial.find("line 1\nline 2\n"), std::string::npos);
+
+    buf.append(" 3\nline 4", 9);
+    const std::string fileName = writer.finalize(buf);
+    ASSERT_FALSE(fileName.empty());
+    EXPECT_FALSE(fs::exists(storage.tempFile()));
+    const std::string text = readFile(fileName);
+    EXPECT_EQ(text.substr(text.find('\n') + 1),
+              "line 1\nline 2\nline 3\nline 4\n");
+}
+
+TEST_F(IngestWriterTest, Recover)
+{
+    FileStorage storage(logPath, "", 0);
+    std::ofstream(storage.tempFile()) << "data";
+
+    IngestWriter writer(storage);
+    EXPECT_FALSE(fs::exists(storage.tempFile()));
+    EXPECT_EQ(std::distance(fs::directory_iterator(logPath),
+                            fs::directory_iterator{}),
+              1);
+}
+
+TEST_F(IngestWriterTest, Restored)
+{
+    FileStorage storage(logPath, "", 0);
+    std::ofstream(storage.tempFile()) << "data";
+
+    // Messages are restored to the buffer, the file is not committed
+    IngestWriter writer(storage, true);
+    EXPECT_FALSE(fs::exists(storage.tempFile()));
+    EXPECT_EQ(std::distance(fs::directory_iterator(logPath),
+                            fs::directory_iterator{}),
+              0);
+}
+
+TEST_F(IngestWriterTest, FallbackToSave)
+{
+    FileStorage storage(logPath, "", 0);
+    IngestWriter writer(storage);
+    LogBuffer buf(0, 0);
+    buf.setMessageHandler(
+        [&writer](const LogBuffer::Message& msg) { writer.write(msg); });
+
+    // Temporary file can't be created
+    fs::create_directory(storage.tempFile());
+    const char* data = "line 1\nline 2\n";
+    buf.append(data, strlen(data));
+    fs::remove(storage.tempFile());
+
+    const std::string fileName = writer.finalize(buf);
+    ASSERT_FALSE(fileName.empty());
+    const std::string text = readFile(fileName);
+    EXPECT_EQ(text.substr(text.find('\n') + 1), "line 1\nline 2\n");
+}
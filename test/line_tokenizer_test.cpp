@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "line_tokenizer.hpp"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+/** @brief Split chunks and collect parts as "text" or "text|" (with EOL). */
+static std::vector<std::string> split(const std::vector<std::string>& chunks)
+{
+    std::vector<std::string> parts;
+    LineTokenizer tokenizer;
+    for (const auto& chunk : chunks)
+    {
+        tokenizer.split(chunk.data(), chunk.size(),
+                        [&parts](const char* text, size_t len, bool eol) {
+                            parts.emplace_back(text, len);
+                            if (eol)
+                            {
+                                parts.back() += '|';
+                            }
+                        });
+    }
+    return parts;
+}
+
+TEST(LineTokenizerTest, FindEol)
+{
+    // Check all positions and alignments of EOL symbols
+    std::string data(100, 'x');
+    for (size_t len = 0; len < 70; ++len)
+    {
+        for (size_t shift = 0; shift < 17; ++shift)
+        {
+            const char* begin = data.data() + shift;
+            EXPECT_EQ(LineTokenizer::findEol(begin, begin + len), begin + len);
+            for (size_t pos = 0; pos < len; ++pos)
+            {
+                for (char eol : {'\r', '\n'})
+                {
+                    data[shift + pos] = eol;
+                    EXPECT_EQ(LineTokenizer::findEol(begin, begin + len),
+                              begin + pos);
+                    // Only the first one must be found
+                    data[shift + len - 1] = eol;
+                    EXPECT_EQ(LineTokenizer::findEol(begin, begin + len),
+                              begin + pos);
+                    data[shift + len - 1] = 'x';
+                    data[shift + pos] = 'x';
+                }
+            }
+        }
+    }
+}
+
+TEST(LineTokenizerTest, FindEolHighBytes)
+{
+    // Bytes that differ from EOL by the high bit only
+    const std::string data = "\x8d\x8a\xff\x80\x0b\x0c\x8d\x8a\x8d\x8a\n";
+    EXPECT_EQ(LineTokenizer::findEol(data.data(), data.data() + data.size()),
+              data.data() + data.size() - 1);
+}
+
+TEST(LineTokenizerTest, Split)
+{
+    using parts = std::vector<std::string>;
+    EXPECT_EQ(split({"abc"}), parts({"abc"}));
+    EXPECT_EQ(split({"abc\n"}), parts({"abc|"}));
+    EXPECT_EQ(split({"a\nb\r\nc\n\rd"}), parts({"a|", "b|", "c|", "d"}));
+    EXPECT_EQ(split({"\r\r\r\n\n\n"}), parts({"|", "|", "|", "|", "|"}));
+    EXPECT_EQ(split({"ab", "c\n"}), parts({"ab", "c|"}));
+}
+
+TEST(LineTokenizerTest, SplitEolBetweenChunks)
+{
+    using parts = std::vector<std::string>;
+    EXPECT_EQ(split({"abc\r", "\ndef"}), parts({"abc|", "def"}));
+    EXPECT_EQ(split({"abc\n", "\rdef"}), parts({"abc|", "def"}));
+    EXPECT_EQ(split({"abc\r", "", "\ndef"}), parts({"abc|", "def"}));
+    EXPECT_EQ(split({"abc\r", "\r"}), parts({"abc|", "|"}));
+    EXPECT_EQ(split({"abc\r", "\n", "\n"}), parts({"abc|", "|"}));
+    EXPECT_EQ(split({"abc\r", "x\n"}), parts({"abc|", "x|"}));
+}
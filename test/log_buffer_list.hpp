@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#pragma once
+
+#include <ctime>
+#include <list>
+#include <string>
+
+/**
+ * @class LogBufferList
+ * @brief Reference implementation of the log buffer based on std::list,
+ *        used for differential testing and benchmarking of LogBuffer.
+ */
+class LogBufferList
+{
+  public:
+    struct Message
+    {
+        time_t timeStamp;
+        std::string text;
+    };
+
+    using container_t = std::list<Message>;
+
+    LogBufferList(size_t maxSize, size_t maxTime) :
+        sizeLimit(maxSize), timeLimit(maxTime)
+    {}
+
+    void append(const char* data, size_t sz)
+    {
+        size_t pos = 0;
+        if (pendingEol && sz)
+        {
+            if (isEol(data[0]) && data[0] != pendingEol)
+            {
+                ++pos;
+            }
+            pendingEol = 0;
+        }
+        while (pos < sz)
+        {
+            size_t eol = pos;
+            while (eol < sz && !isEol(data[eol]))
+            {
+                ++eol;
+            }
+            const bool eolFound = eol < sz;
+            const char* msgText = data + pos;
+            const size_t msgLen = (eolFound ? eol : sz) - pos;
+
+            if (!lastComplete && !messages.empty())
+            {
+                messages.back().text.append(msgText, msgLen);
+            }
+            else
+            {
+                Message msg;
+                time(&msg.timeStamp);
+                msg.text.assign(msgText, msgLen);
+                messages.push_back(msg);
+            }
+            lastComplete = eolFound;
+
+            pos = eol + 1;
+            if (eolFound && pos == sz)
+            {
+                pendingEol = data[eol];
+            }
+            if (eolFound && pos < sz && isEol(data[pos]) &&
+                data[eol] != data[pos])
+            {
+                ++pos;
+            }
+        }
+
+        shrink();
+    }
+
+    void clear()
+    {
+        messages.clear();
+        lastComplete = true;
+        pendingEol = 0;
+    }
+
+    bool empty() const
+    {
+        return messages.empty();
+    }
+
+    container_t::const_iterator begin() const
+    {
+        return messages.begin();
+    }
+
+    container_t::const_iterator end() const
+    {
+        return messages.end();
+    }
+
+  private:
+    static constexpr bool isEol(char c)
+    {
+        return c == '\r' || c == '\n';
+    }
+
+    void shrink()
+    {
+        while (sizeLimit && messages.size() > sizeLimit)
+        {
+            messages.pop_front();
+        }
+        if (timeLimit)
+        {
+            time_t oldest;
+            time(&oldest);
+            oldest -= timeLimit * 60;
+            while (!messages.empty() && messages.front().timeStamp < oldest)
+            {
+                messages.pop_front();
+            }
+        }
+    }
+
+    container_t messages;
+    bool lastComplete = true;
+    char pendingEol = 0;
+    size_t sizeLimit;
+    size_t timeLimit;
+};
@@ -2,9 +2,35 @@
 // Copyright (C) 2020 YADRO
 
 #include "log_buffer.hpp"
+#include "log_buffer_list.hpp"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+/**
+ * @brief Compare messages stored in the log buffer with the reference
+ *        list-based implementation.
+ */
+static void expectSame(const LogBuffer& buf, const LogBufferList& ref)
+{
+    ASSERT_EQ(std::distance(buf.begin(), buf.end()),
+              std::distance(ref.begin(), ref.end()));
+    auto itRef = ref.begin();
+    for (const auto& msg : buf)
+    {
+        EXPECT_EQ(msg.text, itRef->text);
+        ++itRef;
+    }
+}
+
 TEST(LogBufferTest, Append)
 {
     const std::string msg = "Test message";
@@ -14,7 +40,7 @@ TEST(LogBufferTest, Append)
     buf.append(msg.data(), msg.length());
     ASSERT_EQ(std::distance(buf.begin(), buf.end()), 1);
     EXPECT_EQ(buf.begin()->text, msg);
-    EXPECT_NE(buf.begin()->timeStamp, 0);
+    EXPECT_NE(buf.begin()->timeStamp.tv_sec, 0);
 
     // must be merged with previous message
     const std::string append = "Append";
@@ -54,6 +80,14 @@ TEST(LogBufferTest, AppendEol)
     buf.clear();
     buf.append("\r\r\r\n\n\n", 6);
     EXPECT_EQ(std::distance(buf.begin(), buf.end()), 5);
+
+    // EOL sequence split between two reads
+    buf.clear();
+    buf.append("Test\r", 5);
+    buf.append("\nmessage", 8);
+    ASSERT_EQ(std::distance(buf.begin(), buf.end()), 2);
+    EXPECT_EQ(buf.begin()->text, "Test");
+    EXPECT_EQ((++buf.begin())->text, "message");
 }
 
 TEST(LogBufferTest, Clear)
@@ -67,6 +101,19 @@ TEST(LogBufferTest, Clear)
     EXPECT_TRUE(buf.empty());
 }
 
+TEST(LogBufferTest, Swap)
+{
+    const std::string msg = "Test message";
+
+    LogBuffer buf(0, 0);
+    LogBuffer other(0, 0);
+    buf.append(msg.data(), msg.length());
+    buf.swap(other);
+    EXPECT_TRUE(buf.empty());
+    ASSERT_EQ(std::distance(other.begin(), other.end()), 1);
+    EXPECT_EQ(other.begin()->text, msg);
+}
+
 TEST(LogBufferTest, SizeLimit)
 {
     const size_t limit = 5;
@@ -80,6 +127,164 @@ TEST(LogBufferTest, SizeLimit)
     EXPECT_EQ(std::distance(buf.begin(), buf.end()), limit);
 }
 
+TEST(LogBufferTest, BytesLimit)
+{
+    const std::string msg = "Test message\n";
+    // Text without EOL plus the index record
+    const size_t msgBytes = msg.length() - 1 + 12;
+    const size_t limit = msgBytes * 5 + 1;
+
+    LogBuffer buf(0, 0, limit);
+    for (size_t i = 0; i < 8; ++i)
+    {
+        buf.append(msg.data(), msg.length());
+        EXPECT_LE(buf.usage(), limit);
+    }
+    EXPECT_EQ(std::distance(buf.begin(), buf.end()), 5);
+    EXPECT_EQ(buf.usage(), msgBytes * 5);
+
+    // Long line without EOL evicts the oldest messages
+    const std::string dump(msgBytes * 4, 'x');
+    buf.append(dump.data(), dump.length());
+    EXPECT_EQ(std::distance(buf.begin(), buf.end()), 1);
+    EXPECT_EQ(buf.usage(), dump.length() + 12);
+    EXPECT_LE(buf.capacity(), limit * 4);
+
+    buf.clear();
+    EXPECT_EQ(buf.usage(), 0);
+}
+
+TEST(LogBufferTest, BytesLimitLongLine)
+{
+    // Line is split to fit in the limit, the tail is never evicted
+    LogBuffer buf(0, 0, 1000);
+    const std::string chunk(600, 'x');
+    buf.append("hello\n", 6);
+    buf.append(chunk.data(), chunk.size());
+    buf.append(chunk.data(), chunk.size());
+    buf.append("\n", 1);
+    ASSERT_FALSE(buf.empty());
+    EXPECT_LE(buf.usage(), 1000);
+    size_t stored = 0;
+    for (const auto& msg : buf)
+    {
+        EXPECT_LE(msg.text.size() + 12, 1000);
+        stored += msg.text.size();
+    }
+    EXPECT_EQ(stored, 2 * chunk.size() - (1000 - 12));
+
+    // Single chunk much larger than the limit doesn't grow the rings
+    const size_t limit = 4096;
+    LogBuffer big(0, 0, limit);
+    size_t flushed = 0;
+    big.setFullHandler([&flushed]() { ++flushed; });
+    const std::string dump(60000, 'y');
+    big.append(dump.data(), dump.size());
+    EXPECT_LE(big.usage(), limit);
+    EXPECT_LE(big.capacity(), limit * 4);
+    EXPECT_GT(flushed, 0);
+    ASSERT_TRUE(big.incomplete());
+    EXPECT_FALSE(big.incomplete()->text.empty());
+    big.append("\n", 1);
+    EXPECT_FALSE(big.incomplete());
+    EXPECT_EQ(big.size(), 1);
+}
+
+TEST(LogBufferTest, BytesLimitRing)
+{
+    const size_t limit = 4096;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> len(0, 300);
+    LogBuffer buf(0, 0, limit);
+    size_t capacity = 0;
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        const std::string msg(len(rng), 'a' + i % 26);
+        buf.append(msg.data(), msg.length());
+        buf.append("\n", 1);
+        ASSERT_LE(buf.usage(), limit);
+
+        size_t used = 0;
+        std::string_view last;
+        for (const auto& stored : buf)
+        {
+            used += stored.text.size() + 12;
+            last = stored.text;
+        }
+        ASSERT_EQ(buf.usage(), used);
+        ASSERT_EQ(last, msg);
+
+        // Rings stop growing once the limit is reached
+        if (i == 1000)
+        {
+            capacity = buf.capacity();
+        }
+        else if (i > 1000)
+        {
+            ASSERT_EQ(buf.capacity(), capacity);
+        }
+    }
+}
+
+TEST(LogBufferTest, LineLimit)
+{
+    std::vector<std::string> committed;
+
+    LogBuffer buf(0, 0, 0, 4);
+    buf.setMessageHandler([&committed](const LogBuffer::Message& msg) {
+        committed.emplace_back(msg.text);
+    });
+
+    buf.append("ab", 2);
+    buf.append("cdefghij", 8);
+    EXPECT_EQ(committed, (std::vector<std::string>{"abcd", "efgh"}));
+    ASSERT_TRUE(buf.incomplete());
+    EXPECT_EQ(buf.incomplete()->text, "ij");
+    EXPECT_TRUE(buf.incomplete()->continued);
+
+    buf.append("kl\nmn\n", 6);
+    EXPECT_EQ(committed,
+              (std::vector<std::string>{"abcd", "efgh", "ijkl", "mn"}));
+
+    std::vector<std::pair<std::string, bool>> stored;
+    for (const auto& msg : buf)
+    {
+        stored.emplace_back(msg.text, msg.continued);
+    }
+    EXPECT_EQ(stored, (std::vector<std::pair<std::string, bool>>{
+                          {"abcd", false},
+                          {"efgh", true},
+                          {"ijkl", true},
+                          {"mn", false}}));
+}
+
+TEST(LogBufferTest, LineLimitNoEol)
+{
+    // Endless output without EOL, e.g. a binary stream
+    const size_t limit = 1000;
+    const std::string chunk(333, 'x');
+
+    LogBuffer buf(10, 0, 0, limit);
+    size_t total = 0;
+    for (size_t i = 0; i < 1001; ++i)
+    {
+        buf.append(chunk.data(), chunk.size());
+        total += chunk.size();
+    }
+    // Only the newest parts of the line are kept
+    EXPECT_EQ(buf.size(), 10);
+    EXPECT_LE(buf.usage(), 10 * (limit + 12));
+    size_t stored = 0;
+    for (const auto& msg : buf)
+    {
+        EXPECT_LE(msg.text.size(), limit);
+        EXPECT_TRUE(msg.continued);
+        stored += msg.text.size();
+    }
+    EXPECT_EQ(stored, (total % limit) + 9 * limit);
+}
+
 TEST(LogBufferTest, FullHandler)
 {
     const size_t limit = 5;
@@ -99,3 +304,245 @@ TEST(LogBufferTest, FullHandler)
     EXPECT_EQ(count, 1);
     EXPECT_EQ(std::distance(buf.begin(), buf.end()), 2);
 }
+
+TEST(LogBufferTest, PartHandler)
+{
+    const std::string data = "Test\r\nmessage";
+
+    std::vector<std::pair<std::string, bool>> parts;
+
+    LogBuffer buf(0, 0);
+    buf.setPartHandler([&parts, &data](const char* text, size_t len,
+                                       bool eol) {
+        // Parts refer to the input data
+        EXPECT_GE(text, data.data());
+        EXPECT_LE(text + len, data.data() + data.size());
+        parts.emplace_back(std::string(text, len), eol);
+    });
+    buf.append(data.data(), data.size());
+    EXPECT_EQ(parts, (std::vector<std::pair<std::string, bool>>{
+                         {"Test", true}, {"message", false}}));
+    EXPECT_EQ(std::distance(buf.begin(), buf.end()), 2);
+}
+
+TEST(LogBufferTest, TimeStamp)
+{
+    timespec before;
+    clock_gettime(CLOCK_REALTIME_COARSE, &before);
+
+    LogBuffer buf(0, 0);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        buf.append("Test message\n", 13);
+    }
+
+    timespec after;
+    clock_gettime(CLOCK_REALTIME_COARSE, &after);
+
+    // Time stamps must be ordered and restored with sub-second precision
+    const auto toNs = [](const timespec& ts) {
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    };
+    int64_t prev = toNs(before) - 1'000'000'000;
+    for (const auto& msg : buf)
+    {
+        const int64_t ns = toNs(msg.timeStamp);
+        EXPECT_GE(ns, prev);
+        EXPECT_LE(ns, toNs(after) + 1'000'000'000);
+        EXPECT_LT(msg.timeStamp.tv_nsec, 1'000'000'000);
+        prev = ns;
+    }
+}
+
+TEST(LogBufferTest, LongMessages)
+{
+    const std::string msg(1000, 'x');
+
+    LogBuffer buf(3, 0);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        buf.append(msg.data(), msg.length());
+        buf.append(msg.data(), msg.length());
+        buf.append("\n", 1);
+    }
+    ASSERT_EQ(std::distance(buf.begin(), buf.end()), 3);
+    for (const auto& it : buf)
+    {
+        EXPECT_EQ(it.text, msg + msg);
+    }
+}
+
+TEST(LogBufferTest, Differential)
+{
+    // Random chunks of printable text with EOLs, split at random positions
+    std::mt19937 rnd(42);
+    const char alphabet[] = "abc \r\n\n\n";
+
+    for (size_t limit : {0, 1, 7, 100})
+    {
+        LogBuffer buf(limit, 0);
+        LogBufferList ref(limit, 0);
+
+        for (size_t i = 0; i < 2000; ++i)
+        {
+            std::string chunk(rnd() % (i % 10 ? 64 : 4096), ' ');
+            for (auto& c : chunk)
+            {
+                c = alphabet[rnd() % (sizeof(alphabet) - 1)];
+            }
+            buf.append(chunk.data(), chunk.length());
+            ref.append(chunk.data(), chunk.length());
+            if (rnd() % 500 == 0)
+            {
+                buf.clear();
+                ref.clear();
+            }
+            if (i % 50 == 0)
+            {
+                expectSame(buf, ref);
+            }
+        }
+        expectSame(buf, ref);
+    }
+}
+
+/** @brief Get texts of the stored messages. */
+static std::vector<std::string> texts(const LogBuffer& buf)
+{
+    std::vector<std::string> result;
+    for (const auto& msg : buf)
+    {
+        result.emplace_back(msg.text);
+    }
+    return result;
+}
+
+/** @brief Path to the ring file used in tests. */
+static const std::string ringPath = "/tmp/log_buffer_test.ring";
+
+TEST(LogBufferTest, Persist)
+{
+    unlink(ringPath.c_str());
+    timespec stamp;
+    {
+        LogBuffer buf(0, 0, 4096);
+        EXPECT_EQ(buf.persist(ringPath), 0);
+        const std::string data = "first\nsecond\nthi";
+        buf.append(data.data(), data.size());
+        stamp = buf.begin()->timeStamp;
+    }
+
+    LogBuffer buf(0, 0, 4096);
+    EXPECT_EQ(buf.persist(ringPath), 3);
+    EXPECT_EQ(buf.begin()->timeStamp.tv_sec, stamp.tv_sec);
+    EXPECT_EQ(buf.begin()->timeStamp.tv_nsec, stamp.tv_nsec);
+    // The line of the previous instance is not continued
+    buf.append("rd\n", 3);
+    EXPECT_EQ(texts(buf), (std::vector<std::string>{"first", "second", "thi",
+                                                    "rd"}));
+
+    // Buffer without byte limit can't be placed in a file
+    LogBuffer unlimited(0, 0);
+    EXPECT_THROW(unlimited.persist(ringPath), std::invalid_argument);
+    unlink(ringPath.c_str());
+}
+
+TEST(LogBufferTest, PersistCrash)
+{
+    // Kill the writer at random points, the state must be consistent
+    for (useconds_t delay : {0, 1000, 2000, 3000, 5000, 8000})
+    {
+        unlink(ringPath.c_str());
+        const pid_t pid = fork();
+        ASSERT_NE(pid, -1);
+        if (!pid)
+        {
+            LogBuffer buf(100, 0, 4096, 64);
+            buf.persist(ringPath);
+            for (size_t i = 0;; ++i)
+            {
+                // Long lines are split and extended across the chunks
+                const std::string msg = "Message #" + std::to_string(i) +
+                                        std::string(i % 100, '.') + '\n';
+                for (size_t pos = 0; pos < msg.size(); pos += 50)
+                {
+                    buf.append(msg.data() + pos,
+                               std::min<size_t>(50, msg.size() - pos));
+                }
+            }
+        }
+        usleep(delay);
+        kill(pid, SIGKILL);
+        int status = 0;
+        ASSERT_EQ(waitpid(pid, &status, 0), pid);
+
+        LogBuffer buf(100, 0, 4096, 64);
+        buf.persist(ringPath);
+        EXPECT_LE(buf.size(), 100);
+        EXPECT_LE(buf.usage(), 4096);
+
+        // Join the parts of the split lines and check their sequence
+        std::vector<std::string> lines;
+        for (const auto& msg : buf)
+        {
+            if (msg.continued && !lines.empty())
+            {
+                lines.back() += msg.text;
+            }
+            else if (!msg.continued)
+            {
+                lines.emplace_back(msg.text);
+            }
+        }
+        if (lines.size() < 2)
+        {
+            continue;
+        }
+        const size_t start = std::stoul(lines[1].substr(9));
+        for (size_t i = 1; i + 1 < lines.size(); ++i)
+        {
+            const size_t num = start + i - 1;
+            EXPECT_EQ(lines[i], "Message #" + std::to_string(num) +
+                                    std::string(num % 100, '.'));
+        }
+    }
+    unlink(ringPath.c_str());
+}
+
+TEST(LogBufferTest, PersistRing)
+{
+    unlink(ringPath.c_str());
+    const size_t limit = 1000;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> len(0, 200);
+    std::vector<std::string> stored;
+    {
+        LogBuffer buf(0, 0, limit);
+        buf.persist(ringPath);
+        const size_t capacity = buf.capacity();
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            std::string msg(len(rng), 'a' + i % 26);
+            buf.append(msg.data(), msg.size());
+            if (i % 3)
+            {
+                buf.append("\n", 1);
+            }
+            ASSERT_LE(buf.usage(), limit);
+            ASSERT_EQ(buf.capacity(), capacity);
+        }
+        stored = texts(buf);
+    }
+
+    LogBuffer buf(0, 0, limit);
+    EXPECT_EQ(buf.persist(ringPath), stored.size());
+    EXPECT_EQ(texts(buf), stored);
+
+    // Messages are copied to the heap buffer on swap
+    LogBuffer other(0, 0);
+    buf.swap(other);
+    EXPECT_TRUE(buf.empty());
+    EXPECT_EQ(texts(other), stored);
+    unlink(ringPath.c_str());
+}
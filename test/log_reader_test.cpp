@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "log_reader.hpp"
+#include "plain_file.hpp"
+#include "zlib_block_file.hpp"
+#include "zlib_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <regex>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+/** @brief Time stamp of the first record. */
+static constexpr time_t baseTime = 1'600'000'000;
+
+/**
+ * @class LogReaderTest
+ * @brief Log reader tests.
+ */
+class LogReaderTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(dir);
+    }
+
+    /**
+     * @brief Write the log file, one record per second.
+     *
+     * @param[in] file log writer
+     * @param[in] first number of the first record
+     * @param[in] count number of records
+     * @param[in] step number of seconds between records
+     */
+    static void writeLog(LogWriter& file, size_t first, size_t count,
+                         size_t step)
+    {
+        for (size_t i = first; i < first + count * step; i += step)
+        {
+            const timespec ts{static_cast<time_t>(baseTime + i), 0};
+            file.write(ts, "Message #" + std::to_string(i));
+        }
+        file.close();
+    }
+
+    /**
+     * @brief Read records.
+     *
+     * @param[in] query filter of log records
+     *
+     * @return text of records
+     */
+    std::vector<std::string> read(const LogReader::Query& query) const
+    {
+        std::vector<std::string> records;
+        int64_t prev = std::numeric_limits<int64_t>::min();
+        LogReader(dir, query).read([&](const LogReader::Record& record) {
+            EXPECT_LE(prev, record.time);
+            EXPECT_EQ(record.time, LogReader::parseTime(record.text));
+            prev = record.time;
+            records.emplace_back(record.instance);
+            records.back() += ' ';
+            records.back() += record.text.substr(record.text.find(']') + 2);
+        });
+        return records;
+    }
+
+    const fs::path dir = fs::temp_directory_path() / "log_reader_test";
+};
+
+TEST_F(LogReaderTest, ParseTime)
+{
+    TimeFormatter formatter;
+    for (const timespec ts : {timespec{baseTime, 123'456'789},
+                              timespec{0, 0}, timespec{4'102'444'800, 0}})
+    {
+        const std::string text =
+            std::string(formatter.format(ts)) + "Message";
+        EXPECT_EQ(LogReader::parseTime(text),
+                  ts.tv_sec * 1000 + ts.tv_nsec / 1'000'000);
+    }
+    EXPECT_EQ(LogReader::parseTime("[ 2020-09-13T12:26:40.123-03:30 ] x"),
+              (baseTime + 3 * 3600 + 30 * 60) * 1000 + 123);
+    for (const char* text :
+         {"", "Message", "[ 2020-09-13 ] x", "[ 2020-09-13T12:26:40.1+00:00 ]",
+          "[ 2020-09-13T12:26:40.123+00:00 x", "[ 2020-09-1xT12:26:40.123"})
+    {
+        EXPECT_EQ(LogReader::parseTime(text),
+                  std::numeric_limits<int64_t>::min())
+            << text;
+    }
+}
+
+TEST_F(LogReaderTest, Instance)
+{
+    EXPECT_EQ(LogReader::instance("host_20200101_120000.log.gz"), "host");
+    EXPECT_EQ(LogReader::instance("my_host_20200101_120000_2.log"), "my_host");
+    EXPECT_EQ(LogReader::instance("host_20200101_120000.log.zst"), "host");
+    EXPECT_EQ(LogReader::instance(".host.log.gz.part"), "");
+    EXPECT_EQ(LogReader::instance("host_20200101.log"), "");
+    EXPECT_EQ(LogReader::instance("host_20200101_120000.txt"), "");
+    EXPECT_EQ(LogReader::instance("host_20200101_120000_x.log"), "");
+}
+
+TEST_F(LogReaderTest, Read)
+{
+    // Even records in a gzip file, odd ones in a plain and a seekable file
+    ZlibFile gzipFile(dir / "a_20991231_235959.log.gz");
+    writeLog(gzipFile, 0, 100, 2);
+    PlainFile plainFile(dir / "b_20991231_235959.log");
+    writeLog(plainFile, 1, 25, 2);
+    ZlibBlockFile blockFile(dir / "b_20991231_235959_1.log.gz",
+                            Z_DEFAULT_COMPRESSION, 256);
+    writeLog(blockFile, 51, 75, 2);
+    ASSERT_GT(ZlibBlockFile::readIndex(dir / "b_20991231_235959_1.log.gz")
+                  .size(),
+              10);
+
+    // Other files are ignored, old files are skipped by the name
+    std::ofstream(dir / "b_20991231_235959.txt") << "ignored";
+    PlainFile oldFile(dir / "a_20000101_000000.log");
+    writeLog(oldFile, 1000, 10, 1);
+
+    LogReader::Query query;
+    std::vector<std::string> records = read(query);
+    ASSERT_EQ(records.size(), 210);
+    for (size_t i = 0; i < 200; ++i)
+    {
+        const char* inst = i % 2 ? "b " : "a ";
+        EXPECT_EQ(records[i], inst + ("Message #" + std::to_string(i)));
+    }
+
+    // Time range
+    query.since = (baseTime + 110) * 1000;
+    query.until = (baseTime + 120) * 1000;
+    records = read(query);
+    ASSERT_EQ(records.size(), 11);
+    EXPECT_EQ(records.front(), "a Message #110");
+    EXPECT_EQ(records.back(), "a Message #120");
+
+    // Instance and pattern
+    query = LogReader::Query();
+    query.instances = {"b"};
+    query.pattern = "#1[0-9]$";
+    query.jobs = 1;
+    records = read(query);
+    ASSERT_EQ(records.size(), 5);
+    EXPECT_EQ(records.front(), "b Message #11");
+
+    query.instances = {"c"};
+    EXPECT_TRUE(read(query).empty());
+}
+
+TEST_F(LogReaderTest, LargeFile)
+{
+    // Compressed files are decoded in 64 KiB chunks, the text is longer
+    std::vector<Compression> compressions{Compression::none,
+                                          Compression::zlib};
+#ifdef HAVE_ZSTD
+    compressions.push_back(Compression::zstd);
+#endif
+#ifdef HAVE_LZ4
+    compressions.push_back(Compression::lz4);
+#endif
+    const size_t count = 5000;
+    for (const Compression compression : compressions)
+    {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        const std::string path =
+            dir / ("a_20991231_235959" +
+                   std::string(LogWriter::extension(compression)));
+        const auto file = LogWriter::create(compression, 0, path);
+        writeLog(*file, 0, count, 1);
+
+        const std::vector<std::string> records = read(LogReader::Query());
+        ASSERT_EQ(records.size(), count) << path;
+        EXPECT_EQ(records.back(),
+                  "a Message #" + std::to_string(count - 1));
+    }
+}
+
+TEST_F(LogReaderTest, InvalidPattern)
+{
+    LogReader::Query query;
+    query.pattern = "(";
+    EXPECT_THROW(LogReader(dir, query), std::regex_error);
+    EXPECT_THROW(LogReader(dir / "invalid", LogReader::Query()).read({}),
+                 fs::filesystem_error);
+}
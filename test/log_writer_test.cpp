@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "log_writer.hpp"
+
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <fstream>
+#include <iterator>
+
+#include <gtest/gtest.h>
+
+/** @brief Read the whole file. */
+static std::string readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+/** @brief Read and decompress gzip file. */
+static std::string readZlib(const std::string& path)
+{
+    std::string text;
+    gzFile fd = gzopen(path.c_str(), "r");
+    if (fd != Z_NULL)
+    {
+        char buf[4096];
+        int rc;
+        while ((rc = gzread(fd, buf, sizeof(buf))) > 0)
+        {
+            text.append(buf, rc);
+        }
+        gzclose(fd);
+    }
+    return text;
+}
+
+#ifdef HAVE_ZSTD
+/** @brief Read and decompress zstd file. */
+static std::string readZstd(const std::string& path)
+{
+    const std::string data = readFile(path);
+    std::string text;
+    ZSTD_DStream* ds = ZSTD_createDStream();
+    ZSTD_inBuffer in{data.data(), data.size(), 0};
+    char buf[4096];
+    while (in.pos < in.size)
+    {
+        ZSTD_outBuffer out{buf, sizeof(buf), 0};
+        if (ZSTD_isError(ZSTD_decompressStream(ds, &out, &in)))
+        {
+            break;
+        }
+        text.append(buf, out.pos);
+    }
+    ZSTD_freeDStream(ds);
+    return text;
+}
+#endif
+
+#ifdef HAVE_LZ4
+/** @brief Read and decompress lz4 file. */
+static std::string readLz4(const std::string& path)
+{
+    const std::string data = readFile(path);
+    std::string text;
+    LZ4F_dctx* dctx;
+    LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+    size_t pos = 0;
+    char buf[4096];
+    while (pos < data.size())
+    {
+        size_t outSize = sizeof(buf);
+        size_t inSize = data.size() - pos;
+        if (LZ4F_isError(LZ4F_decompress(dctx, buf, &outSize,
+                                         data.data() + pos, &inSize,
+                                         nullptr)))
+        {
+            break;
+        }
+        text.append(buf, outSize);
+        pos += inSize;
+    }
+    LZ4F_freeDecompressionContext(dctx);
+    return text;
+}
+#endif
+
+/**
+ * @class LogWriterTest
+ * @brief Log writer tests, parameterized by compression algorithm.
+ */
+class LogWriterTest : public ::testing::TestWithParam<Compression>
+{
+  protected:
+    void TearDown() override
+    {
+        unlink(path.c_str());
+    }
+
+    /** @brief Read file written with the tested algorithm. */
+    std::string read() const
+    {
+        switch (GetParam())
+        {
+            case Compression::zlib:
+                return readZlib(path);
+#ifdef HAVE_ZSTD
+            case Compression::zstd:
+                return readZstd(path);
+#endif
+#ifdef HAVE_LZ4
+            case Compression::lz4:
+                return readLz4(path);
+#endif
+            default:
+                return readFile(path);
+        }
+    }
+
+    const std::string path = "/tmp/log_writer_test.out";
+};
+
+TEST_P(LogWriterTest, Write)
+{
+    // Messages of various size, including one larger than internal buffers
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        messages.push_back("Message #" + std::to_string(i) +
+                           std::string(i % 120, 'a' + i % 26));
+    }
+    messages.insert(messages.begin() + 1000, std::string(200'000, 'x'));
+
+    const timespec ts{1'600'000'000, 123'000'000};
+    TimeFormatter formatter;
+    std::string expect;
+    auto file = LogWriter::create(GetParam(), 0, path);
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        file->write(ts, messages[i]);
+        expect += formatter.format(ts);
+        expect += messages[i];
+        expect += '\n';
+        if (i == 10)
+        {
+            // Data written before sync must be readable
+            file->sync();
+            const std::string text = read();
+            EXPECT_EQ(text.size(), expect.size());
+            EXPECT_TRUE(text == expect);
+        }
+    }
+    file->close();
+
+    const std::string text = read();
+    EXPECT_EQ(text.size(), expect.size());
+    EXPECT_TRUE(text == expect);
+}
+
+TEST_P(LogWriterTest, Continued)
+{
+    const timespec ts{1'600'000'000, 123'000'000};
+    auto file = LogWriter::create(GetParam(), 0, path);
+    file->write(ts, "Long");
+    file->write(ts, "line", true);
+    file->close();
+
+    TimeFormatter formatter;
+    std::string expect(formatter.format(ts));
+    expect += "Long\n";
+    expect += formatter.format(ts);
+    expect += "... line\n";
+    EXPECT_EQ(read(), expect);
+}
+
+TEST_P(LogWriterTest, Empty)
+{
+    auto file = LogWriter::create(GetParam(), 0, path);
+    file->close();
+    EXPECT_TRUE(read().empty());
+}
+
+TEST_P(LogWriterTest, Exception)
+{
+    EXPECT_THROW(LogWriter::create(GetParam(), 0, "invalid/path"),
+                 std::exception);
+}
+
+/** @brief Compression algorithms available in the build. */
+static const Compression compressions[] = {
+    Compression::none, Compression::zlib,
+#ifdef HAVE_ZSTD
+    Compression::zstd,
+#endif
+#ifdef HAVE_LZ4
+    Compression::lz4,
+#endif
+};
+
+INSTANTIATE_TEST_SUITE_P(Compression, LogWriterTest,
+                         ::testing::ValuesIn(compressions));
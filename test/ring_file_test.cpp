@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "ring_file.hpp"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+/**
+ * @class RingFileTest
+ * @brief Ring file tests.
+ */
+class RingFileTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fs::remove_all(dir);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(dir);
+    }
+
+    const std::string dir = "/tmp/ring_file_test";
+    const std::string path = dir + "/test.ring";
+};
+
+TEST_F(RingFileTest, Commit)
+{
+    uint64_t state = 0;
+    {
+        RingFile file(path, sizeof(state), 100, 1000);
+        EXPECT_FALSE(file.load(&state));
+
+        memcpy(file.index(), "index", 5);
+        memcpy(file.data(), "data", 4);
+        for (state = 1; state <= 3; ++state)
+        {
+            file.commit(&state);
+        }
+    }
+
+    RingFile file(path, sizeof(state), 100, 1000);
+    ASSERT_TRUE(file.load(&state));
+    EXPECT_EQ(state, 3);
+    EXPECT_EQ(memcmp(file.index(), "index", 5), 0);
+    EXPECT_EQ(memcmp(file.data(), "data", 4), 0);
+}
+
+TEST_F(RingFileTest, TornWrite)
+{
+    uint64_t state = 1;
+    {
+        RingFile file(path, sizeof(state), 100, 1000);
+        file.commit(&state);
+        state = 2;
+        file.commit(&state);
+    }
+
+    // Damage the last slot: the previous state is used
+    std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(64 + 16);
+    stream.put('\xff');
+    stream.close();
+
+    RingFile file(path, sizeof(state), 100, 1000);
+    ASSERT_TRUE(file.load(&state));
+    EXPECT_EQ(state, 1);
+
+    // The damaged slot is overwritten by the next commit
+    state = 3;
+    file.commit(&state);
+    ASSERT_TRUE(file.load(&state));
+    EXPECT_EQ(state, 3);
+}
+
+TEST_F(RingFileTest, Resize)
+{
+    uint64_t state = 1;
+    {
+        RingFile file(path, sizeof(state), 100, 1000);
+        file.commit(&state);
+    }
+    {
+        RingFile file(path, sizeof(state), 100, 2000);
+        EXPECT_FALSE(file.load(&state));
+        EXPECT_EQ(fs::file_size(path), 4096 * 3);
+    }
+}
+
+TEST_F(RingFileTest, InvalidPath)
+{
+    EXPECT_THROW(RingFile("/proc/invalid/test.ring", 8, 100, 1000),
+                 std::exception);
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "dbus_loop_mock.hpp"
+#include "shard_loop.hpp"
+
+#include <csignal>
+#include <functional>
+#include <memory>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using ::testing::_;
+using ::testing::Eq;
+using ::testing::SaveArg;
+using ::testing::StrEq;
+
+/**
+ * @class ShardLoopTest
+ * @brief Tests of routing events from the main loop to the shard.
+ */
+class ShardLoopTest : public ::testing::Test, public ShardLoop
+{
+  public:
+    ShardLoopTest() : ShardLoop(mainLoopMock) {}
+
+  protected:
+    DbusLoopMock mainLoopMock;
+};
+
+TEST_F(ShardLoopTest, PropertyHandler)
+{
+    // Handler is registered in the main loop
+    std::function<void()> mainHandler;
+    EXPECT_CALL(mainLoopMock, addPropertyHandler(StrEq("/host0"), _, _))
+        .WillOnce(SaveArg<2>(&mainHandler));
+    size_t called = 0;
+    addPropertyHandler("/host0", {}, [&called]() { ++called; });
+    ASSERT_TRUE(mainHandler);
+
+    // The event is queued by the main thread and handled by the shard,
+    // repeated events are coalesced until the shard handles them
+    mainHandler();
+    mainHandler();
+    EXPECT_EQ(called, 0);
+    dispatch();
+    EXPECT_EQ(called, 1);
+    dispatch();
+    EXPECT_EQ(called, 1);
+    mainHandler();
+    dispatch();
+    EXPECT_EQ(called, 2);
+}
+
+TEST_F(ShardLoopTest, SignalHandler)
+{
+    std::function<void()> mainHandler;
+    EXPECT_CALL(mainLoopMock, addSignalHandler(Eq(SIGUSR1), _))
+        .WillOnce(SaveArg<1>(&mainHandler));
+    size_t called = 0;
+    addSignalHandler(SIGUSR1, [&called]() { ++called; });
+    ASSERT_TRUE(mainHandler);
+
+    mainHandler();
+    dispatch();
+    EXPECT_EQ(called, 1);
+}
+
+TEST_F(ShardLoopTest, Object)
+{
+    // Methods are registered in the main loop with the same signatures
+    Methods mainMethods;
+    std::function<void()> replyHandler;
+    EXPECT_CALL(mainLoopMock, addIoHandler(_, _))
+        .WillOnce(SaveArg<1>(&replyHandler));
+    EXPECT_CALL(mainLoopMock, addObject(StrEq("/obj"), StrEq("iface"), _))
+        .WillOnce(SaveArg<2>(&mainMethods));
+    EXPECT_CALL(mainLoopMock, requestName(StrEq("name")));
+    size_t called = 0;
+    addObject("/obj", "iface",
+              {{"Call", {"s", [&called](const Reply& reply) {
+                             ++called;
+                             reply(MethodResult("result"), std::string());
+                         }}}});
+    requestName("name");
+    ASSERT_EQ(mainMethods.size(), 1);
+    EXPECT_STREQ(mainMethods["Call"].result, "s");
+    ASSERT_TRUE(replyHandler);
+
+    // The call is queued without waiting for the shard
+    std::string result;
+    mainMethods["Call"].callback(
+        [&result](const MethodResult& res, const std::string& error) {
+            EXPECT_EQ(error, "");
+            result = std::get<std::string>(res);
+        });
+    EXPECT_EQ(called, 0);
+
+    // The shard handles the call, the reply is sent by the main thread
+    dispatch();
+    EXPECT_EQ(called, 1);
+    EXPECT_EQ(result, "");
+    replyHandler();
+    EXPECT_EQ(result, "result");
+}
+
+TEST_F(ShardLoopTest, ObjectNotDispatched)
+{
+    Methods mainMethods;
+    EXPECT_CALL(mainLoopMock, addIoHandler(_, _));
+    EXPECT_CALL(mainLoopMock, addObject(StrEq("/obj"), StrEq("iface"), _))
+        .WillOnce(SaveArg<2>(&mainMethods));
+    auto shard = std::make_unique<ShardLoop>(mainLoopMock);
+    shard->addObject("/obj", "iface",
+                     {{"Call", {"s", [](const Reply&) { FAIL(); }}}});
+    ASSERT_EQ(mainMethods.size(), 1);
+
+    // The call queued before the shard is stopped releases its message
+    const auto message = std::make_shared<int>(0);
+    mainMethods["Call"].callback(
+        [message](const MethodResult&, const std::string&) { FAIL(); });
+    EXPECT_EQ(message.use_count(), 2);
+    shard.reset();
+    EXPECT_EQ(message.use_count(), 1);
+}
+
+TEST_F(ShardLoopTest, EventsQueueFull)
+{
+    std::function<void()> mainHandler;
+    EXPECT_CALL(mainLoopMock, addSignalHandler(Eq(SIGUSR1), _))
+        .WillOnce(SaveArg<1>(&mainHandler));
+    size_t called = 0;
+    addSignalHandler(SIGUSR1, [&called]() { ++called; });
+
+    // The queue is filled up by other handlers, the event is lost
+    const std::function<void()> handler = []() {};
+    while (post(&handler))
+    {}
+    mainHandler();
+    dispatch();
+    EXPECT_EQ(called, 0);
+
+    // The lost event doesn't block the next ones
+    mainHandler();
+    mainHandler();
+    dispatch();
+    EXPECT_EQ(called, 1);
+}
+
+TEST_F(ShardLoopTest, QueueFull)
+{
+    size_t called = 0;
+    const std::function<void()> handler = [&called]() { ++called; };
+    size_t posted = 0;
+    while (post(&handler))
+    {
+        ++posted;
+    }
+    EXPECT_GT(posted, 0);
+    dispatch();
+    EXPECT_EQ(called, posted);
+    EXPECT_TRUE(post(&handler));
+}
+
+TEST_F(ShardLoopTest, JoinNotStarted)
+{
+    EXPECT_EQ(join(), 0);
+}
+} // namespace
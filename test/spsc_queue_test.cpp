@@ -0,0 +1,60 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "spsc_queue.hpp"
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+TEST(SpscQueueTest, PushPop)
+{
+    SpscQueue<int> queue(3);
+    EXPECT_FALSE(queue.pop());
+    // Capacity is rounded up to 4
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_EQ(queue.pop(), 0);
+    EXPECT_TRUE(queue.push(4));
+    for (int i = 1; i < 5; ++i)
+    {
+        EXPECT_EQ(queue.pop(), i);
+    }
+    EXPECT_FALSE(queue.pop());
+}
+
+TEST(SpscQueueTest, Threads)
+{
+    constexpr size_t count = 100'000;
+    SpscQueue<size_t> queue(16);
+
+    std::thread producer([&queue]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            while (!queue.push(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Items are received in order without losses
+    size_t expected = 0;
+    while (expected < count)
+    {
+        if (const auto item = queue.pop())
+        {
+            ASSERT_EQ(*item, expected);
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_FALSE(queue.pop());
+}
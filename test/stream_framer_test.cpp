@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "stream_framer.hpp"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+/** @brief Get all datagrams prepared by the framer. */
+static std::vector<std::string> datagrams(const StreamFramer& framer)
+{
+    std::vector<std::string> result;
+    for (size_t i = 0; i < framer.size(); ++i)
+    {
+        result.emplace_back(framer[i]);
+    }
+    return result;
+}
+
+TEST(StreamFramerTest, LinePerDatagram)
+{
+    StreamFramer framer(1024, false);
+    const std::string data = "line 1\r\nline 2\n\rline 3\rline";
+    framer.append(data.data(), data.size());
+    EXPECT_EQ(datagrams(framer),
+              std::vector<std::string>({"line 1\n", "line 2\n", "line 3\n"}));
+    EXPECT_TRUE(framer.hasPartial());
+
+    framer.clear();
+    EXPECT_EQ(framer.size(), 0);
+    framer.append(" 4\n", 3);
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({"line 4\n"}));
+    EXPECT_FALSE(framer.hasPartial());
+}
+
+TEST(StreamFramerTest, SplitEol)
+{
+    StreamFramer framer(1024, false);
+    framer.append("line 1\r", 7);
+    framer.append("\nline 2\n", 8);
+    EXPECT_EQ(datagrams(framer),
+              std::vector<std::string>({"line 1\n", "line 2\n"}));
+}
+
+TEST(StreamFramerTest, AddPart)
+{
+    StreamFramer framer(1024, false);
+    framer.addPart("line", 4, false);
+    framer.addPart(" 1", 2, true);
+    framer.addPart("line 2", 6, false);
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({"line 1\n"}));
+    EXPECT_TRUE(framer.hasPartial());
+}
+
+TEST(StreamFramerTest, Pack)
+{
+    StreamFramer framer(16, true);
+    const std::string data = "line 1\nline 2\nline 3\nlong line 4\n\n";
+    framer.append(data.data(), data.size());
+    EXPECT_EQ(datagrams(framer),
+              std::vector<std::string>(
+                  {"line 1\nline 2\n", "line 3\n", "long line 4\n\n"}));
+}
+
+TEST(StreamFramerTest, LongLine)
+{
+    StreamFramer framer(8, false);
+    const std::string data = "0123456789abcdef0123\n";
+    framer.append(data.data(), data.size());
+    EXPECT_EQ(datagrams(framer),
+              std::vector<std::string>({"0123456\n", "789abcd\n", "ef0123\n"}));
+}
+
+TEST(StreamFramerTest, LongPartialLine)
+{
+    StreamFramer framer(8, false);
+    framer.append("0123", 4);
+    EXPECT_EQ(framer.size(), 0);
+    framer.append("456789", 6);
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({"0123456\n"}));
+    EXPECT_TRUE(framer.hasPartial());
+}
+
+TEST(StreamFramerTest, FlushPartial)
+{
+    StreamFramer framer(1024, true);
+    EXPECT_FALSE(framer.flushPartial());
+    framer.append("line 1\nline", 11);
+    EXPECT_TRUE(framer.flushPartial());
+    EXPECT_FALSE(framer.hasPartial());
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({"line 1\nline\n"}));
+    framer.clear();
+    framer.append(" 2\n", 3);
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({" 2\n"}));
+}
+
+TEST(StreamFramerTest, Remove)
+{
+    StreamFramer framer(1024, false);
+    const std::string data = "line 1\nline 2\nline 3\nline 4\n";
+    framer.append(data.data(), data.size());
+    EXPECT_EQ(framer.bytes(), data.size());
+
+    framer.removeFront(1);
+    framer.removeBack();
+    EXPECT_EQ(datagrams(framer),
+              std::vector<std::string>({"line 2\n", "line 3\n"}));
+    EXPECT_EQ(framer.bytes(), 14);
+
+    // New lines are added after the kept ones
+    framer.append("line 5\n", 7);
+    framer.removeFront(2);
+    EXPECT_EQ(datagrams(framer), std::vector<std::string>({"line 5\n"}));
+    EXPECT_EQ(framer.bytes(), 7);
+
+    framer.removeBack();
+    EXPECT_EQ(framer.size(), 0);
+    EXPECT_EQ(framer.bytes(), 0);
+}
@@ -6,9 +6,6 @@
 #include "host_console_mock.hpp"
 #include "stream_service.hpp"
 
-#include <sys/socket.h>
-#include <unistd.h>
-
 #include <memory>
 #include <string>
 #include <system_error>
@@ -21,8 +18,7 @@ namespace
 
 constexpr char socketPath[] = "\0rsyslog";
 constexpr char firstDatagram[] = "Hello world";
-constexpr char secondDatagram[] = "World hello again";
-// Shouldn't read more than maximum size of a datagram.
+// The first read is limited by the initial size of the read buffer.
 constexpr int consoleReadMaxSize = 1024;
 
 using ::testing::_;
@@ -37,44 +33,36 @@ using ::testing::StrEq;
 using ::testing::Test;
 using ::testing::Throw;
 
-class StreamServiceTest : public Test, public StreamService
+// A helper class that owns config.
+struct ConfigInTest
+{
+    Config config;
+    ConfigInTest() : config()
+    {
+        config.streamDestination = socketPath;
+        // Send each line in its own datagram without delay.
+        config.streamPack = false;
+        config.streamTimeout = 0;
+    }
+};
+
+class StreamServiceTest : public Test, public ConfigInTest, public StreamService
 {
   public:
+    // ConfigInTest::config is initialized before StreamService.
     StreamServiceTest() :
-        StreamService(socketPath, dbusLoopMock, hostConsoleMock),
-        serverSocket(-1)
-    {}
-    ~StreamServiceTest() override
+        StreamService(ConfigInTest::config, dbusLoopMock, hostConsoleMock)
     {
-        // Stop server
-        if (serverSocket != -1)
-        {
-            close(serverSocket);
-        }
+        // Size of queued data is unknown, read until the console is drained.
+        EXPECT_CALL(hostConsoleMock, pending())
+            .WillRepeatedly(Return(std::nullopt));
     }
 
     MOCK_METHOD(void, readConsole, (), (override));
     MOCK_METHOD(void, streamConsole, (const char* data, size_t len),
                 (override));
-    MOCK_METHOD(void, setStreamSocket, (), (override));
 
   protected:
-    // Start a server for reading datagrams.
-    void startServer()
-    {
-        serverSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
-        ASSERT_NE(serverSocket, -1);
-        sockaddr_un sa{};
-        sa.sun_family = AF_UNIX;
-        memcpy(sa.sun_path, socketPath, sizeof(socketPath) - 1);
-        sa.sun_path[sizeof(socketPath) - 1] = '\0';
-        const socklen_t len =
-            sizeof(sa) - sizeof(sa.sun_path) + sizeof(socketPath) - 1;
-        ASSERT_NE(bind(serverSocket, reinterpret_cast<const sockaddr*>(&sa),
-                       len),
-                  -1);
-    }
-
     // Set hostConsole firstly read specified data and then read nothing.
     void setHostConsoleOnce(const char* data, size_t len)
     {
@@ -85,14 +73,12 @@ class StreamServiceTest : public Test, public StreamService
 
     DbusLoopMock dbusLoopMock;
     HostConsoleMock hostConsoleMock;
-    int serverSocket;
 };
 
 TEST_F(StreamServiceTest, ReadConsoleExceptionCaught)
 {
     InSequence sequence;
-    // Shouldn't read more than maximum size of a datagram.
-    EXPECT_CALL(hostConsoleMock, read(_, Le(1024)))
+    EXPECT_CALL(hostConsoleMock, read(_, Le(consoleReadMaxSize)))
         .WillOnce(Throw(std::system_error(std::error_code(), "Mock error")));
     EXPECT_NO_THROW(StreamService::readConsole());
 }
@@ -107,28 +93,9 @@ TEST_F(StreamServiceTest, ReadConsoleOk)
     EXPECT_NO_THROW(StreamService::readConsole());
 }
 
-TEST_F(StreamServiceTest, StreamConsoleOk)
-{
-    startServer();
-    EXPECT_NO_THROW(StreamService::setStreamSocket());
-    EXPECT_NO_THROW(
-        StreamService::streamConsole(firstDatagram, strlen(firstDatagram)));
-    EXPECT_NO_THROW(
-        StreamService::streamConsole(secondDatagram, strlen(secondDatagram)));
-    char buffer[consoleReadMaxSize];
-    EXPECT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
-              strlen(firstDatagram));
-    buffer[strlen(firstDatagram)] = '\0';
-    EXPECT_STREQ(buffer, firstDatagram);
-    EXPECT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
-              strlen(secondDatagram));
-    buffer[strlen(secondDatagram)] = '\0';
-    EXPECT_STREQ(buffer, secondDatagram);
-}
-
 TEST_F(StreamServiceTest, RunIoRegisterError)
 {
-    EXPECT_CALL(*this, setStreamSocket()).WillOnce(Return());
+    EXPECT_CALL(dbusLoopMock, addOutputHandler(_, _)).WillOnce(Return());
     EXPECT_CALL(hostConsoleMock, connect()).WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, addSignalHandler(Eq(SIGTERM), _))
         .WillOnce(Return());
@@ -139,7 +106,7 @@ TEST_F(StreamServiceTest, RunIoRegisterError)
 
 TEST_F(StreamServiceTest, RunSignalRegisterError)
 {
-    EXPECT_CALL(*this, setStreamSocket()).WillOnce(Return());
+    EXPECT_CALL(dbusLoopMock, addOutputHandler(_, _)).WillOnce(Return());
     EXPECT_CALL(hostConsoleMock, connect()).WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, addSignalHandler(Eq(SIGTERM), _))
         .WillOnce(Throw(std::runtime_error("Mock error")));
@@ -151,9 +118,9 @@ TEST_F(StreamServiceTest, RunOk)
     EXPECT_CALL(hostConsoleMock, connect()).WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, addIoHandler(Eq(int(hostConsoleMock)), _))
         .WillOnce(Return());
+    EXPECT_CALL(dbusLoopMock, addOutputHandler(_, _)).WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, addSignalHandler(Eq(SIGTERM), _))
         .WillOnce(Return());
-    EXPECT_CALL(*this, setStreamSocket()).WillOnce(Return());
     EXPECT_CALL(dbusLoopMock, run).WillOnce(Return(0));
     EXPECT_NO_THROW(run());
 }
@@ -0,0 +1,417 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2021 Google
+
+#include "config.hpp"
+#include "dbus_loop_mock.hpp"
+#include "stream_sink.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+constexpr char socketPath[] = "\0rsyslog";
+constexpr char firstLine[] = "Hello world\n";
+constexpr char secondLine[] = "World hello again\n";
+// Max size of a datagram.
+constexpr int consoleReadMaxSize = 1024;
+
+using ::testing::_;
+using ::testing::InSequence;
+using ::testing::MatchesRegex;
+using ::testing::Return;
+using ::testing::Test;
+
+// Create a socket for reading datagrams, returns -1 on errors.
+int bindServer()
+{
+    const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd == -1)
+    {
+        return -1;
+    }
+    sockaddr_un sa{};
+    sa.sun_family = AF_UNIX;
+    memcpy(sa.sun_path, socketPath, sizeof(socketPath) - 1);
+    sa.sun_path[sizeof(socketPath) - 1] = '\0';
+    const socklen_t len =
+        sizeof(sa) - sizeof(sa.sun_path) + sizeof(socketPath) - 1;
+    if (bind(fd, reinterpret_cast<const sockaddr*>(&sa), len) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// A helper class that owns config.
+struct ConfigInTest
+{
+    Config config;
+    ConfigInTest() : config()
+    {
+        config.streamDestination = socketPath;
+        // Send each line in its own datagram without delay.
+        config.streamPack = false;
+        config.streamTimeout = 0;
+    }
+};
+
+class StreamSinkTest : public Test, public ConfigInTest, public StreamSink
+{
+  public:
+    // ConfigInTest::config is initialized before StreamSink.
+    StreamSinkTest() :
+        StreamSink(ConfigInTest::config, dbusLoopMock), serverSocket(-1)
+    {}
+    ~StreamSinkTest() override
+    {
+        // Stop server
+        if (serverSocket != -1)
+        {
+            close(serverSocket);
+        }
+    }
+
+  protected:
+    // Start a server for reading datagrams.
+    void startServer()
+    {
+        serverSocket = bindServer();
+        ASSERT_NE(serverSocket, -1);
+    }
+
+    DbusLoopMock dbusLoopMock;
+    int serverSocket;
+};
+
+TEST_F(StreamSinkTest, SendOk)
+{
+    startServer();
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+    EXPECT_NO_THROW(StreamSink::append(firstLine, strlen(firstLine)));
+    EXPECT_NO_THROW(
+        StreamSink::append(secondLine, strlen(secondLine)));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+    char buffer[consoleReadMaxSize];
+    EXPECT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
+              strlen(firstLine));
+    buffer[strlen(firstLine)] = '\0';
+    EXPECT_STREQ(buffer, firstLine);
+    EXPECT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
+              strlen(secondLine));
+    buffer[strlen(secondLine)] = '\0';
+    EXPECT_STREQ(buffer, secondLine);
+}
+
+TEST_F(StreamSinkTest, LineAligned)
+{
+    startServer();
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+    // Lines are split between chunks and terminated by different EOLs
+    EXPECT_NO_THROW(StreamSink::append("Hello", 5));
+    EXPECT_NO_THROW(StreamSink::append(" world\r", 7));
+    EXPECT_NO_THROW(StreamSink::append("\nWorld ", 7));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+    char buffer[consoleReadMaxSize];
+    ASSERT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
+              strlen(firstLine));
+    buffer[strlen(firstLine)] = '\0';
+    EXPECT_STREQ(buffer, firstLine);
+    // Incomplete line is not sent
+    EXPECT_EQ(recv(serverSocket, buffer, consoleReadMaxSize, MSG_DONTWAIT),
+              -1);
+}
+
+TEST_F(StreamSinkTest, Commit)
+{
+    startServer();
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+    // Parts of lines are split already, incomplete line is sent on commit
+    EXPECT_NO_THROW(StreamSink::addPart("Hello", 5, false));
+    EXPECT_NO_THROW(StreamSink::addPart(" world", 6, true));
+    EXPECT_NO_THROW(StreamSink::addPart("World", 5, false));
+    EXPECT_NO_THROW(StreamSink::commit());
+    char buffer[consoleReadMaxSize];
+    ASSERT_EQ(read(serverSocket, buffer, consoleReadMaxSize),
+              strlen(firstLine));
+    buffer[strlen(firstLine)] = '\0';
+    EXPECT_STREQ(buffer, firstLine);
+    ASSERT_EQ(read(serverSocket, buffer, consoleReadMaxSize), 6);
+    buffer[6] = '\0';
+    EXPECT_STREQ(buffer, "World\n");
+}
+
+TEST_F(StreamSinkTest, FlushTimer)
+{
+    constexpr size_t timerId = 7;
+    ConfigInTest::config.streamTimeout = 1;
+    startServer();
+
+    // The timer is enabled only while the incomplete line waits
+    InSequence seq;
+    EXPECT_CALL(dbusLoopMock, addOutputHandler(_, _)).Times(1);
+    EXPECT_CALL(dbusLoopMock, addTimerHandler(1'000, _))
+        .WillOnce(Return(timerId));
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, false)).Times(1);
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, true)).Times(1);
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, false)).Times(1);
+    EXPECT_NO_THROW(StreamSink::start());
+
+    EXPECT_NO_THROW(StreamSink::addPart("Hello", 5, false));
+    EXPECT_NO_THROW(StreamSink::commit());
+    char buffer[consoleReadMaxSize];
+    EXPECT_EQ(recv(serverSocket, buffer, consoleReadMaxSize, MSG_DONTWAIT),
+              -1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    StreamSink::flushPartial();
+    ASSERT_EQ(read(serverSocket, buffer, consoleReadMaxSize), 6);
+    buffer[6] = '\0';
+    EXPECT_STREQ(buffer, "Hello\n");
+
+    // Complete lines don't need the timer
+    EXPECT_NO_THROW(StreamSink::addPart("World", 5, true));
+    EXPECT_NO_THROW(StreamSink::commit());
+}
+
+TEST_F(StreamSinkTest, Backlog)
+{
+    startServer();
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+
+    // Receiver's queue is limited, the rest is sent when it has room
+    constexpr size_t lines = 100;
+    std::string data;
+    for (size_t i = 0; i < lines; ++i)
+    {
+        data += "line " + std::to_string(i) + '\n';
+    }
+    EXPECT_CALL(dbusLoopMock, enableOutputHandler(_, true)).Times(1);
+    EXPECT_NO_THROW(StreamSink::append(data.data(), data.size()));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+
+    EXPECT_CALL(dbusLoopMock, enableOutputHandler(_, false)).Times(1);
+    std::string received;
+    char buffer[consoleReadMaxSize];
+    ssize_t rsz;
+    while ((rsz = recv(serverSocket, buffer, sizeof(buffer), MSG_DONTWAIT)) >
+           0)
+    {
+        received.append(buffer, rsz);
+        // Receiver has room now
+        StreamSink::resumeOutput();
+    }
+    EXPECT_EQ(received, data);
+}
+
+/**
+ * @class StreamBacklogTest
+ * @brief Tests of the backlog overflow policies.
+ */
+class StreamBacklogTest :
+    public ::testing::TestWithParam<Overflow>,
+    public ConfigInTest,
+    public StreamSink
+{
+  public:
+    StreamBacklogTest() :
+        StreamSink(ConfigInTest::config, dbusLoopMock)
+    {
+        ConfigInTest::config.streamBacklog = backlogLines * lineSize;
+        ConfigInTest::config.streamOverflow = GetParam();
+    }
+    ~StreamBacklogTest() override
+    {
+        if (serverSocket != -1)
+        {
+            close(serverSocket);
+        }
+    }
+
+  protected:
+    static constexpr size_t backlogLines = 5;
+    static constexpr size_t lineSize = 8;
+
+    DbusLoopMock dbusLoopMock;
+    int serverSocket = -1;
+};
+
+TEST_P(StreamBacklogTest, Overflow)
+{
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+
+    // Receiver is not started yet, lines are kept in the backlog
+    std::string data;
+    for (size_t i = 10; i < 30; ++i)
+    {
+        data += "line " + std::to_string(i) + '\n';
+    }
+    ASSERT_EQ(data.size(), 20 * lineSize);
+    EXPECT_NO_THROW(StreamSink::append(data.data(), data.size()));
+    EXPECT_THROW(StreamSink::sendDatagrams(), std::system_error);
+
+    serverSocket = bindServer();
+    ASSERT_NE(serverSocket, -1);
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+
+    std::string received;
+    char buffer[consoleReadMaxSize];
+    ssize_t rsz;
+    while ((rsz = recv(serverSocket, buffer, sizeof(buffer), MSG_DONTWAIT)) >
+           0)
+    {
+        received.append(buffer, rsz);
+    }
+    const size_t keep = backlogLines * lineSize;
+    if (GetParam() == Overflow::dropOldest)
+    {
+        EXPECT_EQ(received, data.substr(data.size() - keep));
+    }
+    else
+    {
+        EXPECT_EQ(received, data.substr(0, keep));
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Policies, StreamBacklogTest,
+                         ::testing::Values(Overflow::dropOldest,
+                                           Overflow::dropNewest));
+
+// A helper class that owns config with the spool file.
+struct SpoolConfigInTest : ConfigInTest
+{
+    SpoolConfigInTest()
+    {
+        fs::remove(spoolPath);
+        config.streamSpool = spoolPath;
+        config.streamSpoolSize = 16;
+    }
+    ~SpoolConfigInTest()
+    {
+        fs::remove(spoolPath);
+    }
+
+    static constexpr char spoolPath[] = "/tmp/stream_service_test.spool.gz";
+};
+
+/**
+ * @class StreamSpoolTest
+ * @brief Tests of the spool file used while the destination is down.
+ */
+class StreamSpoolTest :
+    public Test,
+    public SpoolConfigInTest,
+    public StreamSink
+{
+  public:
+    StreamSpoolTest() :
+        StreamSink(ConfigInTest::config, dbusLoopMock)
+    {}
+    ~StreamSpoolTest() override
+    {
+        if (serverSocket != -1)
+        {
+            close(serverSocket);
+        }
+    }
+
+  protected:
+    // Receive all queued datagrams.
+    std::string receive()
+    {
+        std::string received;
+        char buffer[consoleReadMaxSize];
+        ssize_t rsz;
+        while ((rsz = recv(serverSocket, buffer, sizeof(buffer),
+                           MSG_DONTWAIT)) > 0)
+        {
+            received.append(buffer, rsz);
+        }
+        return received;
+    }
+
+    DbusLoopMock dbusLoopMock;
+    int serverSocket = -1;
+};
+
+TEST_F(StreamSpoolTest, Replay)
+{
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+
+    // Destination is down, lines are saved to the spool file
+    EXPECT_NO_THROW(StreamSink::append("line 1\nline 2\n", 14));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+    EXPECT_TRUE(fs::exists(spoolPath));
+
+    // Destination is up, new lines are sent immediately
+    serverSocket = bindServer();
+    ASSERT_NE(serverSocket, -1);
+    EXPECT_NO_THROW(StreamSink::append("line 3\n", 7));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+    EXPECT_EQ(receive(), "line 3\n");
+
+    // Spooled lines are replayed with the original time stamps
+    StreamSink::replaySpool();
+    const std::string replayed = receive();
+    EXPECT_THAT(replayed, MatchesRegex("\\[ .* \\] line 1\n"
+                                       "\\[ .* \\] line 2\n"));
+    StreamSink::replaySpool();
+    EXPECT_FALSE(fs::exists(spoolPath));
+    EXPECT_EQ(receive(), "");
+}
+
+TEST_F(StreamSpoolTest, ReplayTimer)
+{
+    constexpr size_t timerId = 3;
+
+    // The timer is enabled only while the spool file has data
+    InSequence seq;
+    EXPECT_CALL(dbusLoopMock, addOutputHandler(_, _)).Times(1);
+    EXPECT_CALL(dbusLoopMock, addTimerHandler(1'000'000, _))
+        .WillOnce(Return(timerId));
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, false)).Times(1);
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, true)).Times(1);
+    EXPECT_CALL(dbusLoopMock, enableTimerHandler(timerId, false)).Times(1);
+    EXPECT_NO_THROW(StreamSink::start());
+
+    EXPECT_NO_THROW(StreamSink::append("line 1\n", 7));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+
+    serverSocket = bindServer();
+    ASSERT_NE(serverSocket, -1);
+    StreamSink::replaySpool();
+    StreamSink::replaySpool();
+    EXPECT_FALSE(fs::exists(spoolPath));
+    EXPECT_THAT(receive(), MatchesRegex("\\[ .* \\] line 1\n"));
+}
+
+TEST_F(StreamSpoolTest, SizeLimit)
+{
+    EXPECT_NO_THROW(StreamSink::setStreamSocket());
+
+    // The third line doesn't fit the spool file
+    const std::string data = "line 1\nline 2\nline 3\n";
+    EXPECT_NO_THROW(StreamSink::append(data.data(), data.size()));
+    EXPECT_NO_THROW(StreamSink::sendDatagrams());
+
+    serverSocket = bindServer();
+    ASSERT_NE(serverSocket, -1);
+    StreamSink::replaySpool();
+    EXPECT_THAT(receive(), MatchesRegex("\\[ .* \\] line 1\n"
+                                        "\\[ .* \\] line 2\n"));
+}
+} // namespace
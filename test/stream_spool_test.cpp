@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "stream_spool.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace fs = std::filesystem;
+
+using ::testing::ElementsAre;
+using ::testing::EndsWith;
+
+/**
+ * @class StreamSpoolFileTest
+ * @brief Stream spool file tests.
+ */
+class StreamSpoolFileTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fs::remove(path);
+    }
+
+    void TearDown() override
+    {
+        fs::remove(path);
+    }
+
+    /** @brief Read all lines from the spool. */
+    static std::vector<std::string> readAll(StreamSpool& spool)
+    {
+        std::vector<std::string> lines;
+        while (const auto line = spool.read())
+        {
+            lines.emplace_back(*line);
+        }
+        return lines;
+    }
+
+    const std::string path = "/tmp/stream_spool_test.gz";
+    const timespec now{1600000000, 0};
+};
+
+TEST_F(StreamSpoolFileTest, WriteRead)
+{
+    StreamSpool spool(path, 1024);
+    EXPECT_FALSE(spool.pending());
+    EXPECT_TRUE(spool.writable());
+    EXPECT_TRUE(spool.write(now, "line 1\nline 2\n"));
+    EXPECT_TRUE(spool.write(now, "line 3\n"));
+    EXPECT_TRUE(spool.pending());
+
+    EXPECT_THAT(readAll(spool),
+                ElementsAre(EndsWith("] line 1"), EndsWith("] line 2"),
+                            EndsWith("] line 3")));
+    EXPECT_FALSE(spool.pending());
+    EXPECT_FALSE(fs::exists(path));
+}
+
+TEST_F(StreamSpoolFileTest, NotWritableWhileReading)
+{
+    StreamSpool spool(path, 1024);
+    EXPECT_TRUE(spool.write(now, "line 1\nline 2\n"));
+    EXPECT_TRUE(spool.read());
+    EXPECT_FALSE(spool.writable());
+    EXPECT_FALSE(spool.write(now, "line 3\n"));
+    EXPECT_THAT(readAll(spool), ElementsAre(EndsWith("] line 2")));
+    EXPECT_TRUE(spool.writable());
+}
+
+TEST_F(StreamSpoolFileTest, SizeLimit)
+{
+    StreamSpool spool(path, 10);
+    EXPECT_TRUE(spool.write(now, "line 1\n"));
+    EXPECT_FALSE(spool.write(now, "line 2\n"));
+    EXPECT_THAT(readAll(spool), ElementsAre(EndsWith("] line 1")));
+}
+
+TEST_F(StreamSpoolFileTest, PreviousRun)
+{
+    {
+        StreamSpool spool(path, 1024);
+        EXPECT_TRUE(spool.write(now, "line 1\n"));
+    }
+
+    // Spool of the previous run must be read before writing
+    StreamSpool spool(path, 1024);
+    EXPECT_TRUE(spool.pending());
+    EXPECT_FALSE(spool.writable());
+    EXPECT_THAT(readAll(spool), ElementsAre(EndsWith("] line 1")));
+    EXPECT_TRUE(spool.write(now, "line 2\n"));
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "time_formatter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <gtest/gtest.h>
+
+/** @brief Format time stamp without cache. */
+static std::string formatDirect(const timespec& ts)
+{
+    tm tmLocal;
+    localtime_r(&ts.tv_sec, &tmLocal);
+    char buf[128];
+    snprintf(buf, sizeof(buf),
+             "[ %i-%02i-%02iT%02i:%02i:%02i.%03ld%+03ld:%02ld ] ",
+             tmLocal.tm_year + 1900, tmLocal.tm_mon + 1, tmLocal.tm_mday,
+             tmLocal.tm_hour, tmLocal.tm_min, tmLocal.tm_sec,
+             ts.tv_nsec / 1'000'000, tmLocal.tm_gmtoff / (60 * 60),
+             labs(tmLocal.tm_gmtoff % (60 * 60)) / 60);
+    return buf;
+}
+
+TEST(TimeFormatterTest, Format)
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec = 0;
+
+    TimeFormatter formatter;
+    // Same second with different milliseconds, then several next seconds
+    for (const long ms : {0, 1, 12, 123, 999, 5, 999})
+    {
+        ts.tv_nsec = ms * 1'000'000 + 999'999;
+        EXPECT_EQ(formatter.format(ts), formatDirect(ts));
+    }
+    for (size_t i = 0; i < 100; ++i)
+    {
+        ts.tv_sec += 59;
+        ts.tv_nsec = static_cast<long>(i) * 9'876'543;
+        EXPECT_EQ(formatter.format(ts), formatDirect(ts));
+    }
+    // Back in time
+    ts.tv_sec -= 3600;
+    EXPECT_EQ(formatter.format(ts), formatDirect(ts));
+}
+
+TEST(TimeFormatterTest, FixedTimezone)
+{
+    const char* tz = getenv("TZ");
+    const std::string savedTz = tz ? tz : "";
+    setenv("TZ", "UTC-3", 1);
+    tzset();
+
+    TimeFormatter formatter;
+    timespec ts{1'600'000'000, 42'000'000};
+    EXPECT_EQ(formatter.format(ts), "[ 2020-09-13T15:26:40.042+03:00 ] ");
+
+    // The offset is obtained once, changing the timezone has no effect
+    setenv("TZ", "UTC", 1);
+    tzset();
+    ts.tv_sec += 60;
+    EXPECT_EQ(formatter.format(ts), "[ 2020-09-13T15:27:40.042+03:00 ] ");
+
+    if (tz)
+    {
+        setenv("TZ", savedTz.c_str(), 1);
+    }
+    else
+    {
+        unsetenv("TZ");
+    }
+    tzset();
+}
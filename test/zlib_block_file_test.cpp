@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "zlib_block_file.hpp"
+#include "zlib_file.hpp"
+
+#include <algorithm>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+/**
+ * @class ZlibBlockFileTest
+ * @brief Seekable gzip file tests.
+ */
+class ZlibBlockFileTest : public ::testing::Test
+{
+  protected:
+    void TearDown() override
+    {
+        unlink(path.c_str());
+    }
+
+    /**
+     * @brief Write the log, one message per millisecond.
+     *
+     * @param[in] file log writer
+     * @param[in] count number of messages
+     *
+     * @return expected text of the log
+     */
+    std::vector<std::string> writeLog(LogWriter& file, size_t count)
+    {
+        std::vector<std::string> records;
+        TimeFormatter formatter;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const timespec ts = timeStamp(i);
+            const std::string msg = "Message #" + std::to_string(i) +
+                                    std::string(i % 100, 'a' + i % 26);
+            file.write(ts, msg);
+            records.push_back(std::string(formatter.format(ts)) + msg + '\n');
+            if (i == count / 2)
+            {
+                file.sync();
+            }
+        }
+        file.close();
+        return records;
+    }
+
+    /** @brief Get time stamp of the message. */
+    static timespec timeStamp(size_t index)
+    {
+        return timespec{static_cast<time_t>(1'600'000'000 + index / 1000),
+                        static_cast<long>(index % 1000) * 1'000'000};
+    }
+
+    /** @brief Decompress the whole file as zcat does. */
+    std::string readAll() const
+    {
+        std::string text;
+        gzFile fd = gzopen(path.c_str(), "r");
+        EXPECT_TRUE(fd);
+        char buf[4096];
+        int len;
+        while ((len = gzread(fd, buf, sizeof(buf))) > 0)
+        {
+            text.append(buf, len);
+        }
+        gzclose(fd);
+        return text;
+    }
+
+    /**
+     * @brief Check that each block starts with the indexed record.
+     *
+     * @param[in] index index of blocks
+     * @param[in] records expected records
+     */
+    void checkBlocks(const std::vector<ZlibBlockFile::Block>& index,
+                     const std::vector<std::string>& records) const
+    {
+        ASSERT_GE(index.size(), 2);
+        EXPECT_EQ(index.front().offset, 0);
+        EXPECT_EQ(index.front().line, 0);
+        EXPECT_EQ(index.back().line, records.size());
+        for (size_t i = 0; i + 1 < index.size(); ++i)
+        {
+            const ZlibBlockFile::Block& block = index[i];
+            ASSERT_LT(block.offset, index[i + 1].offset);
+            ASSERT_LT(block.line, index[i + 1].line);
+            const timespec ts = timeStamp(block.line);
+            EXPECT_EQ(block.time, ts.tv_sec * 1000 + ts.tv_nsec / 1'000'000);
+
+            const std::string text =
+                ZlibBlockFile::readBlocks(path, block, index[i + 1]);
+            std::string expect;
+            for (size_t line = block.line; line < index[i + 1].line; ++line)
+            {
+                expect += records[line];
+            }
+            ASSERT_EQ(text, expect);
+        }
+    }
+
+    const std::string path = "/tmp/zlib_block_file_test.out";
+};
+
+TEST_F(ZlibBlockFileTest, Blocks)
+{
+    const auto file = LogWriter::create(Compression::zlib, 0, path, 1, 16384);
+    ASSERT_TRUE(dynamic_cast<ZlibBlockFile*>(file.get()));
+    const std::vector<std::string> records = writeLog(*file, 5000);
+
+    // The file is a valid gzip stream
+    std::string expect;
+    for (const std::string& record : records)
+    {
+        expect += record;
+    }
+    EXPECT_TRUE(readAll() == expect);
+
+    const auto index = ZlibBlockFile::readIndex(path);
+    EXPECT_GT(index.size(), 10);
+    checkBlocks(index, records);
+    const timespec last = timeStamp(records.size() - 1);
+    EXPECT_EQ(index.back().time, last.tv_sec * 1000 + last.tv_nsec / 1000000);
+}
+
+TEST_F(ZlibBlockFileTest, LargeIndex)
+{
+    // Every record is a block, the index is merged to fit the trailer
+    ZlibBlockFile file(path, Z_DEFAULT_COMPRESSION, 1);
+    const std::vector<std::string> records = writeLog(file, 10000);
+
+    const auto index = ZlibBlockFile::readIndex(path);
+    EXPECT_GT(index.size(), 1000);
+    EXPECT_LT(index.size(), 65536 / 24);
+    checkBlocks(index, records);
+}
+
+TEST_F(ZlibBlockFileTest, Truncated)
+{
+    ZlibBlockFile file(path, Z_DEFAULT_COMPRESSION, 1024);
+    writeLog(file, 100);
+    const auto index = ZlibBlockFile::readIndex(path);
+    ASSERT_GE(index.size(), 2);
+
+    // The last member has no end, the gzip trailer is cut off
+    ZlibBlockFile::Block end = index[1];
+    end.offset -= 4;
+    EXPECT_THROW(ZlibBlockFile::readBlocks(path, index[0], end),
+                 std::runtime_error);
+    EXPECT_TRUE(ZlibBlockFile::readBlocks(path, index[0], index[0]).empty());
+}
+
+TEST_F(ZlibBlockFileTest, NoIndex)
+{
+    ZlibFile file(path);
+    writeLog(file, 100);
+    EXPECT_TRUE(ZlibBlockFile::readIndex(path).empty());
+
+    EXPECT_THROW(ZlibBlockFile::readIndex("/invalid/path"), std::system_error);
+}
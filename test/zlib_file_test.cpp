@@ -4,8 +4,19 @@
 #include "zlib_exception.hpp"
 #include "zlib_file.hpp"
 
+#include <fstream>
+#include <iterator>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+/** @brief Read the whole file. */
+static std::string readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
 TEST(ZlibFileTest, Exception)
 {
     ASSERT_THROW(ZlibFile("invalid/path"), ZlibException);
@@ -14,20 +25,21 @@ TEST(ZlibFileTest, Exception)
 TEST(ZlibFileTest, Write)
 {
     const std::string msg = "Test message";
-    time_t currTime;
-    time(&currTime);
+    timespec currTime;
+    clock_gettime(CLOCK_REALTIME, &currTime);
+    currTime.tv_nsec = 12'345'678;
     tm localTime;
-    localtime_r(&currTime, &localTime);
+    localtime_r(&currTime.tv_sec, &localTime);
 
     const std::string path = "/tmp/zlib_file_test.out";
     ZlibFile file(path);
-    file.write(localTime, msg);
+    file.write(currTime, msg);
     file.close();
 
     char expect[64];
     const int len =
         snprintf(expect, sizeof(expect),
-                 "[ %i-%02i-%02iT%02i:%02i:%02i%+03ld:%02ld ] %s\n",
+                 "[ %i-%02i-%02iT%02i:%02i:%02i.012%+03ld:%02ld ] %s\n",
                  localTime.tm_year + 1900, localTime.tm_mon + 1,
                  localTime.tm_mday, localTime.tm_hour, localTime.tm_min,
                  localTime.tm_sec, localTime.tm_gmtoff / (60 * 60),
@@ -43,3 +55,51 @@ TEST(ZlibFileTest, Write)
 
     unlink(path.c_str());
 }
+
+TEST(ZlibFileTest, GzipCompatible)
+{
+    const std::string path = "/tmp/zlib_file_test.out";
+    const std::string refPath = "/tmp/zlib_file_test.ref";
+
+    // Messages of various size, including one larger than internal buffers
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        messages.push_back("Message #" + std::to_string(i) +
+                           std::string(i % 120, 'a' + i % 26));
+    }
+    messages.insert(messages.begin() + 1000, std::string(200'000, 'x'));
+
+    timespec ts{1'600'000'000, 0};
+    ZlibFile file(path);
+    TimeFormatter formatter;
+    gzFile ref = gzopen(refPath.c_str(), "w");
+    ASSERT_TRUE(ref);
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        ts.tv_nsec = static_cast<long>(i % 1000) * 1'000'000;
+        ts.tv_sec += i % 3;
+        file.write(ts, messages[i]);
+
+        const std::string_view prefix = formatter.format(ts);
+        gzwrite(ref, prefix.data(), static_cast<unsigned>(prefix.size()));
+        gzwrite(ref, messages[i].data(),
+                static_cast<unsigned>(messages[i].size()));
+        gzputc(ref, '\n');
+
+        if (i == 3000)
+        {
+            file.sync();
+            gzflush(ref, Z_SYNC_FLUSH);
+        }
+    }
+    file.close();
+    EXPECT_EQ(gzclose(ref), Z_OK);
+
+    const std::string data = readFile(path);
+    EXPECT_FALSE(data.empty());
+    EXPECT_TRUE(data == readFile(refPath));
+
+    unlink(path.c_str());
+    unlink(refPath.c_str());
+}
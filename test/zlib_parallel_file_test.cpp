@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright (C) 2020 YADRO
+
+#include "zlib_exception.hpp"
+#include "zlib_file.hpp"
+#include "zlib_parallel_file.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+/** @brief Read and decompress gzip file, check sum is verified by zlib. */
+static bool readZlib(const std::string& path, std::string& text)
+{
+    text.clear();
+    gzFile fd = gzopen(path.c_str(), "r");
+    if (fd == Z_NULL)
+    {
+        return false;
+    }
+    char buf[4096];
+    int rc;
+    while ((rc = gzread(fd, buf, sizeof(buf))) > 0)
+    {
+        text.append(buf, rc);
+    }
+    return gzclose(fd) == Z_OK && rc == 0;
+}
+
+/** @brief Get file size. */
+static size_t fileSize(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) ? 0 : st.st_size;
+}
+
+/**
+ * @class ZlibParallelFileTest
+ * @brief Parallel gzip writer tests, parameterized by number of threads.
+ */
+class ZlibParallelFileTest : public ::testing::TestWithParam<size_t>
+{
+  protected:
+    void TearDown() override
+    {
+        unlink(path.c_str());
+        unlink(refPath.c_str());
+    }
+
+    const std::string path = "/tmp/zlib_parallel_file_test.out";
+    const std::string refPath = "/tmp/zlib_parallel_file_test.ref";
+};
+
+TEST_P(ZlibParallelFileTest, Write)
+{
+    const timespec ts{1'600'000'000, 123'000'000};
+    TimeFormatter formatter;
+    std::string expect;
+    ZlibParallelFile file(path, Z_DEFAULT_COMPRESSION, GetParam());
+    ZlibFile ref(refPath);
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        std::string msg = "Message #" + std::to_string(i * 7919 % 10007);
+        msg.append(i % 100, 'a' + i % 26);
+        if (i == 20000)
+        {
+            // Message larger than a block
+            msg.append(300'000, 'x');
+        }
+        file.write(ts, msg);
+        ref.write(ts, msg);
+        expect += formatter.format(ts);
+        expect += msg;
+        expect += '\n';
+
+        if (i == 100 || i == 30000)
+        {
+            // Data written before sync must be readable
+            file.sync();
+            std::string text;
+            readZlib(path, text);
+            EXPECT_EQ(text.size(), expect.size());
+            EXPECT_TRUE(text == expect);
+        }
+    }
+    file.close();
+    ref.close();
+
+    std::string text;
+    EXPECT_TRUE(readZlib(path, text));
+    EXPECT_EQ(text.size(), expect.size());
+    EXPECT_TRUE(text == expect);
+
+    // Dictionaries keep the ratio close to the single-threaded one
+    EXPECT_LT(fileSize(path), fileSize(refPath) * 105 / 100);
+}
+
+TEST_P(ZlibParallelFileTest, Empty)
+{
+    ZlibParallelFile file(path, 9, GetParam());
+    file.close();
+    std::string text;
+    EXPECT_TRUE(readZlib(path, text));
+    EXPECT_TRUE(text.empty());
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, ZlibParallelFileTest,
+                         ::testing::Values(1, 2, 4));
+
+TEST(ZlibParallelFileExceptionTest, InvalidPath)
+{
+    ASSERT_THROW(ZlibParallelFile("invalid/path", Z_DEFAULT_COMPRESSION, 2),
+                 ZlibException);
+}